@@ -46,33 +46,76 @@ uint16_t RGB::convertTo565() {
     return col; // ((red / 8) << 11) | ((green / 4) << 5) | (blue / 8);
 }
 
-regtype *registerCS; // chip select
-regsize bitmaskCS;
-
 PixelsBase::PixelsBase(uint16_t width, uint16_t height) {
     deviceWidth = width < height ? width : height;
     deviceHeight = width > height ? width : height;
     this->width = width;
     this->height = height;
+    scrollTop = 0;
+    scrollBottom = 0;
+    currentScroll = 0;
     setOrientation( width > height ? LANDSCAPE : PORTRAIT );
 
     relativeOrigin = true;
+    clipDepth = 0;
+
+    currentFont = NULL;
+    antialiasing = false;
+    glyphPrintMode = TRANSPARENT_TEXT_BACKGROUND;
+    caretX = 0;
+    caretY = 0;
+
+#ifndef NO_TEXT_WRAP
+    wrapText = false;
+    textWrapMarginLeft = 0;
+    textWrapMarginRight = 0;
+    textWrapLineGap = 0;
+    textWrapScroll = false;
+    textWrapMarginBottom = 0;
+    textWrapScrollFill = NULL;
+#endif
 
-    currentScroll = 0;
     scrollSupported = true;
     scrollEnabled = true;
     extraScrollDelay = 0;
+    flipScroll = 0;
+    scrollCleanMode = false;
+
+    sliceHandler = NULL;
+    sliceRows = 16;
 
     lineWidth = 1;
+    lineCap = LINE_CAP_BUTT;
+    lineJoin = LINE_JOIN_MITER;
     fillDirection = 0;
 
     computedBgColor = new RGB(0, 0, 0);
     computedFgColor = new RGB(0, 0, 0);
     bgBuffer = new RGB(0, 0, 0);
     fgBuffer = new RGB(0, 0, 0);
+    pixelBuffer = new RGB(0, 0, 0);
 
     gfxOpNestingDepth = 0;
 
+    byteReader = NULL;
+
+    fbData = NULL;
+    fbOwned = false;
+    dirtyCount = 0;
+
+    dlData = NULL;
+    dlSize = 0;
+    dlLength = 0;
+    dlRecording = false;
+    dlOverflow = false;
+    dlStateValid = false;
+
+    glyphScale = 256;
+    glyphX = 0;
+    glyphY = 0;
+    glyphClipX1 = -0x7fff;
+    glyphClipX2 = 0x7fff;
+
     setBackground(0,0,0);
     setColor(0xFF,0xFF,0xFF);
 }
@@ -80,8 +123,8 @@ PixelsBase::PixelsBase(uint16_t width, uint16_t height) {
 void PixelsBase::setOrientation( uint8_t direction ){
 
     if ( (orientation < 2 && direction > 1) || (orientation > 1 && direction < 2) ) {
-        currentScroll = 2 * deviceHeight - currentScroll;
-        currentScroll %= deviceHeight;
+        currentScroll = 2 * scrollBand() - currentScroll;
+        currentScroll %= scrollBand();
     }
     orientation = direction;
 
@@ -109,6 +152,11 @@ void PixelsBase::setOrientation( uint8_t direction ){
 /*  Graphic primitives */
 
 void PixelsBase::clear() {
+    if ( dlRecording ) {
+        recordCommand(DL_CLEAR, NULL, 0);
+        return;
+    }
+
     boolean s = relativeOrigin;
     relativeOrigin = false;
     RGB* sav = getColor();
@@ -119,88 +167,186 @@ void PixelsBase::clear() {
 }
 
 RGB* PixelsBase::getPixel(int16_t x, int16_t y) {
-    return getBackground();
+    uint16_t c;
+    if ( !readPixels(x, y, 1, &c) ) {
+        return getBackground();
+    }
+    *pixelBuffer = pixelBuffer->convert565toRGB(c);
+    return pixelBuffer;
 }
 
 void PixelsBase::drawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
 
+    if ( dlRecording ) {
+        int16_t args[] = {x1, y1, x2, y2};
+        recordCommand(DL_LINE, args, sizeof(args));
+        return;
+    }
+
     beginGfxOperation();
 
-    if (y1 == y2 && lineWidth == 1) {
-        hLine(x1, y1, x2);
-    } else if (x1 == x2 && lineWidth == 1) {
-        vLine(x1, y1, y2);
+    boolean thin = strokeWidth() == 1;
+    if ( !thin ) {
+        int16_t points[] = {x1, y1, x2, y2};
+        strokePolyline(points, 2, false);
+    } else if ( antialiasing && x1 != x2 && y1 != y2 ) {
+        drawLineAntialiased(x1, y1, x2, y2);
     } else {
-        if ( lineWidth == 1 ) {
-            if ( antialiasing ) {
-                drawLineAntialiased(x1, y1, x2, y2);
-            } else {
-                int16_t dx;
-                int16_t dy;
-                int16_t sx;
-                int16_t sy;
-
-                if ( x2 > x1 ) {
-                    dx = x2 - x1;
-                    sx = 1;
-                } else {
-                    dx = x1 - x2;
-                    sx = -1;
-                }
+        thinLine(foreground->convertTo565(), x1, y1, x2, y2);
+    }
 
-                if ( y2 > y1 ) {
-                    dy = y2 - y1;
-                    sy = 1;
-                } else {
-                    dy = y1 - y2;
-                    sy = -1;
-                }
+    endGfxOperation();
+}
 
-                int16_t x = x1;
-                int16_t y = y1;
-                int16_t err = dx - dy;
-                int16_t e2;
-                while (true) {
-                    drawPixel(x, y);
-                    if (x == x2 && y == y2) {
-                        break;
-                    }
-                    e2 = err << 1;
-                    if (e2 > -dy) {
-                        err = err - dy;
-                        x = x + sx;
-                    }
-                    if (e2 < dx) {
-                        err = err + dx;
-                        y = y + sy;
-                    }
-                }
+/*
+ * One pixel wide line of the given color without antialiasing; the caller opens the operation
+ */
+void PixelsBase::thinLine(int color, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+    if ( y1 == y2 || x1 == x2 ) {
+        fill(color, x1, y1, x2, y2);
+        return;
+    }
+
+    int16_t dx;
+    int16_t dy;
+    int16_t sx;
+    int16_t sy;
+
+    if ( x2 > x1 ) {
+        dx = x2 - x1;
+        sx = 1;
+    } else {
+        dx = x1 - x2;
+        sx = -1;
+    }
+
+    if ( y2 > y1 ) {
+        dy = y2 - y1;
+        sy = 1;
+    } else {
+        dy = y1 - y2;
+        sy = -1;
+    }
+
+    // consecutive pixels of a row (of a column by steep lines) go out as one run
+    boolean steep = dy > dx;
+    int16_t x = x1;
+    int16_t y = y1;
+    int16_t runX = x;
+    int16_t runY = y;
+    int16_t err = dx - dy;
+    int16_t e2;
+    while (true) {
+        int16_t px = x;
+        int16_t py = y;
+        boolean last = x == x2 && y == y2;
+        if ( !last ) {
+            e2 = 2 * err;
+            if (e2 > -dy) {
+                err = err - dy;
+                x = x + sx;
             }
-        } else {
-            drawFatLineAntialiased(x1, y1, x2, y2);
+            if (e2 < dx) {
+                err = err + dx;
+                y = y + sy;
+            }
+        }
+        if ( last || (steep ? x != px : y != py) ) {
+            if ( steep ) {
+                fill(color, px, runY, px, py);
+            } else {
+                fill(color, runX, py, px, py);
+            }
+            runX = x;
+            runY = y;
+        }
+        if ( last ) {
+            break;
         }
     }
-
-    endGfxOperation();
 }
 
 void PixelsBase::drawRectangle(int16_t x, int16_t y, int16_t width, int16_t height) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height};
+        recordCommand(DL_RECTANGLE, args, sizeof(args));
+        return;
+    }
+
     beginGfxOperation();
-    hLine(x, y, x+width-2);
-    vLine(x+width-1, y, y+height-2);
-    hLine(x+1, y+height-1, x+width-1);
-    vLine(x, y+1, y+height-1);
+    if ( strokeWidth() > 1 ) {
+        int16_t x2 = x + width - 1;
+        int16_t y2 = y + height - 1;
+        int16_t points[] = {x, y, x2, y, x2, y2, x, y2};
+        strokePolyline(points, 4, true);
+    } else {
+        hLine(x, y, x+width-2);
+        vLine(x+width-1, y, y+height-2);
+        hLine(x+1, y+height-1, x+width-1);
+        vLine(x, y+1, y+height-1);
+    }
     endGfxOperation();
 }
 
 void PixelsBase::fillRectangle(int16_t x, int16_t y, int16_t width, int16_t height) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height};
+        recordCommand(DL_FILL_RECTANGLE, args, sizeof(args));
+        return;
+    }
+
     beginGfxOperation();
     fill(foreground->convertTo565(), x, y, x+width-1, y+height-1);
     endGfxOperation();
 }
 
+void PixelsBase::fillRects(int16_t* rects, uint16_t count) {
+    if ( dlRecording ) {
+        int16_t args[] = {(int16_t)count};
+        recordCommand(DL_FILL_RECTS, args, sizeof(args), &rects, sizeof(rects));
+        return;
+    }
+
+    if ( rects == NULL ) {
+        return;
+    }
+
+    int color = foreground->convertTo565();
+    beginGfxOperation();
+    uint16_t i = 0;
+    while ( i < count ) {
+        int16_t* r = rects + 4 * i++;
+        if ( r[2] <= 0 || r[3] <= 0 ) {
+            continue;
+        }
+        int16_t x1 = r[0];
+        int16_t y1 = r[1];
+        int16_t x2 = x1 + r[2] - 1;
+        int16_t y2 = y1 + r[3] - 1;
+        // the following rectangles, which extend this one downwards or to the right, join its region
+        for ( ; i < count; i++ ) {
+            r = rects + 4 * i;
+            if ( r[0] == x1 && r[2] == x2 - x1 + 1 && r[1] == y2 + 1 && r[3] > 0 ) {
+                y2 += r[3];
+            } else if ( r[1] == y1 && r[3] == y2 - y1 + 1 && r[0] == x2 + 1 && r[2] > 0 ) {
+                x2 += r[2];
+            } else {
+                break;
+            }
+        }
+        fill(color, x1, y1, x2, y2);
+    }
+    endGfxOperation();
+}
+
 void PixelsBase::drawRoundRectangle(int16_t x, int16_t y, int16_t width, int16_t height, int16_t radius) {
 
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, radius};
+        recordCommand(DL_ROUND_RECTANGLE, args, sizeof(args));
+        return;
+    }
+
     if ( radius < 1 ) {
         drawRectangle(x, y, width, height);
         return;
@@ -215,7 +361,9 @@ void PixelsBase::drawRoundRectangle(int16_t x, int16_t y, int16_t width, int16_t
 
     beginGfxOperation();
 
-    if ( antialiasing ) {
+    if ( strokeWidth() > 1 ) {
+        strokeRoundRectangle(x, y, x + width - 1, y + height - 1, radius, radius);
+    } else if ( antialiasing ) {
         drawRoundRectangleAntialiased(x, y, width, height, radius, radius, 0);
     } else {
         height--;
@@ -263,6 +411,12 @@ void PixelsBase::drawRoundRectangle(int16_t x, int16_t y, int16_t width, int16_t
 
 void PixelsBase::fillRoundRectangle(int16_t x, int16_t y, int16_t width, int16_t height, int16_t radius) {
 
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, radius};
+        recordCommand(DL_FILL_ROUND_RECTANGLE, args, sizeof(args));
+        return;
+    }
+
     if ( radius < 1 ) {
         fillRectangle(x, y, width, height);
         return;
@@ -275,12 +429,13 @@ void PixelsBase::fillRoundRectangle(int16_t x, int16_t y, int16_t width, int16_t
         radius = width >> 1;
     }
 
-    beginGfxOperation();
-
     if ( antialiasing ) {
-        drawRoundRectangleAntialiased(x, y, width-1, height-1, radius, radius, true);
+        fillRoundRectangleAntialiased(x, y, x + width - 1, y + height - 1, radius, radius);
+        return;
     }
 
+    beginGfxOperation();
+
     fillRectangle(x + radius, y + height - radius, width - (radius << 1), radius);
     fillRectangle(x, y + radius, width, height - (radius << 1));
     fillRectangle(x + radius, y, width - (radius << 1), radius);
@@ -324,6 +479,12 @@ void PixelsBase::fillRoundRectangle(int16_t x, int16_t y, int16_t width, int16_t
 }
 
 void PixelsBase::drawCircle(int16_t x, int16_t y, int16_t r) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, r};
+        recordCommand(DL_CIRCLE, args, sizeof(args));
+        return;
+    }
+
 
     drawOval(x-r, y-r, r<<1, r<<1);
 
@@ -363,6 +524,12 @@ void PixelsBase::drawCircle(int16_t x, int16_t y, int16_t r) {
 }
 
 void PixelsBase::fillCircle(int16_t x, int16_t y, int16_t r) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, r};
+        recordCommand(DL_FILL_CIRCLE, args, sizeof(args));
+        return;
+    }
+
 //    int16_t yy;
 //    int16_t xx;
 
@@ -382,6 +549,12 @@ void PixelsBase::fillCircle(int16_t x, int16_t y, int16_t r) {
 }
 
 void PixelsBase::drawOval(int16_t x, int16_t y, int16_t width, int16_t height) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height};
+        recordCommand(DL_OVAL, args, sizeof(args));
+        return;
+    }
+
 
     if ((width <= 0) || (height <= 0)) {
         return;
@@ -389,7 +562,9 @@ void PixelsBase::drawOval(int16_t x, int16_t y, int16_t width, int16_t height) {
 
     beginGfxOperation();
 
-    if ( antialiasing ) {
+    if ( strokeWidth() > 1 ) {
+        strokeRoundRectangle(x, y, x + (width - 1) / 2 * 2, y + (height - 1) / 2 * 2, (width - 1) / 2, (height - 1) / 2);
+    } else if ( antialiasing ) {
         drawRoundRectangleAntialiased(x, y, width, height, width/2, height/2, 0);
     } else {
         height--;
@@ -519,6 +694,12 @@ void PixelsBase::drawOval(int16_t x, int16_t y, int16_t width, int16_t height) {
 }
 
 void PixelsBase::fillOval(int16_t xx, int16_t yy, int16_t width, int16_t height) {
+    if ( dlRecording ) {
+        int16_t args[] = {xx, yy, width, height};
+        recordCommand(DL_FILL_OVAL, args, sizeof(args));
+        return;
+    }
+
 
     height--;
     width--;
@@ -551,12 +732,13 @@ void PixelsBase::fillOval(int16_t xx, int16_t yy, int16_t width, int16_t height)
         return;
     }
 
-    beginGfxOperation();
-
     if ( antialiasing ) {
-        drawRoundRectangleAntialiased(x-rx, y-ry, rx<<1, ry<<1, rx, ry, true);
+        fillRoundRectangleAntialiased(x - rx, y - ry, x + rx, y + ry, rx, ry);
+        return;
     }
 
+    beginGfxOperation();
+
     oh = oi = oj = ok = 0xFFFF;
 
     if (rx > ry) {
@@ -638,1275 +820,4625 @@ void PixelsBase::fillOval(int16_t xx, int16_t yy, int16_t width, int16_t height)
     endGfxOperation();
 }
 
-void PixelsBase::drawIcon(int16_t xx, int16_t yy, prog_uchar* data) {
-
-    int16_t fontType = BITMASK_FONT;
-    if ( pgm_read_byte_near(data + 1) == 'a' ) {
-        fontType = ANTIALIASED_FONT;
+boolean PolygonEdge::set(int16_t xa, int16_t ya, int16_t xb, int16_t yb) {
+    if ( ya == yb ) {
+        return false;
+    }
+    winding = 1;
+    if ( ya > yb ) {
+        swap(xa, xb);
+        swap(ya, yb);
+        winding = -1;
+    }
+    x1 = xa;
+    y1 = ya;
+    y2 = yb;
+    dy = (int32_t)yb - ya;
+
+    // floor division, the remainder is kept non-negative
+    int32_t dx = (int32_t)xb - xa;
+    qStep = dx / dy;
+    rStep = dx - (int32_t)qStep * dy;
+    if ( rStep < 0 ) {
+        qStep--;
+        rStep += dy;
     }
+    return true;
+}
 
-    int16_t length = ((0xFF & (int32_t)pgm_read_byte_near(data + 2)) << 8) + (0xFF & (int32_t)pgm_read_byte_near(data + 3));
+void PolygonEdge::start(int16_t y) {
+    row = y;
+    uint32_t t = (uint32_t)(y - y1) * rStep;
+    q = (y - y1) * qStep + t / dy;
+    r = t % dy;
+    x = x1 + q + (2 * r >= dy ? 1 : 0);
+}
 
-    int16_t height =  pgm_read_byte_near(data + 4);
+/*
+ * A simple convex polygon turns in one direction and changes its vertical direction twice
+ */
+boolean PixelsBase::isConvex(int16_t* points, uint8_t count) {
+    int8_t turn = 0;
+    int8_t lastDir = 0;
+    int8_t firstDir = 0;
+    uint8_t dirChanges = 0;
+
+    for ( uint8_t i = 0; i < count; i++ ) {
+        int16_t* a = points + 2 * i;
+        int16_t* b = points + 2 * ((i + 1) % count);
+        int16_t* c = points + 2 * ((i + 2) % count);
+
+        int32_t cross = (int32_t)(b[0] - a[0]) * (c[1] - b[1]) - (int32_t)(b[1] - a[1]) * (c[0] - b[0]);
+        if ( cross != 0 ) {
+            int8_t t = cross > 0 ? 1 : -1;
+            if ( turn != 0 && t != turn ) {
+                return false;
+            }
+            turn = t;
+        }
 
-    beginGfxOperation();
-    drawGlyph(fontType, false, xx, yy, height, data + 1, length-1);
-    endGfxOperation();
+        if ( b[1] != a[1] ) {
+            int8_t dir = b[1] > a[1] ? 1 : -1;
+            if ( firstDir == 0 ) {
+                firstDir = dir;
+            } else if ( dir != lastDir ) {
+                dirChanges++;
+            }
+            lastDir = dir;
+        }
+    }
+    if ( lastDir != firstDir ) {
+        dirChanges++;
+    }
+    return dirChanges <= 2;
 }
 
-void PixelsBase::cleanIcon(int16_t xx, int16_t yy, prog_uchar* data) {
+/*
+ * Fills a convex polygon with a span per row between its left and right chains, which run from
+ * the top vertex to the bottom one. Equal spans of adjacent rows are merged into one rectangle.
+ */
+void PixelsBase::fillConvex(int16_t* points, uint8_t count) {
 
-    int16_t fontType = BITMASK_FONT;
-    if ( pgm_read_byte_near(data + 1) == 'a' ) {
-        fontType = ANTIALIASED_FONT;
+    uint8_t top = 0;
+    uint8_t bottom = 0;
+    for ( uint8_t i = 1; i < count; i++ ) {
+        if ( points[2 * i + 1] < points[2 * top + 1] ) {
+            top = i;
+        }
+        if ( points[2 * i + 1] > points[2 * bottom + 1] ) {
+            bottom = i;
+        }
     }
 
-    int16_t length = ((0xFF & (int32_t)pgm_read_byte_near(data + 2)) << 8) + (0xFF & (int32_t)pgm_read_byte_near(data + 3));
-
-    int16_t height =  pgm_read_byte_near(data + 4);
+    int16_t ymin = points[2 * top + 1];
+    int16_t ymax = points[2 * bottom + 1];
+    int color = foreground->convertTo565();
 
     beginGfxOperation();
-    drawGlyph(fontType, true, xx, yy, height, data + 1, length-1);
+
+    if ( ymin == ymax ) {
+        int16_t x1 = points[0];
+        int16_t x2 = points[0];
+        for ( uint8_t i = 1; i < count; i++ ) {
+            x1 = min(x1, points[2 * i]);
+            x2 = max(x2, points[2 * i]);
+        }
+        fill(color, x1, ymin, x2, ymin);
+        endGfxOperation();
+        return;
+    }
+
+    PolygonEdge edges[2];
+    uint8_t ends[2] = {top, top};
+    int8_t dirs[2] = {1, (int8_t)(count - 1)};
+    edges[0].y2 = edges[1].y2 = ymin;
+
+    Bounds area = visibleArea();
+    int16_t y1 = max(ymin, area.y1);
+    int16_t y2 = min(ymax, area.y2);
+
+    int16_t spanX1 = 0;
+    int16_t spanX2 = -1;
+    int16_t spanY = y1;
+
+    for ( int16_t y = y1; y <= y2; y++ ) {
+        for ( uint8_t c = 0; c < 2; c++ ) {
+            PolygonEdge& e = edges[c];
+            if ( y == y1 || (e.y2 <= y && y < ymax) ) {
+                // next edge of the chain, horizontal edges are skipped
+                while ( e.y2 <= y && ends[c] != bottom ) {
+                    uint8_t from = ends[c];
+                    ends[c] = (ends[c] + dirs[c]) % count;
+                    e.set(points[2 * from], points[2 * from + 1], points[2 * ends[c]], points[2 * ends[c] + 1]);
+                }
+                e.start(y);
+            } else if ( e.row < y ) {
+                e.step();
+            }
+        }
+
+        int16_t x1 = min(edges[0].x, edges[1].x);
+        int16_t x2 = max(edges[0].x, edges[1].x);
+        if ( x1 != spanX1 || x2 != spanX2 ) {
+            if ( spanX1 <= spanX2 ) {
+                fill(color, spanX1, spanY, spanX2, y - 1);
+            }
+            spanX1 = x1;
+            spanX2 = x2;
+            spanY = y;
+        }
+    }
+    if ( spanX1 <= spanX2 && spanY <= y2 ) {
+        fill(color, spanX1, spanY, spanX2, y2);
+    }
+
     endGfxOperation();
 }
 
-int8_t PixelsBase::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data) {
+/*
+ * Scanline fill of an edge table, the edges have to be sorted by their top rows. A row is sampled
+ * by edges with y1 <= y < y2, so a vertex shared by two edges is crossed once, the bottom row is
+ * sampled by the edges ending there. The active edge table is allocated unless it is given.
+ */
+int8_t PixelsBase::fillEdges(PolygonEdge* edges, uint16_t count, uint8_t rule, PolygonEdge** activeTable) {
 
-    Bounds bb(x, y, x+width-1, y+height-1);
-    if( !transformBounds(bb) ) {
-        return 1;
+    if ( count == 0 ) {
+        return 0;
     }
 
-    if( !checkBounds(bb) ) {
-        return 1;
+    PolygonEdge** active = activeTable != NULL ? activeTable : new PolygonEdge*[count];
+    if ( active == NULL ) {
+        return -1;
     }
 
+    int16_t ymin = edges[0].y1;
+    int16_t ymax = edges[0].y2;
+    for ( uint16_t i = 1; i < count; i++ ) {
+        ymax = max(ymax, edges[i].y2);
+    }
+
+    int color = foreground->convertTo565();
+    Bounds area = visibleArea();
+    int16_t y1 = max(ymin, area.y1);
+    int16_t y2 = min(ymax, area.y2);
+
     beginGfxOperation();
-    setRegion(bb.x1, bb.y1, bb.x2, bb.y2);
 
-    int sc = currentScroll;
-    if ( sc == 0 ) {
-        sc = deviceHeight;
-    }
+    uint16_t next = 0;
+    uint16_t n = 0;
+    for ( int16_t y = y1; y <= y2; y++ ) {
+        boolean last = y == ymax;
 
-    switch( orientation ) {
-    case PORTRAIT:
-        {
-            for ( int16_t j = bb.y1; j <= bb.y2; j++ ) {
-                for ( int16_t i = bb.x1; i <= bb.x2; i++ ) {
-                    int16_t px = pgm_read_word_near(data + (j - y) * width + i - x);
-                    setCurrentPixel(px);
-                }
+        // the finished edges leave the active table, the rest advance to the row
+        uint16_t k = 0;
+        for ( uint16_t i = 0; i < n; i++ ) {
+            PolygonEdge* e = active[i];
+            if ( e->y2 <= y && !last ) {
+                continue;
             }
+            e->step();
+            active[k++] = e;
         }
-        break;
-    case LANDSCAPE:
-        {
-            int h1 = height - max(0, (y + height) - deviceWidth) - 1;
-            int w1 = width - max(0, (x + width) - sc) - 1;
-            int w = bb.x2 - bb.x1 + 1;
-            int h = bb.y2 - bb.y1 + 1;
-            for ( int16_t j = h - 1; j >= 0; j-- ) {
-                for ( int16_t i = 0; i < w; i++ ) {
-                    int16_t px = pgm_read_word_near(data + (h1 - i) * width + (w1 - j));
-                    setCurrentPixel(px);
-                }
+        n = k;
+
+        while ( next < count && edges[next].y1 <= y ) {
+            PolygonEdge* e = &edges[next++];
+            if ( e->y2 > y || (last && e->y2 == y) ) {
+                e->start(y);
+                active[n++] = e;
             }
         }
-        break;
-    case PORTRAIT_FLIP:
-        {
-            int h = bb.y2 - bb.y1 + 1;
-            int w = bb.x2 - bb.x1 + 1;
-            int cutH = y < 0 ? 0 : height - h;
-            int cutW = x < 0 ? 0 : width - w;
-            for ( int16_t j = 0; j < h; j++ ) {
-                for ( int16_t i = 0; i < w; i++ ) {
-                    int16_t px = pgm_read_word_near(data + (height - j - 1 - cutH) * width + (width - i - 1 - cutW));
-                    setCurrentPixel(px);
-                }
+
+        // the table stays almost sorted from row to row
+        for ( uint16_t i = 1; i < n; i++ ) {
+            PolygonEdge* e = active[i];
+            uint16_t j = i;
+            while ( j > 0 && active[j - 1]->x > e->x ) {
+                active[j] = active[j - 1];
+                j--;
             }
+            active[j] = e;
         }
-        break;
-    case LANDSCAPE_FLIP:
-        {
-            int h1 = height - max(0, (y + height) - deviceWidth) - 1;
-            int w1 = width - max(0, (x + width) - sc) - 1;
-            int w = bb.x2 - bb.x1 + 1;
-            int h = bb.y2 - bb.y1 + 1;
-            for ( int16_t j = 0; j < h; j++ ) {
-                for ( int16_t i = w - 1; i >= 0; i-- ) {
-                    int16_t px = pgm_read_word_near(data + (h1 - i) * width + (w1 - j));
-                    setCurrentPixel(px);
+
+        // overlapping or touching spans go out as one
+        int16_t spanX1 = 0;
+        int16_t spanX2 = -1;
+        int8_t winding = 0;
+        for ( uint16_t i = 0; i < n; i++ ) {
+            int16_t x1 = active[i]->x;
+            int16_t x2;
+            if ( rule == POLYGON_NONZERO ) {
+                int16_t w = winding;
+                winding += active[i]->winding;
+                if ( w != 0 || winding == 0 ) {
+                    continue;
+                }
+                while ( ++i < n ) {
+                    winding += active[i]->winding;
+                    if ( winding == 0 ) {
+                        break;
+                    }
+                }
+                if ( i >= n ) {
+                    break;
+                }
+            } else {
+                if ( ++i >= n ) {
+                    break;
+                }
+            }
+            x2 = active[i]->x;
+
+            if ( spanX1 <= spanX2 && x1 <= spanX2 + 1 ) {
+                spanX2 = max(spanX2, x2);
+            } else {
+                if ( spanX1 <= spanX2 ) {
+                    fill(color, spanX1, y, spanX2, y);
                 }
+                spanX1 = x1;
+                spanX2 = x2;
             }
         }
-        break;
+        if ( spanX1 <= spanX2 ) {
+            fill(color, spanX1, y, spanX2, y);
+        }
     }
 
     endGfxOperation();
-    return 0;
-}
-
-int8_t PixelsBase::drawCompressedBitmap(int16_t x, int16_t y, prog_uchar* data) {
 
-    if ( data == NULL ) {
-        return -1;
+    if ( activeTable == NULL ) {
+        delete[] active;
     }
+    return 0;
+}
 
-    if ( pgm_read_byte_near(data + 0) != 'Z' ) {
-        // Unknown compression method
-        return -2;
+void PixelsBase::drawPolygonEdgesAntialiased(int16_t* points, uint8_t count) {
+    for ( uint8_t i = 0; i < count; i++ ) {
+        int16_t* a = points + 2 * i;
+        int16_t* b = points + 2 * ((i + 1) % count);
+        // horizontal and vertical edges are sharp anyway
+        if ( a[0] != b[0] && a[1] != b[1] ) {
+            drawLineAntialiased(a[0], a[1], b[0], b[1]);
+        }
     }
+}
 
-    int32_t compressedLen = ((0xFF & (int32_t)pgm_read_byte_near(data + 1)) << 16) + ((0xFF & (int32_t)pgm_read_byte_near(data + 2)) << 8) + (0xFF & (int32_t)pgm_read_byte_near(data + 3));
-    if ( compressedLen < 0 ) {
-        // Unknown compression method or compressed data inconsistence
-        return -3;
+void PixelsBase::fillTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3) {
+    if ( dlRecording ) {
+        int16_t args[] = {x1, y1, x2, y2, x3, y3};
+        recordCommand(DL_FILL_TRIANGLE, args, sizeof(args));
+        return;
     }
 
-    int32_t resultLen = ((0xFF & (int32_t)pgm_read_byte_near(data + 4)) << 16) + ((0xFF & (int32_t)pgm_read_byte_near(data + 5)) << 8) + (0xFF & (int32_t)pgm_read_byte_near(data + 6));
-    if ( resultLen < 0 ) {
-        // Unknown compression method or compression format error
-        return resultLen;
+    int16_t points[] = {x1, y1, x2, y2, x3, y3};
+    beginGfxOperation();
+    fillConvex(points, 3);
+    if ( antialiasing ) {
+        drawPolygonEdgesAntialiased(points, 3);
     }
+    endGfxOperation();
+}
 
-    uint8_t windowLen = 0xFF & (int16_t)pgm_read_byte_near(data + 7);
-    if ( windowLen < 0 || windowLen > 254 ) {
-        // corrupted content
-        return -5;
+int8_t PixelsBase::fillPolygon(int16_t* points, uint8_t count, uint8_t rule) {
+    if ( dlRecording ) {
+        int16_t args[] = {count, rule};
+        recordCommand(DL_FILL_POLYGON, args, sizeof(args), &points, sizeof(points));
+        return 0;
     }
 
-    int16_t width = ((0xFF & (int32_t)pgm_read_byte_near(data + 8)) << 8) + (0xFF & (int32_t)pgm_read_byte_near(data + 9));
-    if ( width < 0 ) {
-        // Unknown compression method or compression format error (width parameter is invalid)
-        return -6;
+    if ( points == NULL || count < 3 ) {
+        return -1;
     }
 
-    int16_t height = ((0xFF & (int32_t)pgm_read_byte_near(data + 10)) << 8) + (0xFF & (int32_t)pgm_read_byte_near(data + 11));
-    if ( height < 0 ) {
-        // Unknown compression method or compression format error (height parameter is invalid)
-        return -7;
+    beginGfxOperation();
+    int8_t result = fillPoints(points, count, rule);
+    if ( antialiasing && result == 0 ) {
+        drawPolygonEdgesAntialiased(points, count);
     }
+    endGfxOperation();
+    return result;
+}
 
-    uint8_t window[windowLen];
-    int16_t wptr = 0;
-
-    int32_t ctr = 0;
+int8_t PixelsBase::fillPoints(int16_t* points, uint8_t count, uint8_t rule) {
+    int8_t result = 0;
+    if ( isConvex(points, count) ) {
+        fillConvex(points, count);
+    } else {
+        PolygonEdge* edges = new PolygonEdge[count];
+        if ( edges == NULL ) {
+            return -1;
+        }
 
-    uint8_t buf;
-    bool bufEmpty = true;
+        // the edge table is sorted by the top rows
+        uint8_t n = 0;
+        for ( uint8_t i = 0; i < count; i++ ) {
+            int16_t* a = points + 2 * i;
+            int16_t* b = points + 2 * ((i + 1) % count);
+            if ( !edges[n].set(a[0], a[1], b[0], b[1]) ) {
+                continue;
+            }
+            PolygonEdge e = edges[n];
+            uint8_t j = n++;
+            while ( j > 0 && edges[j - 1].y1 > e.y1 ) {
+                edges[j] = edges[j - 1];
+                j--;
+            }
+            edges[j] = e;
+        }
 
-    int* raster = NULL;
-    int rasterPtr = 0;
-    int rasterLine = y;
+        result = fillEdges(edges, n, rule);
+        delete[] edges;
+    }
+    return result;
+}
 
-    raster = new int[width];
+/* Paths */
+
+/* curves are halved at most this many times, into 128 pieces */
+#define PATH_MAX_DEPTH 7
+
+Path::Path(uint16_t maxPoints, uint8_t maxContours) {
+    points = new int16_t[2 * maxPoints];
+    ends = new uint16_t[maxContours];
+    closed = new boolean[maxContours];
+    capacity = points != NULL ? maxPoints : 0;
+    contourCapacity = ends != NULL && closed != NULL ? maxContours : 0;
+    edges = NULL;
+    active = NULL;
+    edgeCount = 0;
+    reset();
+}
 
-    beginGfxOperation();
+Path::~Path() {
+    delete[] points;
+    delete[] ends;
+    delete[] closed;
+    delete[] edges;
+    delete[] active;
+}
 
-    BitStream bs( data, compressedLen, 96 );
-    while ( true ) {
+void Path::reset() {
+    count = 0;
+    contours = 0;
+    penX = 0;
+    penY = 0;
+    open = false;
+    edgesValid = false;
+}
 
-        uint8_t bit = bs.readBit();
-        if ( bit == 0 ) { // literal
-            uint8_t bits = bs.readBits(8);
-            if ( bufEmpty ) {
-                buf = bits;
-                bufEmpty = false;
-            } else {
-                uint16_t px = buf;
-                px <<= 8;
-                px |= bits;
-                raster[rasterPtr++] = px;
-                if ( rasterPtr == width ) {
-                    Bounds bb(x, rasterLine, x + width - 1, rasterLine);
-                    if( transformBounds(bb) && checkBounds(bb) ) {
-                        setRegion(bb.x1, bb.y1, bb.x2, bb.y2);
-
-                        int ww = width;
-                        int corr = 0;
-                        if (bb.x1 == bb.x2) {
-                            ww = bb.y2 - bb.y1 + 1;
-                        } else {
-                            ww = bb.x2 - bb.x1 + 1;
-                        }
+/*
+ * A contour starts at the pen position with its first segment, so a lone moveTo() leaves nothing
+ */
+int8_t Path::startContour() {
+    if ( open ) {
+        return 0;
+    }
+    if ( contours >= contourCapacity || count >= capacity ) {
+        return -1;
+    }
+    points[2 * count] = penX;
+    points[2 * count + 1] = penY;
+    count++;
+    ends[contours] = count;
+    closed[contours] = false;
+    contours++;
+    open = true;
+    edgesValid = false;
+    return 0;
+}
 
-                        if (x < 0) {
-                            corr = -x;
-                            ww += corr;
-                        }
+/*
+ * Appends a point to the open contour, a repeated point is skipped
+ */
+int8_t Path::addPoint(int16_t x, int16_t y) {
+    if ( points[2 * count - 2] == x && points[2 * count - 1] == y ) {
+        return 0;
+    }
+    uint16_t start = contours > 1 ? ends[contours - 2] : 0;
+    if ( count >= capacity || count - start >= 255 ) {
+        return -1;
+    }
+    points[2 * count] = x;
+    points[2 * count + 1] = y;
+    count++;
+    ends[contours - 1] = count;
+    edgesValid = false;
+    return 0;
+}
 
-                        if ( orientation < 2 ) {
-                            for ( int i = corr; i < ww; i++ ) {
-                                setCurrentPixel(raster[i]);
-                            }
-                        } else {
-                            for ( int i = min(width, ww - 1); i >= corr; i-- ) {
-                                setCurrentPixel(raster[i]);
-                            }
-                        }
-                    }
+/*
+ * Flattens a cubic Bezier curve given in 1/16 pixels. A curve deviates from its chord by at most
+ * 3/4 of the larger second difference of the control points, a flat enough curve ends with a line,
+ * others are halved (de Casteljau). p is overwritten.
+ */
+int8_t Path::flatten(int32_t* p, uint8_t depth) {
+    int32_t d1 = abs(p[0] - 2 * p[2] + p[4]) + abs(p[1] - 2 * p[3] + p[5]);
+    int32_t d2 = abs(p[2] - 2 * p[4] + p[6]) + abs(p[3] - 2 * p[5] + p[7]);
+    if ( depth >= PATH_MAX_DEPTH || 3 * max(d1, d2) <= 16 ) {
+        return addPoint((p[6] + 8) >> 4, (p[7] + 8) >> 4);
+    }
 
-                    rasterLine++;
-                    rasterPtr = 0;
-                }
-                bufEmpty = true;
-            }
-            ctr++;
-            window[wptr++] = bits;
-            if ( wptr >= windowLen ) {
-                wptr -= windowLen;
-            }
-        } else {
-            uint8_t offset = (uint8_t)bs.readNumber() - 1;
-            uint8_t matchCount = (uint8_t)bs.readNumber() - 1;
+    int32_t left[8];
+    for ( uint8_t i = 0; i < 2; i++ ) {
+        int32_t ab = (p[i] + p[i + 2]) >> 1;
+        int32_t bc = (p[i + 2] + p[i + 4]) >> 1;
+        int32_t cd = (p[i + 4] + p[i + 6]) >> 1;
+        int32_t abc = (ab + bc) >> 1;
+        int32_t bcd = (bc + cd) >> 1;
+        left[i] = p[i];
+        left[i + 2] = ab;
+        left[i + 4] = abc;
+        left[i + 6] = (abc + bcd) >> 1;
+        p[i] = left[i + 6];
+        p[i + 2] = bcd;
+        p[i + 4] = cd;
+    }
+    if ( flatten(left, depth + 1) < 0 ) {
+        return -1;
+    }
+    return flatten(p, depth + 1);
+}
 
-            while( matchCount-- > 0 ) {
-                int16_t p1 = wptr - offset;
-                while ( p1 < 0 ) {
-                    p1 += windowLen;
-                }
-                while ( p1 >= windowLen ) {
-                    p1 -= windowLen;
-                }
-                int16_t p2 = wptr;
-                while ( p2 >= windowLen ) {
-                    p2 -= windowLen;
-                }
-                wptr++;
-                ctr++;
+int8_t Path::moveTo(int16_t x, int16_t y) {
+    open = false;
+    penX = x;
+    penY = y;
+    return 0;
+}
 
-                if ( bufEmpty ) {
-                    buf = window[p1];
-                    bufEmpty = false;
-                } else {
-                    uint16_t px = buf;
-                    px <<= 8;
-                    px |= window[p1];
+int8_t Path::lineTo(int16_t x, int16_t y) {
+    if ( startContour() < 0 ) {
+        return -1;
+    }
+    penX = x;
+    penY = y;
+    return addPoint(x, y);
+}
 
-                    raster[rasterPtr++] = px;
-                    if ( rasterPtr == width ) {
-                        Bounds bb(x, rasterLine, x + width - 1, rasterLine);
-                        if( transformBounds(bb) && checkBounds(bb) ) {
-                            setRegion(bb.x1, bb.y1, bb.x2, bb.y2);
-
-                            int corr = 0;
-                            int ww;
-                            if (bb.x1 == bb.x2) {
-                                ww = bb.y2 - bb.y1 + 1;
-                            } else {
-                                ww = bb.x2 - bb.x1 + 1;
-                            }
+int8_t Path::quadTo(int16_t cx, int16_t cy, int16_t x, int16_t y) {
+    // the same curve as a cubic one: the control points are 2/3 of the way to the quadratic one
+    int32_t x0 = (int32_t)penX * 16;
+    int32_t y0 = (int32_t)penY * 16;
+    int32_t x3 = (int32_t)x * 16;
+    int32_t y3 = (int32_t)y * 16;
+    int32_t qx = (int32_t)cx * 16;
+    int32_t qy = (int32_t)cy * 16;
+    int32_t p[] = {x0, y0, x0 + (qx - x0) * 2 / 3, y0 + (qy - y0) * 2 / 3,
+                   x3 + (qx - x3) * 2 / 3, y3 + (qy - y3) * 2 / 3, x3, y3};
+    if ( startContour() < 0 ) {
+        return -1;
+    }
+    penX = x;
+    penY = y;
+    return flatten(p, 0);
+}
 
-                            if (x < 0) {
-                                corr = -x;
-                                ww += corr;
-                            }
+int8_t Path::cubicTo(int16_t c1x, int16_t c1y, int16_t c2x, int16_t c2y, int16_t x, int16_t y) {
+    int32_t p[] = {(int32_t)penX * 16, (int32_t)penY * 16, (int32_t)c1x * 16, (int32_t)c1y * 16,
+                   (int32_t)c2x * 16, (int32_t)c2y * 16, (int32_t)x * 16, (int32_t)y * 16};
+    if ( startContour() < 0 ) {
+        return -1;
+    }
+    penX = x;
+    penY = y;
+    return flatten(p, 0);
+}
 
+void Path::close() {
+    if ( !open ) {
+        return;
+    }
+    uint16_t start = contours > 1 ? ends[contours - 2] : 0;
+    closed[contours - 1] = true;
+    open = false;
+    penX = points[2 * start];
+    penY = points[2 * start + 1];
+}
 
-                            if ( orientation < 2 ) {
-                                for ( int i = corr; i < ww; i++ ) {
-                                    setCurrentPixel(raster[i]);
-                                }
-                            } else {
-                                for ( int i = min(width, ww - 1); i >= corr; i-- ) {
-                                    setCurrentPixel(raster[i]);
-                                }
-                            }
-                        }
+int16_t* Path::getContour(uint8_t index, uint8_t& length, boolean& isClosed) {
+    uint16_t start = index > 0 ? ends[index - 1] : 0;
+    length = ends[index] - start;
+    isClosed = closed[index];
+    return points + 2 * start;
+}
 
-                        rasterLine++;
-                        rasterPtr = 0;
-                    }
-                    bufEmpty = true;
-                }
-                window[p2] = window[p1];
+int16_t Path::getEdges(PolygonEdge*& table, PolygonEdge**& activeTable) {
+    if ( !edgesValid ) {
+        if ( edges == NULL ) {
+            edges = new PolygonEdge[capacity];
+            active = new PolygonEdge*[capacity];
+            if ( edges == NULL || active == NULL ) {
+                delete[] edges;
+                delete[] active;
+                edges = NULL;
+                active = NULL;
+                return -1;
             }
+        }
 
-            while ( wptr >= windowLen ) {
-                wptr -= windowLen;
+        // the edge table is sorted by the top rows
+        edgeCount = 0;
+        for ( uint8_t c = 0; c < contours; c++ ) {
+            uint8_t n;
+            boolean isClosed;
+            int16_t* contour = getContour(c, n, isClosed);
+            for ( uint8_t i = 0; i < n; i++ ) {
+                int16_t* a = contour + 2 * i;
+                int16_t* b = contour + 2 * ((i + 1) % n);
+                if ( !edges[edgeCount].set(a[0], a[1], b[0], b[1]) ) {
+                    continue;
+                }
+                PolygonEdge e = edges[edgeCount];
+                uint16_t j = edgeCount++;
+                while ( j > 0 && edges[j - 1].y1 > e.y1 ) {
+                    edges[j] = edges[j - 1];
+                    j--;
+                }
+                edges[j] = e;
             }
         }
-        if ( ctr > resultLen ) {
-            break;
-        }
+        edgesValid = true;
     }
 
-    delete raster;
-
-    endGfxOperation();
-
-    return 0;
+    table = edges;
+    activeTable = active;
+    return edgeCount;
 }
 
+/* the end of a stroke segment, which continues with a join */
+#define LINE_CAP_JOINT 0xFF
 
-int8_t PixelsBase::loadBitmap(int16_t x, int16_t y, int16_t sx, int16_t sy, String path) {
-//    int16_t* data = loadFileBytes( path );
-    return 0; // drawBitmap(x, y, sx, sy, data);
-}
+/* the largest stroke piece: a segment with two round caps */
+#define STROKE_POINTS 40
 
-/*  -------   Antialiasing ------- */
-/* To be overriden with Pixels_Antialiasing.h */
+/* stroke pieces are built and filled in 1/16 pixels, so the sides of diagonal strokes are not rounded apart */
+#define STROKE_FINE 4
+#define STROKE_ONE (1 << STROKE_FINE)
 
-void PixelsBase::drawLineAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {}
+/* vertical samples per row and the longest blended run of antialiased fills */
+#define AA_SUB_ROWS 4
+#define AA_RUN 16
 
-void PixelsBase::drawFatLineAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {}
+static uint16_t isqrt(uint32_t v) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while ( bit > v ) {
+        bit >>= 2;
+    }
+    while ( bit != 0 ) {
+        if ( v >= root + bit ) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
 
-void PixelsBase::drawRoundRectangleAntialiased(int16_t x, int16_t y, int16_t width, int16_t height, int16_t rx, int16_t ry, boolean bordermode) {}
+/* v * s / 16384, rounded; v is a 2.14 fixed point value */
+static inline int16_t mulQ14(int32_t v, int16_t s) {
+    return (v * s + 8192) >> 14;
+}
 
-void PixelsBase::drawCircleAntialiaced( int16_t x, int16_t y, int16_t radius, boolean bordermode )	{}
+/*
+ * Mixes two RGB565 colors, weight of the second one is given in 1/256 units
+ */
+static uint16_t mixColors(uint16_t c1, uint16_t c2, uint16_t weight) {
+    uint16_t w1 = 256 - weight;
+    uint16_t r = (((c1 >> 11) & 0x1F) * w1 + ((c2 >> 11) & 0x1F) * weight) >> 8;
+    uint16_t g = (((c1 >> 5) & 0x3F) * w1 + ((c2 >> 5) & 0x3F) * weight) >> 8;
+    uint16_t b = ((c1 & 0x1F) * w1 + (c2 & 0x1F) * weight) >> 8;
+    return (r << 11) | (g << 5) | b;
+}
 
-/* TEXT */
+/*
+ * Left normal (-dy, dx) of a segment as a 2.14 fixed point unit vector
+ */
+static void unitNormal(int16_t dx, int16_t dy, int16_t& ux, int16_t& uy) {
+    while ( dx > 4095 || dx < -4095 || dy > 4095 || dy < -4095 ) {
+        dx /= 2;
+        dy /= 2;
+    }
+    // length in 1/8 pixels
+    int32_t len = isqrt(((int32_t)dx * dx + (int32_t)dy * dy) << 6);
+    ux = -(dy * 131072L) / len;
+    uy = (dx * 131072L) / len;
+}
 
+static inline void addPoint(int32_t* poly, uint8_t& n, int32_t x, int32_t y) {
+    poly[2 * n] = x;
+    poly[2 * n + 1] = y;
+    n++;
+}
 
-int PixelsBase::setFont(prog_uchar font[]) {
-    int16_t p1 = pgm_read_byte_near(font + 0);
-    int16_t p2 = pgm_read_byte_near(font + 1);
-    if ( p1 != 'Z' || p2 != 'F' ) {
-//			Serial.print("Invalid font prefix ");
-//			Serial.print( p1 );
-//			Serial.print( " " );
-//			Serial.println( p2 );
-        currentFont = NULL;
-        return -1;
+/*
+ * Appends the inner points of an arc of radius r around (cx, cy), all in 1/16 pixels, from the unit vector a to
+ * the unit vector b, which is less than a half turn away. The vector is rotated by a fixed
+ * step in the dir direction, finer steps for larger radii.
+ */
+static void addArc(int32_t* poly, uint8_t& n, int32_t cx, int32_t cy, int16_t ax, int16_t ay, int16_t bx, int16_t by, int8_t dir, int16_t r) {
+    int32_t c;
+    int32_t s;
+    if ( r <= 2 * STROKE_ONE ) {
+        c = 11585; // 45 degrees
+        s = 11585;
+    } else if ( r <= 8 * STROKE_ONE ) {
+        c = 15137; // 22.5 degrees
+        s = 6270;
+    } else {
+        c = 16069; // 11.25 degrees
+        s = 3196;
     }
-    int16_t fontType = pgm_read_byte_near(font + 2);
-    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
-//			Serial.println("Unsupported font type");
-        currentFont = NULL;
-        return -1;
+    s *= dir;
+
+    int32_t vx = ax;
+    int32_t vy = ay;
+    for ( uint8_t i = 0; i < 16; i++ ) {
+        int32_t x = (vx * c - vy * s + 8192) >> 14;
+        vy = (vx * s + vy * c + 8192) >> 14;
+        vx = x;
+        if ( (vx * by - vy * bx) * dir <= 0 ) {
+            break;
+        }
+        addPoint(poly, n, cx + mulQ14(vx, r), cy + mulQ14(vy, r));
     }
-    currentFont = font;
-    return 0;
 }
 
-void PixelsBase::print(int16_t xx, int16_t yy, String text, int8_t kerning[]) {
-    beginGfxOperation();
-    printString(xx, yy, text, 0, kerning);
-    endGfxOperation();
+/* nearest whole pixel of a 1/16 pixel coordinate, halves go up */
+static inline int16_t finePixel(int32_t v) {
+    return (v + STROKE_ONE / 2) >> STROKE_FINE;
 }
 
+/* floor division with a non-negative remainder, b > 0 */
+static inline void floorDivide(int32_t a, int32_t b, int32_t& q, int32_t& r) {
+    q = a / b;
+    r = a - q * b;
+    if ( r < 0 ) {
+        q--;
+        r += b;
+    }
+}
 
-#ifndef NO_TEXT_WRAP
-int16_t PixelsBase::computeBreakPos(String text, int16_t t) {
-    int16_t breakPos = -1;
-    String s = t == 0 ? text : text.substring(t, text.length());
-    int16_t w = getTextWidth(s);
-    if ( w + caretX > width - textWrapMarginRight || text.indexOf('\n') >= 0 ) {
-        char prev = 0;
-        w = 0;
-        for ( uint16_t j = t; j < text.length(); j++ ) {
-            char cc = text.charAt(j);
-            w += getCharWidth(cc);
-            if ( (cc == ' ' && prev != ' ') || (cc == '\n' && breakPos >= 0) ) {
-                if ( caretX + w > width - textWrapMarginRight ) {
-                    break;
-                } else {
-                    breakPos = j;
-                    if ( cc == '\n' ) {
-                        break;
-                    }
-                }
-            } else if ( cc == '\n' ) {
-                breakPos = j;
-                break;
+/*
+ * Edge of a stroke piece going down from (xa, ya) to (xb, yb) in 1/16 pixels. The exact x at
+ * the height y is x + r / dy; a row down adds xStep + rStep / dy, as PolygonEdge does.
+ */
+class FineEdge {
+public:
+    int32_t xa;
+    int32_t ya;
+    int32_t yb;
+    int32_t dx;
+    int32_t dy;
+
+    int32_t y;
+    int32_t x;
+    int32_t r;
+    int32_t xStep;
+    int32_t rStep;
+
+    void set(int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+        xa = x1;
+        ya = y1;
+        yb = y2;
+        dx = x2 - x1;
+        dy = y2 - y1;
+        if ( dy > 0 ) {
+            floorDivide(dx * STROKE_ONE, dy, xStep, rStep);
+        }
+        y = ya;
+        x = xa;
+        r = 0;
+    }
+
+    void moveTo(int32_t yy) {
+        if ( dy == 0 || yy == y ) {
+            return;
+        }
+        if ( yy == y + STROKE_ONE ) {
+            x += xStep;
+            r += rStep;
+            if ( r >= dy ) {
+                r -= dy;
+                x++;
             }
-            prev = cc;
+        } else {
+            // whole rows and the fraction of a row are accumulated apart, so nothing overflows
+            int32_t t = yy - ya;
+            int32_t q0;
+            int32_t r0;
+            floorDivide((t & (STROKE_ONE - 1)) * dx, dy, q0, r0);
+            uint32_t rr = (uint32_t)r0 + (uint32_t)(t >> STROKE_FINE) * rStep;
+            x = xa + q0 + (t >> STROKE_FINE) * xStep + (int32_t)(rr / dy);
+            r = rr % dy;
         }
+        y = yy;
     }
-    return breakPos;
-}
-#endif
+};
 
-void PixelsBase::cleanText(int16_t xx, int16_t yy, String text, int8_t kerning[]) {
-    beginGfxOperation();
-    printString(xx, yy, text, 1, kerning);
-    endGfxOperation();
-}
+/*
+ * Fills a convex stroke piece given in 1/16 pixels: the pixels with centers within the piece, or
+ * on its border, are covered. So a piece within another one never covers a pixel, which the larger
+ * one leaves out, and pieces sharing an edge leave no gap.
+ */
+void PixelsBase::fillConvexFine(int32_t* points, uint8_t count) {
 
-void PixelsBase::printString(int16_t xx, int16_t yy, String text, boolean clean, int8_t kerning[]) {
+    uint8_t top = 0;
+    uint8_t bottom = 0;
+    for ( uint8_t i = 1; i < count; i++ ) {
+        if ( points[2 * i + 1] < points[2 * top + 1] ) {
+            top = i;
+        }
+        if ( points[2 * i + 1] > points[2 * bottom + 1] ) {
+            bottom = i;
+        }
+    }
 
-    if ( currentFont == NULL ) {
+    int32_t yTop = points[2 * top + 1];
+    int32_t yBottom = points[2 * bottom + 1];
+    int color = foreground->convertTo565();
+
+    Bounds area = visibleArea();
+    int16_t y1 = max((int16_t)((yTop + STROKE_ONE - 1) >> STROKE_FINE), area.y1);
+    int16_t y2 = min((int16_t)(yBottom >> STROKE_FINE), area.y2);
+    if ( y1 > y2 ) {
         return;
     }
 
-    int16_t fontType = pgm_read_byte_near(currentFont + 2);
-    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
+    if ( yTop == yBottom ) {
+        int32_t x1 = points[0];
+        int32_t x2 = points[0];
+        for ( uint8_t i = 1; i < count; i++ ) {
+            x1 = min(x1, points[2 * i]);
+            x2 = max(x2, points[2 * i]);
+        }
+        if ( ((x1 + STROKE_ONE - 1) >> STROKE_FINE) <= (x2 >> STROKE_FINE) ) {
+            fill(color, (x1 + STROKE_ONE - 1) >> STROKE_FINE, y1, x2 >> STROKE_FINE, y1);
+        }
         return;
     }
 
-    RGB* fg = foreground;
+    FineEdge edges[2];
+    uint8_t ends[2] = {top, top};
+    int8_t dirs[2] = {1, (int8_t)(count - 1)};
+    edges[0].set(points[2 * top], yTop, points[2 * top], yTop);
+    edges[1] = edges[0];
 
-    int16_t kernPtr = 0;
-    int16_t kern = -100; // no kerning
+    int16_t spanX1 = 0;
+    int16_t spanX2 = -1;
+    int16_t spanY = y1;
 
-    int16_t glyphHeight = pgm_read_byte_near(currentFont + 3);
+    beginGfxOperation();
 
-    caretX = xx;
-    caretY = yy;
+    for ( int16_t y = y1; y <= y2; y++ ) {
+        int32_t yf = (int32_t)y * STROKE_ONE;
+        for ( uint8_t c = 0; c < 2; c++ ) {
+            FineEdge& e = edges[c];
+            // next edge of the chain, horizontal edges are skipped
+            while ( (e.yb < yf || e.dy == 0) && ends[c] != bottom ) {
+                uint8_t from = ends[c];
+                ends[c] = (ends[c] + dirs[c]) % count;
+                e.set(points[2 * from], points[2 * from + 1], points[2 * ends[c]], points[2 * ends[c] + 1]);
+            }
+            e.moveTo(yf);
+        }
 
-    int16_t glyphWidth = 0;
-    int breakPos = -1;
+        // the exact x is x + r / dy: a pixel center at or right of it is at or right of x + 1, unless r is 0
+        uint8_t left = edges[0].x + (edges[0].r > 0) <= edges[1].x + (edges[1].r > 0) ? 0 : 1;
+        int16_t x1 = (edges[left].x + (edges[left].r > 0) + STROKE_ONE - 1) >> STROKE_FINE;
+        int16_t x2 = edges[1 - left].x >> STROKE_FINE;
+        if ( x1 > x2 ) {
+            // no pixel center within the row of a thin sliver
+            x2 = x1 - 1;
+        }
+        if ( x1 != spanX1 || x2 != spanX2 ) {
+            if ( spanX1 <= spanX2 ) {
+                fill(color, spanX1, spanY, spanX2, y - 1);
+            }
+            spanX1 = x1;
+            spanX2 = x2;
+            spanY = y;
+        }
+    }
+    if ( spanX1 <= spanX2 && spanY <= y2 ) {
+        fill(color, spanX1, spanY, spanX2, y2);
+    }
 
-#ifndef NO_TEXT_WRAP
-    boolean relOrigin = isOriginRelative();
-    if ( wrapText ) {
-        breakPos = computeBreakPos(text, 0);
+    endGfxOperation();
+}
+
+/*
+ * Antialiased edge of a stroke piece between two points given in 1/16 pixels
+ */
+void PixelsBase::drawFineEdgeAntialiased(int32_t* p, int32_t* q) {
+    int16_t x1 = finePixel(p[0]);
+    int16_t y1 = finePixel(p[1]);
+    int16_t x2 = finePixel(q[0]);
+    int16_t y2 = finePixel(q[1]);
+    if ( x1 != x2 && y1 != y2 ) {
+        drawLineAntialiased(x1, y1, x2, y2);
     }
-#endif
+}
 
-    for (uint16_t t = 0; t < text.length(); t++) {
-        char c = text.charAt(t);
+/*
+ * Strokes wider than one pixel are w pixels wide: they cover (w - 1) / 2 pixels to the left of the
+ * path and the rest to the right, so the sides are half a pixel beyond the outermost pixel centers.
+ */
+int16_t PixelsBase::strokeWidth() {
+    int16_t w = (int16_t)(lineWidth + 0.5);
+    return w < 1 ? 1 : w;
+}
 
-#ifndef NO_TEXT_WRAP
-        if ( t == breakPos ) {
-            if ( c == ' ' || c == '\n' ) {
-                breakPos++;
-                continue;
-            }
-            caretX = textWrapMarginLeft;
-            caretY = caretY + glyphHeight + textWrapLineGap;
-            if ( textWrapScroll && (orientation == PORTRAIT_FLIP || orientation == PORTRAIT) &&
-                    caretY + glyphHeight + textWrapMarginBottom > height ) {
+/*
+ * Fills the body of a thick segment from a to b with its caps as a single convex polygon.
+ * Caps marked as LINE_CAP_JOINT are butt ends covered by the neighbor segment and a join,
+ * so they get no antialiased edge.
+ */
+void PixelsBase::strokeSegment(int16_t* a, int16_t* b, int16_t ux, int16_t uy, uint8_t startCap, uint8_t endCap) {
+    int16_t w = strokeWidth();
+    int16_t hl = ((w - 1) >> 1) * STROKE_ONE + STROKE_ONE / 2;
+    int16_t hr = w * STROKE_ONE - hl;
+
+    // unit direction is the normal turned back by a quarter
+    int16_t ex = uy;
+    int16_t ey = -ux;
+
+    int32_t sx = (int32_t)a[0] * STROKE_ONE;
+    int32_t sy = (int32_t)a[1] * STROKE_ONE;
+    int32_t tx = (int32_t)b[0] * STROKE_ONE;
+    int32_t ty = (int32_t)b[1] * STROKE_ONE;
+    // caps extend by half of the width; round ones are centered on the middle of the body, which
+    // is half a pixel to the right of the path for even widths, so they start and end at the body sides
+    int16_t h = (hl + hr) >> 1;
+    int32_t mx = mulQ14(ux, hl - h);
+    int32_t my = mulQ14(uy, hl - h);
+    if ( startCap == LINE_CAP_SQUARE ) {
+        sx -= mulQ14(ex, h);
+        sy -= mulQ14(ey, h);
+    }
+    if ( endCap == LINE_CAP_SQUARE ) {
+        tx += mulQ14(ex, h);
+        ty += mulQ14(ey, h);
+    }
 
-                RGB* sav = NULL;
-                if ( textWrapScrollFill != NULL ) {
-                    sav = getBackground();
-                    setBackground(textWrapScrollFill);
-                }
-                scroll(-(height - caretY - glyphHeight - textWrapMarginBottom), SCROLL_SMOOTH | SCROLL_CLEAN);
-                if ( sav != NULL ) {
-                    setBackground(sav);
-                }
-                setOriginAbsolute();
+    int32_t poly[2 * STROKE_POINTS];
+    uint8_t n = 0;
+    addPoint(poly, n, sx + mulQ14(ux, hl), sy + mulQ14(uy, hl));
+    addPoint(poly, n, tx + mulQ14(ux, hl), ty + mulQ14(uy, hl));
+    if ( endCap == LINE_CAP_ROUND ) {
+        addArc(poly, n, tx + mx, ty + my, ux, uy, ex, ey, -1, h);
+        addPoint(poly, n, tx + mx + mulQ14(ex, h), ty + my + mulQ14(ey, h));
+        addArc(poly, n, tx + mx, ty + my, ex, ey, -ux, -uy, -1, h);
+    }
+    addPoint(poly, n, tx - mulQ14(ux, hr), ty - mulQ14(uy, hr));
+    addPoint(poly, n, sx - mulQ14(ux, hr), sy - mulQ14(uy, hr));
+    if ( startCap == LINE_CAP_ROUND ) {
+        addArc(poly, n, sx + mx, sy + my, -ux, -uy, -ex, -ey, -1, h);
+        addPoint(poly, n, sx + mx - mulQ14(ex, h), sy + my - mulQ14(ey, h));
+        addArc(poly, n, sx + mx, sy + my, -ex, -ey, ux, uy, -1, h);
+    }
 
-                caretY = height - glyphHeight - textWrapMarginBottom;
+    fillConvexFine(poly, n);
+
+    if ( antialiasing ) {
+        for ( uint8_t i = 0; i < n; i++ ) {
+            if ( (i == 1 && endCap == LINE_CAP_JOINT) || (i == n - 1 && startCap == LINE_CAP_JOINT) ) {
+                continue;
             }
-            breakPos = computeBreakPos(text, t);
+            drawFineEdgeAntialiased(poly + 2 * i, poly + 2 * ((i + 1) % n));
         }
+    }
+}
 
-        boolean repeat = false;
-#endif
-
-        boolean found = false;
-        int16_t ptr = HEADER_LENGTH;
-        while ( 1 ) {
-            char cx = (char)(((int)pgm_read_byte_near(currentFont + ptr + 0) << 8) + pgm_read_byte_near(currentFont + ptr + 1));
-            if ( cx == 0 ) {
-              break;
-            }
-            int16_t length = (((int)(pgm_read_byte_near(currentFont + ptr + 2) & 0xff) << 8) + (int)(pgm_read_byte_near(currentFont + ptr + 3) & 0xff));
-
-            if ( cx == c ) {
-                if ( length < 8 ) {
-//						Serial.print( "Invalid "  );
-//						Serial.print( c );
-//						Serial.println( " glyph definition. Font corrupted?" );
-                    break;
-                }
+/*
+ * Fills the gap at the outer side of a corner v between a segment with the normal pu and the
+ * next one with the normal u. The inner side is covered by the overlapping segments.
+ */
+void PixelsBase::strokeJoin(int16_t* v, int16_t pux, int16_t puy, int16_t ux, int16_t uy) {
+    int32_t cross = (int32_t)pux * uy - (int32_t)puy * ux;
+    int32_t dot = ((int32_t)pux * ux + (int32_t)puy * uy) >> 14;
+    if ( cross == 0 && dot > 0 ) {
+        return;
+    }
 
-                glyphWidth = 0xff & pgm_read_byte_near(currentFont + ptr + 4);
-                found = true;
+    int16_t w = strokeWidth();
+    int16_t hl = ((w - 1) >> 1) * STROKE_ONE + STROKE_ONE / 2;
+    int16_t hr = w * STROKE_ONE - hl;
+
+    // a turn to the left has its outer side at the right
+    int8_t dir = cross > 0 ? 1 : -1;
+    int16_t h = hl;
+    if ( cross > 0 ) {
+        h = hr;
+        pux = -pux;
+        puy = -puy;
+        ux = -ux;
+        uy = -uy;
+    }
+    int32_t vx = (int32_t)v[0] * STROKE_ONE;
+    int32_t vy = (int32_t)v[1] * STROKE_ONE;
+
+    int32_t poly[2 * STROKE_POINTS];
+    uint8_t n = 0;
+    addPoint(poly, n, vx, vy);
+    addPoint(poly, n, vx + mulQ14(pux, h), vy + mulQ14(puy, h));
+    if ( cross == 0 ) {
+        // turning back: only a round join has something to add
+        if ( lineJoin != LINE_JOIN_ROUND ) {
+            return;
+        }
+        addArc(poly, n, vx, vy, pux, puy, puy, -pux, -1, h);
+        addPoint(poly, n, vx + mulQ14(puy, h), vy - mulQ14(pux, h));
+        addArc(poly, n, vx, vy, puy, -pux, ux, uy, -1, h);
+    } else if ( lineJoin == LINE_JOIN_ROUND ) {
+        addArc(poly, n, vx, vy, pux, puy, ux, uy, dir, h);
+    } else if ( lineJoin == LINE_JOIN_MITER ) {
+        // the miter tip is at (pu + u) * h / (1 + pu.u); limited to 4 widths
+        int32_t denom = 16384 + dot;
+        if ( denom >= 2048 ) {
+            int32_t mx = ((int32_t)pux + ux) * h * 2;
+            int32_t my = ((int32_t)puy + uy) * h * 2;
+            addPoint(poly, n, vx + (mx + (mx < 0 ? -denom : denom)) / (2 * denom),
+                    vy + (my + (my < 0 ? -denom : denom)) / (2 * denom));
+        }
+    }
+    addPoint(poly, n, vx + mulQ14(ux, h), vy + mulQ14(uy, h));
 
-#ifndef NO_TEXT_WRAP
-                if ( wrapText && caretX + glyphWidth > width - textWrapMarginRight ) {
-                    breakPos = t;
-                    repeat = true;
-                    break;
-                }
-#endif
+    fillConvexFine(poly, n);
 
-                drawGlyph(fontType, clean, caretX, caretY, glyphHeight, currentFont + ptr, length);
-                break;
-            }
-            ptr += length;
+    if ( antialiasing ) {
+        for ( uint8_t i = 1; i < n - 1; i++ ) {
+            drawFineEdgeAntialiased(poly + 2 * i, poly + 2 * i + 2);
         }
+    }
+}
 
-#ifndef NO_TEXT_WRAP
-        if ( repeat ) {
-            t--;
-            continue;
-        }
-#endif
+/*
+ * Draws a thick polyline as convex pieces: a segment body with its caps and an outer join
+ * wedge per corner. Repeated vertices are skipped.
+ */
+void PixelsBase::strokePolyline(int16_t* points, uint8_t count, boolean closed) {
+    uint8_t n = count;
+    while ( closed && n > 1 && points[2 * n - 2] == points[0] && points[2 * n - 1] == points[1] ) {
+        n--;
+    }
 
-        if ( kerning != NULL && kerning[kernPtr] > -100 ) {
-            kern = kerning[kernPtr];
-            if (kerning[kernPtr+1] > -100) {
-                kernPtr++;
-            }
+    int16_t* a = points;
+    uint8_t j = 1;
+    while ( j < n && points[2 * j] == a[0] && points[2 * j + 1] == a[1] ) {
+        j++;
+    }
+    if ( j >= n ) {
+        // a single point has no direction: round and square caps make a dot
+        int16_t w = strokeWidth();
+        int16_t hl = (w - 1) >> 1;
+        int16_t hr = w - 1 - hl;
+        if ( lineCap == LINE_CAP_SQUARE ) {
+            fill(foreground->convertTo565(), a[0] - hr, a[1] - hr, a[0] + hl, a[1] + hl);
+        } else if ( lineCap == LINE_CAP_ROUND ) {
+            // centered as the square dot, which is half a pixel up and left for even widths
+            int32_t cx = (int32_t)a[0] * STROKE_ONE + (hl - hr) * STROKE_ONE / 2;
+            int32_t cy = (int32_t)a[1] * STROKE_ONE + (hl - hr) * STROKE_ONE / 2;
+            int16_t r = w * STROKE_ONE / 2;
+            int32_t dot[2 * STROKE_POINTS];
+            uint8_t m = 0;
+            addPoint(dot, m, cx + r, cy);
+            addArc(dot, m, cx, cy, 16384, 0, 0, 16384, 1, r);
+            addPoint(dot, m, cx, cy + r);
+            addArc(dot, m, cx, cy, 0, 16384, -16384, 0, 1, r);
+            addPoint(dot, m, cx - r, cy);
+            addArc(dot, m, cx, cy, -16384, 0, 0, -16384, 1, r);
+            addPoint(dot, m, cx, cy - r);
+            addArc(dot, m, cx, cy, 0, -16384, 16384, 0, 1, r);
+            fillConvexFine(dot, m);
         }
+        return;
+    }
 
-        if ( found ) {
-            caretX += glyphWidth;
-            if ( kern > -100 ) {
-                caretX += kern;
+    int16_t ux0 = 0;
+    int16_t uy0 = 0;
+    int16_t pux = 0;
+    int16_t puy = 0;
+    boolean first = true;
+    while ( true ) {
+        int16_t* b = points + 2 * j;
+        uint8_t k = j + 1;
+        while ( k < n && points[2 * k] == b[0] && points[2 * k + 1] == b[1] ) {
+            k++;
+        }
+        boolean last = k >= n;
+
+        int16_t ux;
+        int16_t uy;
+        unitNormal(b[0] - a[0], b[1] - a[1], ux, uy);
+        if ( first ) {
+            ux0 = ux;
+            uy0 = uy;
+        } else {
+            strokeJoin(a, pux, puy, ux, uy);
+        }
+        strokeSegment(a, b, ux, uy, closed || !first ? LINE_CAP_JOINT : lineCap, closed || !last ? LINE_CAP_JOINT : lineCap);
+
+        if ( last ) {
+            if ( closed ) {
+                int16_t cux;
+                int16_t cuy;
+                unitNormal(points[0] - b[0], points[1] - b[1], cux, cuy);
+                strokeJoin(b, ux, uy, cux, cuy);
+                strokeSegment(b, points, cux, cuy, LINE_CAP_JOINT, LINE_CAP_JOINT);
+                strokeJoin(points, cux, cuy, ux0, uy0);
             }
+            break;
         }
-    }
 
-#ifndef NO_TEXT_WRAP
-    if ( relOrigin ) {
-        setOriginRelative();
-    } else {
-        setOriginAbsolute();
+        pux = ux;
+        puy = uy;
+        a = b;
+        j = k;
+        first = false;
     }
-#endif
-
-    setColor(fg);
 }
 
-int16_t PixelsBase::getTextLineHeight() {
-    if ( currentFont == NULL ) {
-        return 0;
+/*
+ * Returns the span of a round rectangle (x1, y1) - (x2, y2) with corner radii rx and ry at row y.
+ * Pixel centers within half a pixel out of the corner ellipses count.
+ */
+static boolean roundRectangleSpan(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry, int16_t y, int16_t& xa, int16_t& xb) {
+    if ( y < y1 || y > y2 ) {
+        return false;
     }
-
-//    int16_t fontType = pgm_read_byte_near(currentFont + 2);
-//    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
-//        return 0;
-//    }
-
-    return pgm_read_byte_near(currentFont + 3);
+    int16_t dy = 0;
+    if ( y < y1 + ry ) {
+        dy = y1 + ry - y;
+    } else if ( y > y2 - ry ) {
+        dy = y - y2 + ry;
+    }
+    int16_t half = rx;
+    if ( dy > 0 ) {
+        // in half pixels: half = (2 rx + 1) * sqrt(b^2 - d^2) / b / 2
+        int32_t b = 2 * ry + 1;
+        int32_t d = 2 * dy;
+        half = (int32_t)(2 * rx + 1) * isqrt((b * b - d * d) << 8) / (b << 5);
+    }
+    xa = x1 + rx - half;
+    xb = x2 - rx + half;
+    return true;
 }
 
-int16_t PixelsBase::getTextBaseline() {
-    if ( currentFont == NULL ) {
-        return 0;
-    }
+/*
+ * Draws a thick outline of a round rectangle (or an oval with radii of the half sizes) as
+ * up to two spans per row between the outer and the inner boundary.
+ */
+void PixelsBase::strokeRoundRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry) {
+    int16_t w = strokeWidth();
+    int16_t hi = (w - 1) >> 1;
+    int16_t ho = w - 1 - hi;
 
-//    int16_t fontType = pgm_read_byte_near(currentFont + 2);
-//    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
-//        return 0;
-//    }
+    fillRoundRing(x1, y1, x2, y2, rx, ry, ho, hi + 1, NULL, foreground->convertTo565());
 
-    return pgm_read_byte_near(currentFont + 4);
+    if ( antialiasing ) {
+        if ( rx + ho > 0 && ry + ho > 0 ) {
+            drawRoundRectangleAntialiased(x1 - ho, y1 - ho, x2 - x1 + 2 * ho, y2 - y1 + 2 * ho, rx + ho, ry + ho, false);
+        }
+        // both edges are blended half a pixel into the stroke
+        int16_t ix1 = x1 + hi + 1;
+        int16_t iy1 = y1 + hi + 1;
+        int16_t ix2 = x2 - hi - 1;
+        int16_t iy2 = y2 - hi - 1;
+        int16_t irx = min(rx - hi - 1, (ix2 - ix1) >> 1);
+        int16_t iry = min(ry - hi - 1, (iy2 - iy1) >> 1);
+        if ( ix1 <= ix2 && iy1 <= iy2 && irx > 0 && iry > 0 ) {
+            drawRoundRectangleAntialiased(ix1 - 1, iy1 - 1, ix2 - ix1 + 2, iy2 - iy1 + 2, irx + 1, iry + 1, false);
+        }
+    }
 }
 
-int16_t PixelsBase::getCharWidth(char c) {
-    if ( currentFont == NULL ) {
-        return 0;
+/* sin(0..90 degrees) in 2.14 fixed point */
+static const uint16_t sineTable[] PROGMEM = {
+    0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+    2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+    5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+    8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384
+};
+
+static void angleVector(int16_t angle, int32_t& c, int32_t& s) {
+    angle %= 360;
+    if ( angle < 0 ) {
+        angle += 360;
     }
+    int32_t sa = pgm_read_word(sineTable + angle % 90);
+    int32_t ca = pgm_read_word(sineTable + 90 - angle % 90);
+    switch ( angle / 90 ) {
+    case 0:
+        c = ca;
+        s = sa;
+        break;
+    case 1:
+        c = -sa;
+        s = ca;
+        break;
+    case 2:
+        c = -ca;
+        s = -sa;
+        break;
+    default:
+        c = sa;
+        s = -ca;
+    }
+}
 
-    int16_t ptr = HEADER_LENGTH;
-    while ( 1 ) {
-        char cx = (char)(((int)pgm_read_byte_near(currentFont + ptr + 0) << 8) + pgm_read_byte_near(currentFont + ptr + 1));
-        if ( cx == 0 ) {
-          break;
-        }
-        int16_t length = (((int)(pgm_read_byte_near(currentFont + ptr + 2) & 0xff) << 8) + (int)(pgm_read_byte_near(currentFont + ptr + 3) & 0xff));
-
-        if ( cx == c ) {
-            if ( length < 8 ) {
-//						Serial.print( "Invalid "  );
-//						Serial.print( c );
-//						Serial.println( " glyph definition. Font corrupted?" );
-                break;
-            }
-//                Serial.print( c );
-
-            return 0xff & pgm_read_byte_near(currentFont + ptr + 4);
-        }
+static inline int16_t clampRow(int32_t v) {
+    return v < -32766 ? -32766 : v > 32766 ? 32766 : v;
+}
 
-        ptr += length;
+/*
+ * Pixels with k * dx <= m as an interval; -32767 and 32767 stand for no bound, lo > hi for none
+ */
+static void halfLine(int32_t k, int32_t m, int16_t& lo, int16_t& hi) {
+    lo = -32767;
+    hi = 32767;
+    if ( k > 0 ) {
+        hi = clampRow(m >= 0 ? m / k : -((-m + k - 1) / k));
+    } else if ( k < 0 ) {
+        k = -k;
+        m = -m;
+        lo = clampRow(m >= 0 ? (m + k - 1) / k : -(-m / k));
+    } else if ( m < 0 ) {
+        lo = 1;
+        hi = 0;
     }
-
-    return 0;
 }
 
-int16_t PixelsBase::getTextWidth(String text, int8_t kerning[]) {
-    if ( currentFont == NULL ) {
-        return 0;
+static void complement(int16_t& lo, int16_t& hi) {
+    if ( lo > hi ) {
+        lo = -32767;
+        hi = 32767;
+    } else if ( lo == -32767 && hi == 32767 ) {
+        lo = 1;
+        hi = 0;
+    } else if ( lo == -32767 ) {
+        lo = hi + 1;
+        hi = 32767;
+    } else {
+        hi = lo - 1;
+        lo = -32767;
     }
+}
 
-    int16_t kernPtr = 0;
-    int16_t kern = -100; // no kerning
-    int16_t x1 = 0;
+void ArcSector::set(int16_t x, int16_t y, int16_t rx, int16_t ry, int16_t startAngle, int16_t arcAngle, boolean openFirst, boolean openLast) {
+    cx = x;
+    cy = y;
+    openStart = openFirst ? 1 : 0;
+    openEnd = openLast ? 1 : 0;
+    if ( arcAngle < 0 ) {
+        startAngle += arcAngle;
+        arcAngle = -arcAngle;
+        openStart = openLast ? 1 : 0;
+        openEnd = openFirst ? 1 : 0;
+    }
+    reflex = arcAngle > 180;
+
+    int16_t r = max(max(rx, ry), 1);
+    int32_t c;
+    int32_t s;
+    angleVector(startAngle, c, s);
+    ax = c * rx / r;
+    ay = s * ry / r;
+    angleVector(startAngle + arcAngle, c, s);
+    bx = c * rx / r;
+    by = s * ry / r;
+}
 
-    for (uint16_t t = 0; t < text.length(); t++) {
-        char c = text.charAt(t);
+/*
+ * A point is on the left of the start direction and on the right of the end direction. The two
+ * half-planes intersect for arcs up to a half turn, larger arcs are their union, which leaves
+ * one interval of the row out.
+ */
+boolean ArcSector::row(int16_t y, int16_t& lo, int16_t& hi) {
+    int32_t my = cy - y;
+    int16_t l1;
+    int16_t h1;
+    int16_t l2;
+    int16_t h2;
+    halfLine(ay, ax * my - openStart, l1, h1);
+    halfLine(-by, -bx * my - openEnd, l2, h2);
+    if ( reflex ) {
+        complement(l1, h1);
+        complement(l2, h2);
+    }
+    lo = clampRow((int32_t)max(l1, l2) + cx);
+    hi = clampRow((int32_t)min(h1, h2) + cx);
+    if ( max(l1, l2) == -32767 ) {
+        lo = -32767;
+    }
+    if ( min(h1, h2) == 32767 ) {
+        hi = 32767;
+    }
+    // the center is on both rays, an open ray leaves it out
+    if ( reflex && my == 0 && (openStart || openEnd) ) {
+        if ( lo > hi ) {
+            lo = cx;
+            hi = cx;
+        } else {
+            lo = min(lo, cx);
+            hi = max(hi, cx);
+        }
+    }
+    return !reflex;
+}
 
-        int16_t width = 0;
-        boolean found = false;
-        int16_t ptr = HEADER_LENGTH;
-        while ( 1 ) {
-            char cx = (char)(((int)pgm_read_byte_near(currentFont + ptr + 0) << 8) + pgm_read_byte_near(currentFont + ptr + 1));
-            if ( cx == 0 ) {
-              break;
+/*
+ * Fills a round rectangle (x1, y1) - (x2, y2) with corner radii rx and ry, grown by outer pixels,
+ * without the hole of the same shape shrunk by inner pixels (none if inner < 1), optionally limited
+ * to an angular range. Every row gets up to four spans, rows with equal spans are merged into rectangles.
+ * If halfWidths is given, the outer shape is the oval of fillOval() instead, see ovalHalfWidths().
+ */
+void PixelsBase::fillRoundRing(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry, int16_t outer, int16_t inner, ArcSector* sector, int color, int16_t* halfWidths) {
+    int16_t ox1 = x1 - outer;
+    int16_t oy1 = y1 - outer;
+    int16_t ox2 = x2 + outer;
+    int16_t oy2 = y2 + outer;
+    int16_t orx = rx + outer;
+    int16_t ory = ry + outer;
+
+    int16_t ix1 = x1 + inner;
+    int16_t iy1 = y1 + inner;
+    int16_t ix2 = x2 - inner;
+    int16_t iy2 = y2 - inner;
+    int16_t irx = max(0, min(rx - inner, (ix2 - ix1) >> 1));
+    int16_t iry = max(0, min(ry - inner, (iy2 - iy1) >> 1));
+    boolean hole = inner > 0 && ix1 <= ix2 && iy1 <= iy2;
+
+    Bounds area = visibleArea();
+    int16_t top = max(oy1, area.y1);
+    int16_t bottom = min(oy2, area.y2);
+
+    int16_t pa[4];
+    int16_t pb[4];
+    uint8_t pn = 0;
+    int16_t py = top;
+    for ( int16_t y = top; y <= bottom + 1; y++ ) {
+        int16_t sa[4];
+        int16_t sb[4];
+        uint8_t sn = 0;
+        int16_t a;
+        int16_t b;
+        boolean inside = y <= bottom;
+        if ( inside && halfWidths != NULL ) {
+            int16_t half = halfWidths[abs(y - oy1 - ory)];
+            a = ox1 + orx - half;
+            b = ox1 + orx + half;
+            inside = half >= 0;
+        } else if ( inside ) {
+            inside = roundRectangleSpan(ox1, oy1, ox2, oy2, orx, ory, y, a, b);
+        }
+        if ( inside ) {
+            int16_t ra[2];
+            int16_t rb[2];
+            uint8_t rn = 1;
+            int16_t c;
+            int16_t d;
+            ra[0] = a;
+            rb[0] = b;
+            if ( hole && roundRectangleSpan(ix1, iy1, ix2, iy2, irx, iry, y, c, d) ) {
+                rb[0] = c - 1;
+                ra[1] = d + 1;
+                rb[1] = b;
+                rn = 2;
             }
-            int16_t length = (((int)(pgm_read_byte_near(currentFont + ptr + 2) & 0xff) << 8) + (int)(pgm_read_byte_near(currentFont + ptr + 3) & 0xff));
 
-            if ( cx == c ) {
-                if ( length < 8 ) {
-//						Serial.print( "Invalid "  );
-//						Serial.print( c );
-//						Serial.println( " glyph definition. Font corrupted?" );
-                    break;
+            int16_t lo = -32767;
+            int16_t hi = 32767;
+            boolean keep = true;
+            if ( sector != NULL ) {
+                keep = sector->row(y, lo, hi);
+            }
+            for ( uint8_t k = 0; k < rn; k++ ) {
+                if ( keep ) {
+                    sa[sn] = max(ra[k], lo);
+                    sb[sn] = min(rb[k], hi);
+                    if ( sa[sn] <= sb[sn] ) {
+                        sn++;
+                    }
+                } else {
+                    if ( ra[k] < lo ) {
+                        sa[sn] = ra[k];
+                        sb[sn] = min(rb[k], lo - 1);
+                        sn++;
+                    }
+                    if ( rb[k] > hi ) {
+                        sa[sn] = max(ra[k], hi + 1);
+                        sb[sn] = rb[k];
+                        sn++;
+                    }
                 }
-//                Serial.print( c );
-                found = true;
-                width = 0xff & pgm_read_byte_near(currentFont + ptr + 4);
             }
-
-            ptr += length;
         }
 
-        if ( kerning != NULL && kerning[kernPtr] > -100 ) {
-            kern = kerning[kernPtr];
-            if (kerning[kernPtr+1] > -100) {
-                kernPtr++;
+        boolean same = sn == pn;
+        for ( uint8_t k = 0; same && k < sn; k++ ) {
+            same = sa[k] == pa[k] && sb[k] == pb[k];
+        }
+        if ( !same ) {
+            for ( uint8_t k = 0; k < pn; k++ ) {
+                fill(color, pa[k], py, pb[k], y - 1);
+            }
+            for ( uint8_t k = 0; k < sn; k++ ) {
+                pa[k] = sa[k];
+                pb[k] = sb[k];
             }
+            pn = sn;
+            py = y;
         }
+    }
+}
 
-        if ( found ) {
-            x1 += width;
-            if ( kern > -100 ) {
-                x1+= kern;
+/*
+ * Coverage of the pixel column c (in 1/16 pixels) by the sub-rows of an antialiased round rectangle
+ * row, 16 per sub-row at most; half is negative for sub-rows out of the shape.
+ */
+static uint8_t roundRectangleCoverage(int32_t c, int32_t cl, int32_t cr, int32_t* half) {
+    uint8_t coverage = 0;
+    for ( uint8_t s = 0; s < AA_SUB_ROWS; s++ ) {
+        if ( half[s] >= 0 ) {
+            int32_t l = max(c - 8, cl - half[s]);
+            int32_t r = min(c + 8, cr + half[s]);
+            if ( r > l ) {
+                coverage += r - l;
             }
         }
     }
-
-    return x1;
+    return coverage;
 }
 
-void PixelsBase::drawGlyph(int16_t fontType, boolean clean, int16_t xx, int16_t yy,
-                           int16_t glyphHeight, prog_uchar* data, int16_t length) {
+/*
+ * Fills a round rectangle (x1, y1) - (x2, y2) with corner radii rx and ry (an oval if the radii are
+ * the half sizes) with antialiased edges. The boundary lies half a pixel out of the corner ellipses
+ * like in roundRectangleSpan(); its coverage is sampled on four sub-rows per row in 1/16 pixels.
+ * Every pixel is written once: blended edge runs around one interior span per row, equal interior
+ * spans of adjacent rows are merged into rectangles.
+ */
+void PixelsBase::fillRoundRectangleAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry) {
+    static const int8_t subRows[AA_SUB_ROWS] = {-6, -2, 2, 6};
+
+    int color = foreground->convertTo565();
+    int32_t a = 16 * (int32_t)rx + 8;
+    int32_t b = 16 * (int32_t)ry + 8;
+    uint8_t shift = b < 4096 ? 8 : 0;
+    int32_t top = 16 * (int32_t)(y1 + ry);
+    int32_t bottom = 16 * (int32_t)(y2 - ry);
+    int32_t cl = 16 * (int32_t)(x1 + rx);
+    int32_t cr = 16 * (int32_t)(x2 - rx);
+
+    Bounds area = visibleArea();
+    int16_t first = max(y1, area.y1);
+    int16_t last = min(y2, area.y2);
+
+    int16_t pa = 0;
+    int16_t pb = -1;
+    int16_t py = first;
 
-    int16_t glyphWidth = 0xff & pgm_read_byte_near(data + 4);
-    int16_t mLeft = 0x7f & pgm_read_byte_near(data + 5);
-    int16_t mTop = 0xff & pgm_read_byte_near(data + 6);
-    int16_t mRight = 0x7f & pgm_read_byte_near(data + 7);
+    beginGfxOperation();
 
-    int16_t effWidth = glyphWidth - mLeft - mRight;
+    for ( int16_t y = first; y <= last + 1; y++ ) {
+        int16_t sa = 0;
+        int16_t sb = -1;
+
+        if ( y <= last ) {
+            int32_t half[AA_SUB_ROWS];
+            int32_t hmin = 0x7FFFFFFF;
+            int32_t hmax = -1;
+            uint8_t n = 0;
+            for ( uint8_t s = 0; s < AA_SUB_ROWS; s++ ) {
+                int32_t p = 16 * (int32_t)y + subRows[s];
+                int32_t t = p < top ? top - p : p > bottom ? p - bottom : 0;
+                half[s] = -1;
+                if ( t < b ) {
+                    half[s] = t == 0 ? a : a * isqrt((uint32_t)(b * b - t * t) << shift) / (b << (shift >> 1));
+                    hmin = min(hmin, half[s]);
+                    hmax = max(hmax, half[s]);
+                    n++;
+                }
+            }
 
-    boolean vraster = (0x80 & pgm_read_byte_near(data + 5)) > 0;
-    boolean compressed = (pgm_read_byte_near(data + 7) & 0x80) > 0;
+            if ( n > 0 ) {
+                // pixels touched by the shape, and the ones covered on every sub-row
+                int16_t xa = ((cl - hmax - 8) >> 4) + 1;
+                int16_t xb = (cr + hmax + 7) >> 4;
+                sa = n < AA_SUB_ROWS ? xb + 1 : (cl - hmin + 23) >> 4;
+                sb = n < AA_SUB_ROWS ? xb : (cr + hmin - 8) >> 4;
+                if ( sa > sb ) {
+                    sa = xb + 1;
+                    sb = xb;
+                }
 
-    RGB* fg = foreground;
-    RGB* bg = background;
+                // the left and the right edge runs, within the visible area
+                int16_t runs[4];
+                runs[0] = max(xa, area.x1);
+                runs[1] = min(sa - 1, area.x2);
+                runs[2] = max(sb + 1, area.x1);
+                runs[3] = min(xb, area.x2);
+                for ( uint8_t r = 0; r < 4; r += 2 ) {
+                    for ( int16_t x = runs[r]; x <= runs[r + 1]; x += AA_RUN ) {
+                        int16_t len = min(AA_RUN, runs[r + 1] - x + 1);
+                        uint16_t raster[AA_RUN];
+                        if ( !readPixels(x, y, len, raster) ) {
+                            uint16_t bg = background->convertTo565();
+                            for ( int16_t i = 0; i < len; i++ ) {
+                                raster[i] = bg;
+                            }
+                        }
+                        for ( int16_t i = 0; i < len; i++ ) {
+                            uint8_t coverage = roundRectangleCoverage(16 * (int32_t)(x + i), cl, cr, half);
+                            raster[i] = mixColors(raster[i], color, (uint16_t)coverage << 2);
+                        }
+                        drawRasterLine(x, y, len, raster);
+                    }
+                }
+            }
+        }
 
-    int16_t ctr = 0;
-#ifndef NO_FILL_TEXT_BACKGROUND
-    int16_t prev = -1;
-    int16_t last = -1;
-#endif
+        if ( sa != pa || sb != pb ) {
+            if ( pa <= pb ) {
+                fill(color, pa, py, pb, y - 1);
+            }
+            pa = sa;
+            pb = sb;
+            py = y;
+        }
+    }
 
-    int16_t eff = vraster ?
-            glyphHeight - mTop - mRight :
-            glyphWidth - mLeft - mRight;
+    endGfxOperation();
+}
 
-    int16_t offsetLeft = mLeft + xx;
-    int16_t offsetTop = mTop + yy;
+/*
+ * fillRoundRing() limited to the angles from startAngle to startAngle + arcAngle; full turns need no test
+ */
+void PixelsBase::fillSector(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry, int16_t outer, int16_t inner, int16_t startAngle, int16_t arcAngle, boolean openFirst, boolean openLast, int color, int16_t* halfWidths) {
+    if ( arcAngle >= 360 || arcAngle <= -360 ) {
+        fillRoundRing(x1, y1, x2, y2, rx, ry, outer, inner, NULL, color, halfWidths);
+    } else if ( arcAngle != 0 ) {
+        ArcSector sector;
+        sector.set(x1 + rx, y1 + ry, rx, ry, startAngle, arcAngle, openFirst, openLast);
+        fillRoundRing(x1, y1, x2, y2, rx, ry, outer, inner, &sector, color, halfWidths);
+    }
+}
 
-    int16_t hEdge = xx + glyphWidth;
-    int16_t vEdge = yy + glyphHeight;
+/*
+ * Half widths of the rows of the oval, which fillOval() draws with the radii rx > 0 and ry > 0, by the
+ * distance of a row from the center: the same midpoint stepping, the first span of a row is kept
+ */
+static void ovalHalfWidths(int16_t rx, int16_t ry, int16_t* half) {
+    for ( int16_t d = 0; d <= ry; d++ ) {
+        half[d] = -1;
+    }
 
-    length -= 8;
+    int16_t ix = 0;
+    int16_t iy;
+    int16_t h, i, j, k;
+    int16_t oh, oi, oj, ok;
+    oh = oi = oj = ok = 0xFFFF;
+
+    if ( rx > ry ) {
+        iy = rx << 6;
+        do {
+            h = (ix + 32) >> 6;
+            i = (iy + 32) >> 6;
+            j = (h * ry) / rx;
+            k = (i * ry) / rx;
+            if ( (ok != k) && (oj != k) ) {
+                half[k] = max(half[k], h);
+                ok = k;
+            }
+            if ( (oj != j) && (ok != j) && (k != j) ) {
+                half[j] = max(half[j], i);
+                oj = j;
+            }
+            ix = ix + iy / rx;
+            iy = iy - ix / rx;
+        } while ( i > h );
+    } else {
+        iy = ry << 6;
+        do {
+            h = (ix + 32) >> 6;
+            i = (iy + 32) >> 6;
+            j = (h * rx) / ry;
+            k = (i * rx) / ry;
+            if ( (oi != i) && (oh != i) ) {
+                half[i] = max(half[i], j);
+                oi = i;
+            }
+            if ( (oh != h) && (oi != h) && (i != h) ) {
+                half[h] = max(half[h], k);
+                oh = h;
+            }
+            ix = ix + iy / ry;
+            iy = iy - ix / ry;
+        } while ( i > h );
+    }
+}
+
+void PixelsBase::drawArc(int16_t x, int16_t y, int16_t width, int16_t height, int16_t startAngle, int16_t arcAngle) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, startAngle, arcAngle};
+        recordCommand(DL_ARC, args, sizeof(args));
+        return;
+    }
+
+    // the bounds of the oval drawn by drawOval() and fillOval()
+    int16_t rx = (width - 1) / 2;
+    int16_t ry = (height - 1) / 2;
+    if ( rx < 0 || ry < 0 ) {
+        return;
+    }
+
+    int16_t w = strokeWidth();
+    int16_t hi = (w - 1) >> 1;
+    beginGfxOperation();
+    fillSector(x, y, x + 2 * rx, y + 2 * ry, rx, ry, w - 1 - hi, hi + 1, startAngle, arcAngle, false, false, foreground->convertTo565());
+    endGfxOperation();
+}
+
+void PixelsBase::fillArc(int16_t x, int16_t y, int16_t width, int16_t height, int16_t startAngle, int16_t arcAngle) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, startAngle, arcAngle};
+        recordCommand(DL_FILL_ARC, args, sizeof(args));
+        return;
+    }
+
+    // the rows of the oval drawn by fillOval()
+    int16_t rx = (width - 1) / 2;
+    int16_t ry = (height - 1) / 2;
+    if ( rx < 0 || ry < 0 || arcAngle == 0 ) {
+        return;
+    }
+
+    beginGfxOperation();
+    if ( width < 3 || height < 3 ) {
+        // as thin as a line, like in fillOval()
+        boolean vertical = width < 3;
+        fill(foreground->convertTo565(), x, y, vertical ? x : x + width - 1, vertical ? y + height - 1 : y);
+    } else {
+        int16_t* half = new int16_t[ry + 1];
+        if ( half != NULL ) {
+            ovalHalfWidths(rx, ry, half);
+            fillSector(x, y, x + 2 * rx, y + 2 * ry, rx, ry, 0, 0, startAngle, arcAngle, false, false, foreground->convertTo565(), half);
+            delete[] half;
+        }
+    }
+    endGfxOperation();
+}
+
+void PixelsBase::fillPie(int16_t x, int16_t y, int16_t radius, int16_t startAngle, int16_t arcAngle) {
+    fillRingSegment(x, y, radius, 0, startAngle, arcAngle);
+}
+
+void PixelsBase::fillRingSegment(int16_t x, int16_t y, int16_t outerRadius, int16_t innerRadius, int16_t startAngle, int16_t arcAngle) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, outerRadius, innerRadius, startAngle, arcAngle};
+        recordCommand(DL_FILL_RING_SEGMENT, args, sizeof(args));
+        return;
+    }
+
+    if ( outerRadius < 0 || innerRadius > outerRadius ) {
+        return;
+    }
+
+    beginGfxOperation();
+    fillSector(x - outerRadius, y - outerRadius, x + outerRadius, y + outerRadius, outerRadius, outerRadius,
+            0, outerRadius - innerRadius + 1, startAngle, arcAngle, false, false, foreground->convertTo565());
+    endGfxOperation();
+}
+
+void PixelsBase::updateRingSegment(int16_t x, int16_t y, int16_t outerRadius, int16_t innerRadius, int16_t startAngle, int16_t oldArcAngle, int16_t newArcAngle) {
+    if ( dlRecording || outerRadius < 0 || innerRadius > outerRadius ) {
+        return;
+    }
+
+    oldArcAngle = max(-360, min(360, oldArcAngle));
+    newArcAngle = max(-360, min(360, newArcAngle));
+    if ( oldArcAngle == newArcAngle ) {
+        return;
+    }
+
+    int16_t x1 = x - outerRadius;
+    int16_t y1 = y - outerRadius;
+    int16_t x2 = x + outerRadius;
+    int16_t y2 = y + outerRadius;
+    int16_t inner = outerRadius - innerRadius + 1;
+
+    beginGfxOperation();
+    if ( oldArcAngle == 0 || newArcAngle == 0 || (oldArcAngle < 0) != (newArcAngle < 0) ) {
+        // the direction changes: the old segment goes completely
+        fillSector(x1, y1, x2, y2, outerRadius, outerRadius, 0, inner, startAngle, oldArcAngle, false, false, background->convertTo565());
+        fillSector(x1, y1, x2, y2, outerRadius, outerRadius, 0, inner, startAngle, newArcAngle, false, false, foreground->convertTo565());
+    } else if ( abs(newArcAngle) > abs(oldArcAngle) ) {
+        fillSector(x1, y1, x2, y2, outerRadius, outerRadius, 0, inner, startAngle + oldArcAngle, newArcAngle - oldArcAngle, false, false, foreground->convertTo565());
+    } else {
+        // the ray at the new end stays with the segment, so does the start ray of a full turn
+        fillSector(x1, y1, x2, y2, outerRadius, outerRadius, 0, inner, startAngle + newArcAngle, oldArcAngle - newArcAngle,
+                true, abs(oldArcAngle) == 360, background->convertTo565());
+    }
+    endGfxOperation();
+}
+
+void PixelsBase::fillRectangleGradient(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t fromColor, uint16_t toColor, int16_t angle, boolean dither) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, (int16_t)fromColor, (int16_t)toColor, angle, dither};
+        recordCommand(DL_FILL_GRADIENT, args, sizeof(args));
+        return;
+    }
+
+    GradientRaster gradient(fromColor, toColor, dither);
+    gradient.setLinear(width, height, angle);
+    drawRaster(x, y, width, height, &gradient);
+}
+
+void PixelsBase::fillOvalRadial(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t centerColor, uint16_t edgeColor, boolean dither) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, (int16_t)centerColor, (int16_t)edgeColor, dither};
+        recordCommand(DL_FILL_RADIAL, args, sizeof(args));
+        return;
+    }
+
+    int16_t rx = (width - 1) / 2;
+    int16_t ry = (height - 1) / 2;
+    if ( rx < 0 || ry < 0 ) {
+        return;
+    }
+    int16_t x2 = x + (rx << 1);
+    int16_t y2 = y + (ry << 1);
+
+    GradientRaster gradient(centerColor, edgeColor, dither);
+    gradient.setRadial(rx, ry);
+
+    // the pixels outside of the oval are kept, so every row is a region of its own
+    beginGfxOperation();
+    for ( int16_t j = y; j <= y2; j++ ) {
+        int16_t a;
+        int16_t b;
+        roundRectangleSpan(x, y, x2, y2, rx, ry, j, a, b);
+        gradient.setOrigin(a - x - rx, j - y - ry);
+        drawRaster(a, j, b - a + 1, 1, &gradient);
+    }
+    endGfxOperation();
+}
+
+void PixelsBase::drawPolyline(int16_t* points, uint8_t count) {
+    if ( dlRecording ) {
+        int16_t args[] = {count};
+        recordCommand(DL_POLYLINE, args, sizeof(args), &points, sizeof(points));
+        return;
+    }
+
+    if ( points == NULL || count < 1 ) {
+        return;
+    }
+
+    beginGfxOperation();
+    if ( strokeWidth() > 1 ) {
+        strokePolyline(points, count, false);
+    } else if ( count == 1 ) {
+        drawLine(points[0], points[1], points[0], points[1]);
+    } else if ( antialiasing ) {
+        for ( uint8_t i = 1; i < count; i++ ) {
+            drawLine(points[2 * i - 2], points[2 * i - 1], points[2 * i], points[2 * i + 1]);
+        }
+    } else {
+        int color = foreground->convertTo565();
+        for ( uint8_t i = 1; i < count; i++ ) {
+            thinLine(color, points[2 * i - 2], points[2 * i - 1], points[2 * i], points[2 * i + 1]);
+        }
+    }
+    endGfxOperation();
+}
+
+void PixelsBase::drawLines(int16_t* points, uint16_t count) {
+    if ( dlRecording ) {
+        int16_t args[] = {(int16_t)count};
+        recordCommand(DL_LINES, args, sizeof(args), &points, sizeof(points));
+        return;
+    }
+
+    if ( points == NULL || count < 1 ) {
+        return;
+    }
+
+    beginGfxOperation();
+    if ( strokeWidth() > 1 || antialiasing ) {
+        for ( uint16_t i = 0; i < count; i++ ) {
+            int16_t* p = points + 4 * i;
+            drawLine(p[0], p[1], p[2], p[3]);
+        }
+    } else {
+        int color = foreground->convertTo565();
+        for ( uint16_t i = 0; i < count; i++ ) {
+            int16_t* p = points + 4 * i;
+            thinLine(color, p[0], p[1], p[2], p[3]);
+        }
+    }
+    endGfxOperation();
+}
+
+void PixelsBase::drawPolygon(int16_t* points, uint8_t count) {
+    if ( dlRecording ) {
+        int16_t args[] = {count};
+        recordCommand(DL_POLYGON, args, sizeof(args), &points, sizeof(points));
+        return;
+    }
+
+    if ( points == NULL || count < 1 ) {
+        return;
+    }
+
+    beginGfxOperation();
+    if ( strokeWidth() > 1 ) {
+        strokePolyline(points, count, true);
+    } else {
+        int color = foreground->convertTo565();
+        for ( uint8_t i = 0; i < count; i++ ) {
+            int16_t* a = points + 2 * i;
+            int16_t* b = points + 2 * ((i + 1) % count);
+            if ( antialiasing ) {
+                drawLine(a[0], a[1], b[0], b[1]);
+            } else {
+                thinLine(color, a[0], a[1], b[0], b[1]);
+            }
+        }
+    }
+    endGfxOperation();
+}
+
+void PixelsBase::drawPath(Path* path) {
+    if ( dlRecording ) {
+        recordCommand(DL_PATH, NULL, 0, &path, sizeof(path));
+        return;
+    }
+
+    if ( path == NULL ) {
+        return;
+    }
+
+    beginGfxOperation();
+    for ( uint8_t c = 0; c < path->getContours(); c++ ) {
+        uint8_t n;
+        boolean closed;
+        int16_t* points = path->getContour(c, n, closed);
+        if ( closed ) {
+            drawPolygon(points, n);
+        } else {
+            drawPolyline(points, n);
+        }
+    }
+    endGfxOperation();
+}
+
+int8_t PixelsBase::fillPath(Path* path, uint8_t rule) {
+    if ( dlRecording ) {
+        int16_t args[] = {rule};
+        recordCommand(DL_FILL_PATH, args, sizeof(args), &path, sizeof(path));
+        return 0;
+    }
+
+    if ( path == NULL ) {
+        return -1;
+    }
+
+    PolygonEdge* edges;
+    PolygonEdge** active;
+    int16_t n = path->getEdges(edges, active);
+    if ( n < 0 ) {
+        return -1;
+    }
+
+    beginGfxOperation();
+    int8_t result = fillEdges(edges, n, rule, active);
+    if ( antialiasing && result == 0 ) {
+        for ( uint8_t c = 0; c < path->getContours(); c++ ) {
+            uint8_t count;
+            boolean closed;
+            int16_t* points = path->getContour(c, count, closed);
+            drawPolygonEdgesAntialiased(points, count);
+        }
+    }
+    endGfxOperation();
+    return result;
+}
+
+void PixelsBase::drawIcon(int16_t xx, int16_t yy, prog_uchar* data) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {xx, yy};
+        recordCommand(DL_ICON, args, sizeof(args), &data, sizeof(data));
+        return;
+    }
+
+    int16_t fontType = BITMASK_FONT;
+    if ( pgm_read_byte_near(data + 1) == 'a' ) {
+        fontType = ANTIALIASED_FONT;
+    }
+
+    int16_t length = ((0xFF & (int32_t)pgm_read_byte_near(data + 2)) << 8) + (0xFF & (int32_t)pgm_read_byte_near(data + 3));
+
+    int16_t height =  pgm_read_byte_near(data + 4);
+
+    beginGfxOperation();
+    drawGlyph(fontType, false, xx, yy, height, data + 1, length-1);
+    endGfxOperation();
+}
+
+void PixelsBase::drawIconScaled(int16_t xx, int16_t yy, prog_uchar* data, int16_t targetHeight) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {xx, yy, targetHeight};
+        recordCommand(DL_ICON_SCALED, args, sizeof(args), &data, sizeof(data));
+        return;
+    }
+
+    int16_t height =  pgm_read_byte_near(data + 4);
+    if ( height <= 0 || targetHeight <= 0 ) {
+        return;
+    }
+
+    glyphScale = ((int32_t)targetHeight << 8) / height;
+    drawIcon(xx, yy, data);
+    glyphScale = 256;
+}
+
+void PixelsBase::cleanIcon(int16_t xx, int16_t yy, prog_uchar* data) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {xx, yy};
+        recordCommand(DL_CLEAN_ICON, args, sizeof(args), &data, sizeof(data));
+        return;
+    }
+
+    int16_t fontType = BITMASK_FONT;
+    if ( pgm_read_byte_near(data + 1) == 'a' ) {
+        fontType = ANTIALIASED_FONT;
+    }
+
+    int16_t length = ((0xFF & (int32_t)pgm_read_byte_near(data + 2)) << 8) + (0xFF & (int32_t)pgm_read_byte_near(data + 3));
+
+    int16_t height =  pgm_read_byte_near(data + 4);
+
+    beginGfxOperation();
+    drawGlyph(fontType, true, xx, yy, height, data + 1, length-1);
+    endGfxOperation();
+}
+
+int8_t PixelsBase::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height};
+        recordCommand(DL_BITMAP, args, sizeof(args), &data, sizeof(data));
+        return 0;
+    }
+
+    if ( data == NULL ) {
+        return -1;
+    }
+
+    BitmapRaster raster(data, width);
+    drawRaster(x, y, width, height, &raster);
+    return 0;
+}
+
+int8_t PixelsBase::drawBitmapScaled(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data,
+                                    int16_t targetWidth, int16_t targetHeight, uint8_t scaleMode) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, targetWidth, targetHeight, scaleMode};
+        recordCommand(DL_BITMAP_SCALED, args, sizeof(args), &data, sizeof(data));
+        return 0;
+    }
+
+    if ( data == NULL || width <= 0 || height <= 0 || targetWidth <= 0 || targetHeight <= 0 ) {
+        return -1;
+    }
+
+    BitmapRaster raster(data, width);
+    ScaledRaster scaledRaster(&raster, width, height, targetWidth, targetHeight, scaleMode);
+    drawRaster(x, y, targetWidth, targetHeight, &scaledRaster);
+    return 0;
+}
+
+int8_t PixelsBase::drawBitmapKeyed(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data, uint16_t key) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, (int16_t)key};
+        recordCommand(DL_BITMAP_KEYED, args, sizeof(args), &data, sizeof(data));
+        return 0;
+    }
+
+    if ( data == NULL ) {
+        return -1;
+    }
+
+    beginGfxOperation();
+
+    // opaque pixels are output by row runs, the transparent ones cost no bus traffic
+    for ( int16_t j = 0; j < height; j++ ) {
+        prog_uint16_t* row = data + (int32_t)j * width;
+        int16_t i = 0;
+        while ( i < width ) {
+            while ( i < width && pgm_read_word_near(row + i) == key ) {
+                i++;
+            }
+            int16_t start = i;
+            while ( i < width && pgm_read_word_near(row + i) != key ) {
+                i++;
+            }
+            if ( i > start ) {
+                BitmapRaster run(row + start, width);
+                drawRaster(x + start, y + j, i - start, 1, &run);
+            }
+        }
+    }
+
+    endGfxOperation();
+    return 0;
+}
+
+int8_t PixelsBase::drawBitmapAlpha(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data, prog_uchar* alpha, uint8_t alphaDepth) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height, alphaDepth};
+        const void* refs[] = {data, alpha};
+        recordCommand(DL_BITMAP_ALPHA, args, sizeof(args), refs, sizeof(refs));
+        return 0;
+    }
+
+    if ( data == NULL || alpha == NULL || (alphaDepth != 1 && alphaDepth != 4) ) {
+        return -1;
+    }
+
+    int16_t rowBytes = (width * alphaDepth + 7) / 8;
+    uint8_t opaque = (1 << alphaDepth) - 1;
+    uint8_t perByte = 8 / alphaDepth;
+
+    uint16_t raster[RASTER_BUFFER_SIZE];
+
+    beginGfxOperation();
+
+    for ( int16_t j = 0; j < height; j++ ) {
+        prog_uint16_t* row = data + (int32_t)j * width;
+        prog_uchar* alphaRow = alpha + (int32_t)j * rowBytes;
+
+        int16_t i = 0;
+        while ( i < width ) {
+            uint8_t a = 0;
+            while ( i < width ) {
+                a = (pgm_read_byte_near(alphaRow + i / perByte) >> (8 - alphaDepth * (i % perByte + 1))) & opaque;
+                if ( a != 0 ) {
+                    break;
+                }
+                i++;
+            }
+
+            // collects a run of visible pixels, which fits into the raster buffer
+            int16_t start = i;
+            boolean blend = false;
+            while ( i < width && i - start < RASTER_BUFFER_SIZE ) {
+                a = (pgm_read_byte_near(alphaRow + i / perByte) >> (8 - alphaDepth * (i % perByte + 1))) & opaque;
+                if ( a == 0 ) {
+                    break;
+                }
+                if ( a != opaque ) {
+                    blend = true;
+                }
+                i++;
+            }
+
+            int16_t len = i - start;
+            if ( len == 0 ) {
+                continue;
+            }
+
+            if ( !blend ) {
+                BitmapRaster run(row + start, width);
+                drawRaster(x + start, y + j, len, 1, &run);
+                continue;
+            }
+
+            readRasterLine(x + start, y + j, len, raster);
+            for ( int16_t k = 0; k < len; k++ ) {
+                int16_t ii = start + k;
+                a = (pgm_read_byte_near(alphaRow + ii / perByte) >> (8 - alphaDepth * (ii % perByte + 1))) & opaque;
+                raster[k] = blendColor(pgm_read_word_near(row + ii), raster[k], a, opaque);
+            }
+            drawRasterLine(x + start, y + j, len, raster);
+        }
+    }
+
+    endGfxOperation();
+    return 0;
+}
+
+int8_t PixelsBase::drawCompressedBitmap(int16_t x, int16_t y, prog_uchar* data) {
+    return drawCompressedBitmapScaled(x, y, data, 0, 0);
+}
+
+int8_t PixelsBase::drawCompressedBitmapScaled(int16_t x, int16_t y, prog_uchar* data,
+                                              int16_t targetWidth, int16_t targetHeight, uint8_t scaleMode) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, targetWidth, targetHeight, scaleMode};
+        recordCommand(DL_COMPRESSED_BITMAP, args, sizeof(args), &data, sizeof(data));
+        return 0;
+    }
+
+    if ( data == NULL ) {
+        return -1;
+    }
+
+    uint8_t header[COMPRESSED_HEADER_LENGTH];
+    for ( int16_t i = 0; i < COMPRESSED_HEADER_LENGTH; i++ ) {
+        header[i] = pgm_read_byte_near(data + i);
+    }
+
+    int32_t compressedLen = ((0xFF & (int32_t)header[1]) << 16) + ((0xFF & (int32_t)header[2]) << 8) + (0xFF & (int32_t)header[3]);
+
+    BitStream bs( data, compressedLen, 96 );
+    if ( scaleMode == SCALE_BILINEAR ) {
+        return drawCompressedStreamBilinear(x, y, header, bs, targetWidth, targetHeight);
+    }
+    return drawCompressedStream(x, y, header, bs, targetWidth, targetHeight, scaleMode);
+}
+
+/*
+ * Bilinear resampling needs two whole decoded rows; their buffer takes stack only for this mode
+ */
+int8_t PixelsBase::drawCompressedStreamBilinear(int16_t x, int16_t y, uint8_t* header, BitStream& bs,
+                                                int16_t targetWidth, int16_t targetHeight) {
+    uint16_t rows[SCALED_ROW_BUFFER_SIZE];
+    return drawCompressedStream(x, y, header, bs, targetWidth, targetHeight, SCALE_BILINEAR, rows);
+}
+
+/*
+ * Two most recently decoded image rows, addressed with the image row numbers
+ */
+class RowPairRaster : public Raster {
+private:
+    uint16_t* data;
+    int16_t width;
+
+public:
+    RowPairRaster(uint16_t* rows, int16_t rowWidth) {
+        data = rows;
+        width = rowWidth;
+    }
+
+    uint16_t getPixel(int16_t x, int16_t y) {
+        return data[(y & 1) * width + x];
+    }
+};
+
+int8_t PixelsBase::drawCompressedStream(int16_t x, int16_t y, uint8_t* header, BitStream& bs,
+                                        int16_t targetWidth, int16_t targetHeight, uint8_t scaleMode, uint16_t* rows) {
+
+    if ( header[0] != 'Z' ) {
+        // Unknown compression method
+        return -2;
+    }
+
+    int32_t compressedLen = ((0xFF & (int32_t)header[1]) << 16) + ((0xFF & (int32_t)header[2]) << 8) + (0xFF & (int32_t)header[3]);
+    if ( compressedLen < 0 ) {
+        // Unknown compression method or compressed data inconsistence
+        return -3;
+    }
+
+    int32_t resultLen = ((0xFF & (int32_t)header[4]) << 16) + ((0xFF & (int32_t)header[5]) << 8) + (0xFF & (int32_t)header[6]);
+    if ( resultLen < 0 ) {
+        // Unknown compression method or compression format error
+        return resultLen;
+    }
+
+    uint8_t windowLen = 0xFF & (int16_t)header[7];
+    if ( windowLen < 0 || windowLen > 254 ) {
+        // corrupted content
+        return -5;
+    }
+
+    int16_t width = ((0xFF & (int32_t)header[8]) << 8) + (0xFF & (int32_t)header[9]);
+    if ( width < 0 ) {
+        // Unknown compression method or compression format error (width parameter is invalid)
+        return -6;
+    }
+
+    int16_t height = ((0xFF & (int32_t)header[10]) << 8) + (0xFF & (int32_t)header[11]);
+    if ( height < 0 ) {
+        // Unknown compression method or compression format error (height parameter is invalid)
+        return -7;
+    }
+
+    // an image out of the clip rectangle is not decoded at all
+    if ( clipDepth > 0 ) {
+        boolean resized = targetWidth > 0 && targetHeight > 0;
+        Bounds ib(x, y, x + (resized ? targetWidth : width) - 1, y + (resized ? targetHeight : height) - 1);
+        if ( !clipBounds(ib) ) {
+            return 0;
+        }
+    }
+
+    uint8_t window[windowLen];
+    int16_t wptr = 0;
+
+    int32_t ctr = 0;
+
+    uint8_t buf = 0;
+    bool bufEmpty = true;
+
+    // decoded pixels are flushed by row pieces, so the image width does not impact RAM usage
+    uint16_t raster[RASTER_BUFFER_SIZE];
+    int16_t rasterPtr = 0;
+    int16_t rasterColumn = 0;
+    int16_t rasterLine = y;
+
+    // a resized image is sampled while it is decoded: a pixel goes to the resulting columns sampled from it,
+    // which are flushed by row pieces to all the resulting rows sampled from its row. Bilinear mode needs
+    // the current decoded row and the previous one, so it is taken only if they fit the row buffer
+    boolean scaled = targetWidth > 0 && targetHeight > 0 && (targetWidth != width || targetHeight != height);
+    if ( rows == NULL || 2 * width > SCALED_ROW_BUFFER_SIZE ) {
+        scaleMode = SCALE_NEAREST;
+    }
+    RowPairRaster rowPair(rows, width);
+    ScaledRaster scaledRaster(&rowPair, width, height, scaled ? targetWidth : width, scaled ? targetHeight : height, scaleMode);
+    boolean bilinear = scaled && scaledRaster.getMode() == SCALE_BILINEAR;
+    LineRaster piece(raster);
+    int16_t sourceRow = 0;
+    int16_t targetRow = 0;
+    int16_t targetColumn = 0;
+    int16_t targetRows = 0;
+
+    beginGfxOperation();
+
+    while ( ctr <= resultLen ) {
+
+        uint8_t offset = 0;
+        uint8_t matchCount = 1;
+
+        boolean literal = bs.readBit() == 0;
+        if ( !literal ) {
+            offset = (uint8_t)bs.readNumber() - 1;
+            matchCount = (uint8_t)bs.readNumber() - 1;
+        }
+
+        while( matchCount-- > 0 ) {
+            uint8_t bits;
+            if ( literal ) {
+                bits = bs.readBits(8);
+            } else {
+                int16_t p1 = wptr - offset;
+                while ( p1 < 0 ) {
+                    p1 += windowLen;
+                }
+                while ( p1 >= windowLen ) {
+                    p1 -= windowLen;
+                }
+                bits = window[p1];
+            }
+
+            ctr++;
+            window[wptr++] = bits;
+            if ( wptr >= windowLen ) {
+                wptr -= windowLen;
+            }
+
+            if ( bufEmpty ) {
+                buf = bits;
+                bufEmpty = false;
+                continue;
+            }
+            bufEmpty = true;
+
+            uint16_t px = buf;
+            px <<= 8;
+            px |= bits;
+
+            if ( scaled && !bilinear ) {
+                if ( rasterColumn == 0 ) {
+                    targetColumn = 0;
+                    targetRows = 0;
+                    while ( targetRow + targetRows < targetHeight && scaledRaster.getSourceRow(targetRow + targetRows) == sourceRow ) {
+                        targetRows++;
+                    }
+                }
+                while ( targetRows > 0 && targetColumn < targetWidth && scaledRaster.getSourceColumn(targetColumn) <= rasterColumn ) {
+                    raster[rasterPtr++] = px;
+                    targetColumn++;
+                    if ( rasterPtr == RASTER_BUFFER_SIZE || targetColumn == targetWidth ) {
+                        drawRaster(x + targetColumn - rasterPtr, y + targetRow, rasterPtr, targetRows, &piece);
+                        rasterPtr = 0;
+                    }
+                }
+                if ( ++rasterColumn == width ) {
+                    rasterColumn = 0;
+                    targetRow += targetRows;
+                    sourceRow++;
+                }
+                continue;
+            }
+
+            if ( bilinear ) {
+                rows[(sourceRow & 1) * width + rasterColumn++] = px;
+                if ( rasterColumn == width ) {
+                    rasterColumn = 0;
+                    // outputs all the resulting rows, which are sampled from the decoded rows
+                    while ( targetRow < targetHeight ) {
+                        int16_t r = scaledRaster.getSourceRow(targetRow);
+                        if ( r + 1 < height ) {
+                            r++;
+                        }
+                        if ( r > sourceRow ) {
+                            break;
+                        }
+                        scaledRaster.setRowOffset(targetRow);
+                        drawRaster(x, y + targetRow, targetWidth, 1, &scaledRaster);
+                        targetRow++;
+                    }
+                    sourceRow++;
+                }
+                continue;
+            }
+
+            raster[rasterPtr++] = px;
+
+            if ( rasterPtr == RASTER_BUFFER_SIZE || rasterColumn + rasterPtr == width ) {
+                if ( rasterLine < y + height ) {
+                    drawRasterLine(x + rasterColumn, rasterLine, rasterPtr, raster);
+                }
+                rasterColumn += rasterPtr;
+                rasterPtr = 0;
+                if ( rasterColumn == width ) {
+                    rasterColumn = 0;
+                    rasterLine++;
+                }
+            }
+        }
+    }
+
+    endGfxOperation();
+
+    return 0;
+}
+
+int8_t PixelsBase::loadBitmap(int16_t x, int16_t y, int16_t width, int16_t height, String path) {
+
+    if ( byteReader == NULL || !byteReader->open(path) ) {
+        return -1;
+    }
+
+    uint8_t cache[STREAM_BUFFER_SIZE];
+    BitStream bs(byteReader, cache, STREAM_BUFFER_SIZE);
+
+    uint8_t header[BMP_HEADER_LENGTH];
+    int16_t headerLen = 0;
+    while ( headerLen < COMPRESSED_HEADER_LENGTH && !bs.endOfData() ) {
+        header[headerLen++] = bs.readBits(8);
+    }
+
+    int8_t result = 0;
+
+    if ( headerLen == COMPRESSED_HEADER_LENGTH && header[0] == 'Z' &&
+            (((int32_t)header[4] << 16) + ((int32_t)header[5] << 8) + header[6]) ==
+            (((int32_t)header[8] << 8) + header[9]) * (((int32_t)header[10] << 8) + header[11]) * 2 ) {
+
+        result = drawCompressedStream(x, y, header, bs);
+
+    } else if ( headerLen == COMPRESSED_HEADER_LENGTH && header[0] == 'B' && header[1] == 'M' ) {
+
+        while ( headerLen < BMP_HEADER_LENGTH && !bs.endOfData() ) {
+            header[headerLen++] = bs.readBits(8);
+        }
+
+        uint32_t dataOffset = header[10] + ((uint32_t)header[11] << 8) + ((uint32_t)header[12] << 16) + ((uint32_t)header[13] << 24);
+        int32_t w = header[18] + ((uint32_t)header[19] << 8) + ((uint32_t)header[20] << 16) + ((uint32_t)header[21] << 24);
+        int32_t h = header[22] + ((uint32_t)header[23] << 8) + ((uint32_t)header[24] << 16) + ((uint32_t)header[25] << 24);
+        uint16_t bpp = header[28] + ((uint16_t)header[29] << 8);
+        uint32_t compression = header[30] + ((uint32_t)header[31] << 8) + ((uint32_t)header[32] << 16) + ((uint32_t)header[33] << 24);
+
+        if ( headerLen < BMP_HEADER_LENGTH || bpp != 24 || compression != 0 || w <= 0 || h == 0 || dataOffset < BMP_HEADER_LENGTH ) {
+            byteReader->close();
+            return -8;
+        }
+
+        // rows are stored bottom-up, unless the height is negative
+        boolean topDown = h < 0;
+        if ( topDown ) {
+            h = -h;
+        }
+
+        for ( uint32_t i = BMP_HEADER_LENGTH; i < dataOffset; i++ ) {
+            bs.readBits(8);
+        }
+
+        int16_t padding = (4 - (w * 3) % 4) % 4;
+        uint16_t raster[RASTER_BUFFER_SIZE];
+
+        beginGfxOperation();
+        for ( int32_t j = 0; j < h && !bs.endOfData(); j++ ) {
+            int16_t line = topDown ? y + j : y + h - j - 1;
+            int16_t column = 0;
+            while ( column < w ) {
+                int16_t len = w - column > RASTER_BUFFER_SIZE ? RASTER_BUFFER_SIZE : w - column;
+                for ( int16_t i = 0; i < len; i++ ) {
+                    uint8_t b = bs.readBits(8);
+                    uint8_t g = bs.readBits(8);
+                    uint8_t r = bs.readBits(8);
+                    raster[i] = ((uint16_t)(r >> 3) << 11) | ((uint16_t)(g >> 2) << 5) | (b >> 3);
+                }
+                drawRasterLine(x + column, line, len, raster);
+                column += len;
+            }
+            for ( int16_t i = 0; i < padding; i++ ) {
+                bs.readBits(8);
+            }
+        }
+        endGfxOperation();
+
+    } else {
+
+        // raw RGB565 pixels; the bytes, consumed by the format detection, are the first image pixels
+        if ( width <= 0 || height <= 0 ) {
+            byteReader->close();
+            return -9;
+        }
+
+        uint16_t raster[RASTER_BUFFER_SIZE];
+        int16_t ptr = 0;
+
+        beginGfxOperation();
+        for ( int16_t j = 0; j < height && !bs.endOfData(); j++ ) {
+            int16_t column = 0;
+            while ( column < width ) {
+                int16_t len = width - column > RASTER_BUFFER_SIZE ? RASTER_BUFFER_SIZE : width - column;
+                for ( int16_t i = 0; i < len; i++ ) {
+                    uint8_t hi = ptr < headerLen ? header[ptr++] : bs.readBits(8);
+                    uint8_t lo = ptr < headerLen ? header[ptr++] : bs.readBits(8);
+                    raster[i] = ((uint16_t)hi << 8) | lo;
+                }
+                drawRasterLine(x + column, y + j, len, raster);
+                column += len;
+            }
+        }
+        endGfxOperation();
+    }
+
+    byteReader->close();
+    return result;
+}
+
+uint16_t ScaledRaster::getPixel(int16_t x, int16_t y) {
+
+    int32_t fx = x * stepX + (stepX >> 1);
+    int32_t fy = (y + rowOffset) * stepY + (stepY >> 1);
+
+    if ( mode != SCALE_BILINEAR ) {
+        return source->getPixel(fx >> 16, fy >> 16);
+    }
+
+    // the sample point is shifted by half of a source pixel to interpolate between pixel centers
+    fx -= 0x8000;
+    fy -= 0x8000;
+    if ( fx < 0 ) {
+        fx = 0;
+    }
+    if ( fy < 0 ) {
+        fy = 0;
+    }
+
+    int16_t x0 = fx >> 16;
+    int16_t y0 = fy >> 16;
+    int16_t x1 = x0 + 1 < sourceWidth ? x0 + 1 : x0;
+    int16_t y1 = y0 + 1 < sourceHeight ? y0 + 1 : y0;
+    uint16_t wx = (fx >> 8) & 0xFF;
+    uint16_t wy = (fy >> 8) & 0xFF;
+
+    uint16_t top = mixColors(source->getPixel(x0, y0), source->getPixel(x1, y0), wx);
+    uint16_t bottom = mixColors(source->getPixel(x0, y1), source->getPixel(x1, y1), wx);
+    return mixColors(top, bottom, wy);
+}
+
+/* ordered dithering thresholds in 1/16 of a color step */
+static const uint8_t bayerMatrix[] PROGMEM = {
+     0,  8,  2, 10,
+    12,  4, 14,  6,
+     3, 11,  1,  9,
+    15,  7, 13,  5
+};
+
+/* k * x, moved from the last x by an addition for neighbor pixels */
+static int32_t linearTerm(int32_t term, int16_t last, int16_t x, int32_t k) {
+    if ( x == last ) {
+        return term;
+    }
+    if ( x == last + 1 ) {
+        return term + k;
+    }
+    if ( x == last - 1 ) {
+        return term - k;
+    }
+    return x * k;
+}
+
+/* k * x * x, moved from the last x by the first difference for neighbor pixels */
+static int32_t squareTerm(int32_t term, int16_t last, int16_t x, int32_t k) {
+    if ( x == last ) {
+        return term;
+    }
+    if ( x == last + 1 ) {
+        return term + (2 * (int32_t)last + 1) * k;
+    }
+    if ( x == last - 1 ) {
+        return term - (2 * (int32_t)last - 1) * k;
+    }
+    return (int32_t)x * x * k;
+}
+
+/* a color component between c0 and c1 at the position t of 0..4096, threshold in 1/4096 of a step */
+static inline uint16_t gradientComponent(int32_t c0, int32_t c1, int32_t t, uint16_t threshold) {
+    return ((c0 << 12) + (c1 - c0) * t + threshold) >> 12;
+}
+
+void GradientRaster::setLinear(int16_t width, int16_t height, int16_t angle) {
+    int32_t c;
+    int32_t s;
+    angleVector(angle, c, s);
+
+    radial = false;
+    base = kx = ky = 0;
+    lastX = lastY = 0;
+    tx = ty = 0;
+
+    // rows grow downwards, so the direction is (c, -s); the whole range is 65536
+    int32_t range = (int32_t)(width - 1) * abs(c) + (int32_t)(height - 1) * abs(s);
+    if ( range > 0 ) {
+        kx = (c * 65536L) / range;
+        ky = (-s * 65536L) / range;
+        // the start corner gets 0
+        base = -(c < 0 ? (width - 1) * kx : 0) - (s > 0 ? (height - 1) * ky : 0);
+    }
+}
+
+void GradientRaster::setRadial(int16_t rx, int16_t ry) {
+    // (2x / (2rx + 1))^2 with 1.0 as 2^24
+    int32_t a = 2 * (int32_t)rx + 1;
+    int32_t b = 2 * (int32_t)ry + 1;
+
+    radial = true;
+    base = 0;
+    kx = (1L << 26) / (a * a);
+    ky = (1L << 26) / (b * b);
+    lastX = lastY = 0;
+    tx = ty = 0;
+}
+
+uint16_t GradientRaster::getPixel(int16_t x, int16_t y) {
+    x += originX;
+    y += originY;
+
+    int32_t t;
+    if ( radial ) {
+        tx = squareTerm(tx, lastX, x, kx);
+        ty = squareTerm(ty, lastY, y, ky);
+        t = isqrt(tx + ty);
+    } else {
+        tx = linearTerm(tx, lastX, x, kx);
+        ty = linearTerm(ty, lastY, y, ky);
+        t = (base + tx + ty) >> 4;
+    }
+    lastX = x;
+    lastY = y;
+
+    if ( t < 0 ) {
+        t = 0;
+    } else if ( t > 4096 ) {
+        t = 4096;
+    }
+
+    uint16_t threshold = 2048;
+    if ( dither ) {
+        threshold = (pgm_read_byte(bayerMatrix + ((y & 3) << 2) + (x & 3)) << 8) + 128;
+    }
+
+    uint16_t r = gradientComponent(from >> 11, to >> 11, t, threshold);
+    uint16_t g = gradientComponent((from >> 5) & 0x3F, (to >> 5) & 0x3F, t, threshold);
+    uint16_t b = gradientComponent(from & 0x1F, to & 0x1F, t, threshold);
+    return (r << 11) | (g << 5) | b;
+}
+
+void PixelsBase::drawRasterLine(int16_t x, int16_t y, int16_t length, uint16_t* raster) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, length};
+        recordCommand(DL_RASTER_LINE, args, sizeof(args), &raster, sizeof(raster));
+        return;
+    }
+
+    LineRaster line(raster);
+    drawRaster(x, y, length, 1, &line);
+}
+
+void PixelsBase::drawRaster(int16_t x, int16_t y, int16_t width, int16_t height, Raster* raster) {
+
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height};
+        recordCommand(DL_RASTER, args, sizeof(args), &raster, sizeof(raster));
+        return;
+    }
+
+    if ( width <= 0 || height <= 0 ) {
+        return;
+    }
+
+    Bounds bb(x, y, x + width - 1, y + height - 1);
+    if( !clipBounds(bb) || !transformBounds(bb) ) {
+        return;
+    }
+
+    Bounds pieces[4];
+    int16_t shifts[4];
+    uint8_t n = 1;
+    if ( relativeOrigin ) {
+        pieces[0] = bb;
+        shifts[0] = 0;
+    } else {
+        n = scrollPieces(bb, pieces, shifts);
+    }
+
+    beginGfxOperation();
+
+    for ( uint8_t i = 0; i < n; i++ ) {
+        if ( sliceHandler == NULL || fbData != NULL ) {
+            putRaster(pieces[i], shifts[i], x, y, raster);
+            continue;
+        }
+        Bounds& p = pieces[i];
+        for ( int16_t yy = p.y1; yy <= p.y2; yy += sliceRows ) {
+            if ( yy > p.y1 ) {
+                yieldSlice();
+            }
+            Bounds chunk(p.x1, yy, p.x2, min(p.y2, yy + sliceRows - 1));
+            putRaster(chunk, shifts[i], x, y, raster);
+        }
+    }
+
+    endGfxOperation();
+}
+
+/*
+ * Outputs a device memory region piece. shift is a vertical offset of the piece in relation to
+ * the transformed (not scrolled) coordinates; x, y is the logical raster origin.
+ */
+void PixelsBase::putRaster(Bounds& bb, int16_t shift, int16_t x, int16_t y, Raster* raster) {
+
+    if( !checkBounds(bb) ) {
+        return;
+    }
+
+    if ( fbData != NULL ) {
+        // a partial frame buffer (a display list band) does not need the rest of the raster
+        bb.x1 = max(bb.x1, fbBounds.x1);
+        bb.y1 = max(bb.y1, fbBounds.y1);
+        bb.x2 = min(bb.x2, fbBounds.x2);
+        bb.y2 = min(bb.y2, fbBounds.y2);
+        if ( bb.x2 < bb.x1 || bb.y2 < bb.y1 ) {
+            return;
+        }
+    }
+
+    if ( deviceRegion(bb.x1, bb.y1, bb.x2, bb.y2) == 0 ) {
+        return;
+    }
+
+    // logical coordinates of the first region pixel and their increments by device column/row steps
+    int16_t tx = bb.x1;
+    int16_t ty = bb.y1 - shift;
+    int16_t u, v;
+    int8_t colU, colV, rowU, rowV;
+
+    switch( orientation ) {
+    case LANDSCAPE:
+        u = ty;
+        v = deviceWidth - tx - 1;
+        colU = 0; colV = -1;
+        rowU = 1; rowV = 0;
+        break;
+    case PORTRAIT_FLIP:
+        u = deviceWidth - tx - 1;
+        v = deviceHeight - ty - 1;
+        colU = -1; colV = 0;
+        rowU = 0; rowV = -1;
+        break;
+    case LANDSCAPE_FLIP:
+        u = deviceHeight - ty - 1;
+        v = tx;
+        colU = 0; colV = 1;
+        rowU = -1; rowV = 0;
+        break;
+    default:
+        u = tx;
+        v = ty;
+        colU = 1; colV = 0;
+        rowU = 0; rowV = 1;
+        break;
+    }
+
+    u -= x;
+    v -= y;
+
+    for ( int16_t j = bb.y1; j <= bb.y2; j++ ) {
+        int16_t uu = u;
+        int16_t vv = v;
+        for ( int16_t i = bb.x1; i <= bb.x2; i++ ) {
+            setCurrentPixel((int16_t)raster->getPixel(uu, vv));
+            uu += colU;
+            vv += colV;
+        }
+        u += rowU;
+        v += rowV;
+    }
+}
+
+/*  -------   Antialiasing ------- */
+/* To be overriden with Pixels_Antialiasing.h */
+
+void PixelsBase::drawLineAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {}
+
+
+void PixelsBase::drawRoundRectangleAntialiased(int16_t x, int16_t y, int16_t width, int16_t height, int16_t rx, int16_t ry, boolean bordermode) {}
+
+void PixelsBase::drawCircleAntialiaced( int16_t x, int16_t y, int16_t radius, boolean bordermode )	{}
+
+/* TEXT */
+
+
+int PixelsBase::setFont(prog_uchar font[]) {
+    if ( font == NULL ) {
+        currentFont = NULL;
+        return -1;
+    }
+    int16_t p1 = pgm_read_byte_near(font + 0);
+    int16_t p2 = pgm_read_byte_near(font + 1);
+    if ( p1 != 'Z' || p2 != 'F' ) {
+//			Serial.print("Invalid font prefix ");
+//			Serial.print( p1 );
+//			Serial.print( " " );
+//			Serial.println( p2 );
+        currentFont = NULL;
+        return -1;
+    }
+    int16_t fontType = pgm_read_byte_near(font + 2);
+    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
+//			Serial.println("Unsupported font type");
+        currentFont = NULL;
+        return -1;
+    }
+    currentFont = font;
+    return 0;
+}
+
+void PixelsBase::print(int16_t xx, int16_t yy, String text, int8_t kerning[]) {
+    if ( dlRecording ) {
+        int16_t args[] = {xx, yy};
+        recordCommand(DL_PRINT, args, sizeof(args), &kerning, sizeof(int8_t*), text.c_str());
+        return;
+    }
+
+    beginGfxOperation();
+    printString(xx, yy, text, 0, kerning);
+    endGfxOperation();
+}
+
+
+#ifndef NO_TEXT_WRAP
+int16_t PixelsBase::computeBreakPos(String text, int16_t t) {
+    int16_t breakPos = -1;
+    String s = t == 0 ? text : text.substring(t, text.length());
+    int16_t w = getTextWidth(s);
+    if ( w + caretX > width - textWrapMarginRight || text.indexOf('\n') >= 0 ) {
+        char prev = 0;
+        w = 0;
+        for ( uint16_t j = t; j < text.length(); j++ ) {
+            char cc = text.charAt(j);
+            w += getCharWidth(cc);
+            if ( (cc == ' ' && prev != ' ') || (cc == '\n' && breakPos >= 0) ) {
+                if ( caretX + w > width - textWrapMarginRight ) {
+                    break;
+                } else {
+                    breakPos = j;
+                    if ( cc == '\n' ) {
+                        break;
+                    }
+                }
+            } else if ( cc == '\n' ) {
+                breakPos = j;
+                break;
+            }
+            prev = cc;
+        }
+    }
+    return breakPos;
+}
+#endif
+
+void PixelsBase::cleanText(int16_t xx, int16_t yy, String text, int8_t kerning[]) {
+    if ( dlRecording ) {
+        int16_t args[] = {xx, yy};
+        recordCommand(DL_CLEAN_TEXT, args, sizeof(args), &kerning, sizeof(int8_t*), text.c_str());
+        return;
+    }
+
+    beginGfxOperation();
+    printString(xx, yy, text, 1, kerning);
+    endGfxOperation();
+}
+
+void PixelsBase::printString(int16_t xx, int16_t yy, String text, boolean clean, int8_t kerning[]) {
+
+    if ( currentFont == NULL ) {
+        return;
+    }
+
+    int16_t fontType = pgm_read_byte_near(currentFont + 2);
+    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
+        return;
+    }
+
+    RGB* fg = foreground;
+
+    int16_t kernPtr = 0;
+    int16_t kern = -100; // no kerning
+
+    int16_t glyphHeight = pgm_read_byte_near(currentFont + 3);
+
+    caretX = xx;
+    caretY = yy;
+
+    int16_t glyphWidth = 0;
+    int breakPos = -1;
+
+#ifndef NO_TEXT_WRAP
+    boolean relOrigin = isOriginRelative();
+    if ( wrapText ) {
+        breakPos = computeBreakPos(text, 0);
+    }
+#endif
+
+    for (uint16_t t = 0; t < text.length(); t++) {
+        char c = text.charAt(t);
+
+#ifndef NO_TEXT_WRAP
+        if ( t == breakPos ) {
+            if ( c == ' ' || c == '\n' ) {
+                breakPos++;
+                continue;
+            }
+            caretX = textWrapMarginLeft;
+            caretY = caretY + glyphHeight + textWrapLineGap;
+            if ( textWrapScroll && (orientation == PORTRAIT_FLIP || orientation == PORTRAIT) &&
+                    caretY + glyphHeight + textWrapMarginBottom > height ) {
+
+                RGB* sav = NULL;
+                if ( textWrapScrollFill != NULL ) {
+                    sav = getBackground();
+                    setBackground(textWrapScrollFill);
+                }
+                scroll(-(height - caretY - glyphHeight - textWrapMarginBottom), SCROLL_SMOOTH | SCROLL_CLEAN);
+                if ( sav != NULL ) {
+                    setBackground(sav);
+                }
+                setOriginAbsolute();
+
+                caretY = height - glyphHeight - textWrapMarginBottom;
+            }
+            breakPos = computeBreakPos(text, t);
+        }
+
+        boolean repeat = false;
+#endif
+
+        boolean found = false;
+        int16_t ptr = HEADER_LENGTH;
+        while ( 1 ) {
+            char cx = (char)(((int)pgm_read_byte_near(currentFont + ptr + 0) << 8) + pgm_read_byte_near(currentFont + ptr + 1));
+            if ( cx == 0 ) {
+              break;
+            }
+            int16_t length = (((int)(pgm_read_byte_near(currentFont + ptr + 2) & 0xff) << 8) + (int)(pgm_read_byte_near(currentFont + ptr + 3) & 0xff));
+
+            if ( cx == c ) {
+                if ( length < 8 ) {
+//						Serial.print( "Invalid "  );
+//						Serial.print( c );
+//						Serial.println( " glyph definition. Font corrupted?" );
+                    break;
+                }
+
+                glyphWidth = 0xff & pgm_read_byte_near(currentFont + ptr + 4);
+                found = true;
+
+#ifndef NO_TEXT_WRAP
+                if ( wrapText && caretX + glyphWidth > width - textWrapMarginRight ) {
+                    breakPos = t;
+                    repeat = true;
+                    break;
+                }
+#endif
+
+                drawGlyph(fontType, clean, caretX, caretY, glyphHeight, currentFont + ptr, length);
+                break;
+            }
+            ptr += length;
+        }
+
+#ifndef NO_TEXT_WRAP
+        if ( repeat ) {
+            t--;
+            continue;
+        }
+#endif
+
+        if ( kerning != NULL && kerning[kernPtr] > -100 ) {
+            kern = kerning[kernPtr];
+            if (kerning[kernPtr+1] > -100) {
+                kernPtr++;
+            }
+        }
+
+        if ( found ) {
+            caretX += glyphWidth;
+            if ( kern > -100 ) {
+                caretX += kern;
+            }
+        }
+    }
+
+#ifndef NO_TEXT_WRAP
+    if ( relOrigin ) {
+        setOriginRelative();
+    } else {
+        setOriginAbsolute();
+    }
+#endif
+
+    setColor(fg);
+}
+
+int16_t PixelsBase::getTextLineHeight() {
+    if ( currentFont == NULL ) {
+        return 0;
+    }
+
+//    int16_t fontType = pgm_read_byte_near(currentFont + 2);
+//    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
+//        return 0;
+//    }
+
+    return pgm_read_byte_near(currentFont + 3);
+}
+
+int16_t PixelsBase::getTextBaseline() {
+    if ( currentFont == NULL ) {
+        return 0;
+    }
+
+//    int16_t fontType = pgm_read_byte_near(currentFont + 2);
+//    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
+//        return 0;
+//    }
+
+    return pgm_read_byte_near(currentFont + 4);
+}
+
+int16_t PixelsBase::getCharWidth(char c) {
+    if ( currentFont == NULL ) {
+        return 0;
+    }
+
+    int16_t ptr = HEADER_LENGTH;
+    while ( 1 ) {
+        char cx = (char)(((int)pgm_read_byte_near(currentFont + ptr + 0) << 8) + pgm_read_byte_near(currentFont + ptr + 1));
+        if ( cx == 0 ) {
+          break;
+        }
+        int16_t length = (((int)(pgm_read_byte_near(currentFont + ptr + 2) & 0xff) << 8) + (int)(pgm_read_byte_near(currentFont + ptr + 3) & 0xff));
+
+        if ( cx == c ) {
+            if ( length < 8 ) {
+//						Serial.print( "Invalid "  );
+//						Serial.print( c );
+//						Serial.println( " glyph definition. Font corrupted?" );
+                break;
+            }
+//                Serial.print( c );
+
+            return 0xff & pgm_read_byte_near(currentFont + ptr + 4);
+        }
+
+        ptr += length;
+    }
+
+    return 0;
+}
+
+int16_t PixelsBase::getTextWidth(String text, int8_t kerning[]) {
+    if ( currentFont == NULL ) {
+        return 0;
+    }
+
+    int16_t kernPtr = 0;
+    int16_t kern = -100; // no kerning
+    int16_t x1 = 0;
+
+    for (uint16_t t = 0; t < text.length(); t++) {
+        char c = text.charAt(t);
+
+        int16_t width = 0;
+        boolean found = false;
+        int16_t ptr = HEADER_LENGTH;
+        while ( 1 ) {
+            char cx = (char)(((int)pgm_read_byte_near(currentFont + ptr + 0) << 8) + pgm_read_byte_near(currentFont + ptr + 1));
+            if ( cx == 0 ) {
+              break;
+            }
+            int16_t length = (((int)(pgm_read_byte_near(currentFont + ptr + 2) & 0xff) << 8) + (int)(pgm_read_byte_near(currentFont + ptr + 3) & 0xff));
+
+            if ( cx == c ) {
+                if ( length < 8 ) {
+//						Serial.print( "Invalid "  );
+//						Serial.print( c );
+//						Serial.println( " glyph definition. Font corrupted?" );
+                    break;
+                }
+//                Serial.print( c );
+                found = true;
+                width = 0xff & pgm_read_byte_near(currentFont + ptr + 4);
+            }
+
+            ptr += length;
+        }
+
+        if ( kerning != NULL && kerning[kernPtr] > -100 ) {
+            kern = kerning[kernPtr];
+            if (kerning[kernPtr+1] > -100) {
+                kernPtr++;
+            }
+        }
+
+        if ( found ) {
+            x1 += width;
+            if ( kern > -100 ) {
+                x1+= kern;
+            }
+        }
+    }
+
+    return x1;
+}
+
+void PixelsBase::drawGlyph(int16_t fontType, boolean clean, int16_t xx, int16_t yy,
+                           int16_t glyphHeight, prog_uchar* data, int16_t length) {
+
+    int16_t glyphWidth = 0xff & pgm_read_byte_near(data + 4);
+    int16_t mLeft = 0x7f & pgm_read_byte_near(data + 5);
+    int16_t mTop = 0xff & pgm_read_byte_near(data + 6);
+    int16_t mRight = 0x7f & pgm_read_byte_near(data + 7);
+
+    int16_t effWidth = glyphWidth - mLeft - mRight;
+
+    boolean vraster = (0x80 & pgm_read_byte_near(data + 5)) > 0;
+    boolean compressed = (pgm_read_byte_near(data + 7) & 0x80) > 0;
+
+    RGB* fg = foreground;
+    RGB* bg = background;
+
+    int16_t ctr = 0;
+#ifndef NO_FILL_TEXT_BACKGROUND
+    int16_t prev = -1;
+    int16_t last = -1;
+#endif
+
+    int16_t eff = vraster ?
+            glyphHeight - mTop - mRight :
+            glyphWidth - mLeft - mRight;
+
+    glyphX = xx;
+    glyphY = yy;
+
+    // a glyph out of the clip rectangle is skipped as a whole
+    if ( clipDepth > 0 ) {
+        Bounds gb(xx, yy, xx + (((int32_t)glyphWidth * glyphScale) >> 8), yy + (((int32_t)glyphHeight * glyphScale) >> 8));
+        if ( !clipBounds(gb) ) {
+            return;
+        }
+    }
+
+    int16_t offsetLeft = mLeft + xx;
+    int16_t offsetTop = mTop + yy;
+
+    int16_t hEdge = xx + glyphWidth;
+    int16_t vEdge = yy + glyphHeight;
+
+    length -= 8;
 
     if ( !(fontType == BITMASK_FONT && !compressed) ) {
 
-        int16_t edge = vraster ? offsetTop + eff - 1 : offsetLeft + eff - 1;
+        int16_t edge = vraster ? offsetTop + eff - 1 : offsetLeft + eff - 1;
+
+        for ( int16_t i = 0; i < length; i++ ) {
+            int16_t p1 = ctr / eff;
+            int16_t p2 = ctr % eff;
+
+            int16_t b = 0xff & pgm_read_byte_near(data + 8 + i);
+            int16_t len = 0x7f & b;
+            boolean color = fontType == BITMASK_FONT ? (0x80 & b) > 0 : true;
+
+            if ( color || glyphPrintMode == FILL_TEXT_BACKGROUND ) {
+
+#ifndef NO_FILL_TEXT_BACKGROUND
+                if ( glyphPrintMode == FILL_TEXT_BACKGROUND && prev != p1 ) {
+                    setColor(bg);
+                    if ( vraster ) {
+                        if ( prev < 0 ) {
+                            glyphFill(xx, yy, xx + mLeft, yy + glyphHeight);
+                        } else {
+                            glyphFill(offsetLeft + p1, yy, offsetLeft + p1, vEdge);
+                        }
+                    } else {
+                        if ( prev < 0 ) {
+                            glyphFill(xx, yy, xx + glyphWidth, yy + mTop);
+                        } else {
+                            glyphFill(xx, offsetTop + p1, hEdge, offsetTop + p1);
+                        }
+                    }
+                    prev = p1;
+                }
+#endif
+                int16_t x = vraster ? offsetLeft + p1 : offsetLeft + p2;
+                int16_t y = vraster ? offsetTop + p2 : offsetTop + p1;
+
+                if ( color && !clean ) {
+                    setColor(fg);
+                } else {
+                    setColor(bg);
+                }
+
+                if ( fontType == BITMASK_FONT || (0xc0 & b) > 0 ) {
+                    if ( fontType == ANTIALIASED_FONT ) {
+                        len = 0x3f & b;
+                        ctr += len;
+                    }
+
+                    if ( fontType == BITMASK_FONT || (0x80 & b) > 0 ) {
+
+                        while ( p2 + len > eff ) {
+                            if ( color ) {
+                                if ( vraster ) {
+                                    glyphFill(x, y, x, edge);
+                                } else {
+                                    glyphFill(x, y, edge, y);
+                                }
+                            }
+                            if (fontType == BITMASK_FONT) {
+                                ctr += eff - p2;
+                            }
+
+                            len -= eff - p2;
+                            p2 = 0;
+                            p1++;
+                            x = vraster ? offsetLeft + p1 : offsetLeft;
+                            y = vraster ? offsetTop : offsetTop + p1;
+
+#ifndef NO_FILL_TEXT_BACKGROUND
+                            if ( glyphPrintMode == FILL_TEXT_BACKGROUND ) {
+                                setColor(bg);
+                                if ( vraster ) {
+                                    glyphFill(x, yy, x, vEdge);
+                                } else {
+                                    glyphFill(xx, y, hEdge, y);
+                                }
+                                if ( !clean ) {
+                                    setColor(fg);
+                                }
+                                prev = p1;
+                            }
+#endif
+                        }
+
+                        if ( color ) {
+                            if ( vraster ) {
+                                glyphFill(x, y, x, y + len - 1);
+                            } else {
+                                glyphFill(x, y, x + len - 1, y);
+                            }
+                        } else {
+                            setColor(fg);
+                        }
+
+#ifndef NO_FILL_TEXT_BACKGROUND
+                    } else if ( fontType == ANTIALIASED_FONT && glyphPrintMode == FILL_TEXT_BACKGROUND ) {
+                        setColor(bg);
+                        while ( p2 + len > eff ) {
+                            len -= eff - p2;
+                            p2 = 0;
+                            p1++;
+                            x = vraster ? offsetLeft + p1 : offsetLeft;
+                            y = vraster ? offsetTop : offsetTop + p1;
+
+                            if ( vraster ) {
+                                glyphFill(x, yy, x, vEdge);
+                            } else {
+                                glyphFill(xx, y, hEdge, y);
+                            }
+                        }
+                        prev = p1;
+                        if ( !clean ) {
+                            setColor(fg);
+                        }
+#endif
+                    }
+                } else if (fontType == ANTIALIASED_FONT) {
+                    if ( clean ) {
+                        setColor(bg);
+                    } else {
+                        uint8_t opacity = (0xff & (b << 2));
+                        RGB* cl = computeColor(fg, opacity);
+                        setColor(cl);
+                    }
+                    glyphFill(x, y, x, y);
+                    ctr++;
+                }
+#ifndef NO_FILL_TEXT_BACKGROUND
+                last = p1;
+#endif
+            }
+            if ( fontType == BITMASK_FONT ) {
+                ctr += len;
+            }
+        }
+
+#ifndef NO_FILL_TEXT_BACKGROUND
+        if ( glyphPrintMode == FILL_TEXT_BACKGROUND ) {
+            setColor(bg);
+            if ( vraster ) {
+                glyphFill(offsetLeft + last + 1, yy, xx + glyphWidth - 1, yy + glyphHeight);
+            } else {
+                glyphFill(xx, offsetTop + last + 1, xx + glyphWidth - 1, yy + glyphHeight);
+            }
+        }
+#endif
+
+    } else {
+
+        if ( clean ) {
+            setColor(bg);
+        }
+
+        for ( int16_t i = 0; i < length; i++ ) {
+            int16_t b = 0xff & pgm_read_byte_near(data + 8 + i);
+            int16_t x = i * 8 % effWidth;
+            int16_t y = i * 8 / effWidth;
+
+#ifndef NO_FILL_TEXT_BACKGROUND
+            if ( glyphPrintMode == FILL_TEXT_BACKGROUND && prev != y ) {
+                setColor(bg);
+                if ( prev < 0 ) {
+                    glyphFill(xx, yy, xx + glyphWidth, yy + mTop);
+                } else {
+                    glyphFill(xx, offsetTop + y, hEdge, offsetTop + y);
+                }
+                if ( !clean ) {
+                    setColor(fg);
+                }
+                prev = y;
+            }
+#endif
+
+            for ( uint8_t j = 0; j < 8; j++ ) {
+                if ( x + j == effWidth ) {
+                    x = -j;
+                    y++;
+#ifndef NO_FILL_TEXT_BACKGROUND
+                    if ( glyphPrintMode == FILL_TEXT_BACKGROUND && prev != y ) {
+                        setColor(bg);
+                        glyphFill(xx, offsetTop + y, hEdge, offsetTop + y);
+                        if ( !clean ) {
+                            setColor(fg);
+                        }
+                        prev = y;
+                    }
+#endif
+                }
+                int mask = 1 << (7 - j);
+                if ( (b & mask) == 0 ) {
+                    glyphFill(offsetLeft + x + j, offsetTop + y, offsetLeft + x + j, offsetTop + y);
+                }
+            }
+#ifndef NO_FILL_TEXT_BACKGROUND
+            last = y;
+#endif
+        }
+
+#ifndef NO_FILL_TEXT_BACKGROUND
+        if ( glyphPrintMode == FILL_TEXT_BACKGROUND ) {
+            setColor(bg);
+            glyphFill(xx, offsetTop + last + 1, xx + glyphWidth, yy + glyphHeight);
+        }
+#endif
+    }
+
+    setColor(fg);
+}
+
+void PixelsBase::glyphFill(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+
+    if ( glyphScale == 256 ) {
+        if ( x1 > x2 ) {
+            swap(x1, x2);
+        }
+        x1 = max(x1, glyphClipX1);
+        x2 = min(x2, glyphClipX2);
+        if ( x2 < x1 ) {
+            return;
+        }
+        if ( x1 == x2 && y1 == y2 ) {
+            drawPixel(x1, y1);
+        } else {
+            fill(foreground->convertTo565(), x1, y1, x2, y2);
+        }
+        return;
+    }
+
+    // the scaled run covers the pixels from the scaled left edge up to the scaled right edge
+    int16_t sx1 = glyphX + (((int32_t)(x1 - glyphX) * glyphScale) >> 8);
+    int16_t sx2 = glyphX + (((int32_t)(x2 + 1 - glyphX) * glyphScale) >> 8) - 1;
+    int16_t sy1 = glyphY + (((int32_t)(y1 - glyphY) * glyphScale) >> 8);
+    int16_t sy2 = glyphY + (((int32_t)(y2 + 1 - glyphY) * glyphScale) >> 8) - 1;
+    sx1 = max(sx1, glyphClipX1);
+    sx2 = min(sx2, glyphClipX2);
+    if ( sx2 < sx1 || sy2 < sy1 ) {
+        return;
+    }
+    fill(foreground->convertTo565(), sx1, sy1, sx2, sy2);
+}
+
+void PixelsBase::scrollText( int16_t x, int16_t y, String text, uint8_t scrollStep, uint8_t repeat, uint16_t maxScroll ) {
+    Animation a;
+    prepareScrollText(a, x, y, text, scrollStep, repeat, maxScroll);
+    runAnimation(a);
+}
+
+void PixelsBase::prepareScrollText(Animation& a, int16_t x, int16_t y, String text, uint8_t scrollStep, uint8_t repeat, uint16_t maxScroll) {
+
+    if ( getOrientation() % 2 == 0 ) {
+        setOrientation(LANDSCAPE);
+    }
+
+    if ( repeat != 0  ) {
+        repeat++;
+    }
+
+    // the glyphs are looked up once, a step draws the newly exposed columns only
+    int16_t n = text.length();
+    a.glyphs = new uint16_t[n > 0 ? n : 1];
+    a.columns = new int16_t[n + 1];
+    if ( a.glyphs == NULL || a.columns == NULL ) {
+        releaseAnimation(a);
+        return;
+    }
+
+    a.columns[0] = 0;
+    for ( int16_t t = 0; t < n; t++ ) {
+        char c = text.charAt(t);
+        int16_t width = 0;
+        a.glyphs[t] = 0;
+
+        int16_t ptr = HEADER_LENGTH;
+        while ( currentFont != NULL ) {
+            char cx = (char)(((int)pgm_read_byte_near(currentFont + ptr + 0) << 8) + pgm_read_byte_near(currentFont + ptr + 1));
+            if ( cx == 0 ) {
+              break;
+            }
+            int16_t length = (((int)(pgm_read_byte_near(currentFont + ptr + 2) & 0xff) << 8) + (int)(pgm_read_byte_near(currentFont + ptr + 3) & 0xff));
+
+            if ( cx == c ) {
+                if ( length >= 8 ) {
+                    a.glyphs[t] = ptr;
+                    width = 0xff & pgm_read_byte_near(currentFont + ptr + 4);
+                }
+                break;
+            }
+            ptr += length;
+        }
+        a.columns[t + 1] = a.columns[t] + width;
+    }
+
+    int16_t bandStart = getScrollAreaStart();
+
+    a.count = a.columns[n] + x - bandStart;
+
+    a.easingLen = 5;
+    if ( a.count / 2 < a.easingLen) {
+        a.easingLen = a.count / 2;
+    }
+    a.count += a.easingLen;
+
+    if ( maxScroll > 0 ) {
+        a.count = maxScroll;
+        repeat = 2;
+    }
+
+    a.type = ANIMATION_MARQUEE;
+    a.font = currentFont;
+    a.glyphCount = n;
+    a.cursor = 0;
+    a.textX = x;
+    a.y = y;
+    a.step = scrollStep;
+    a.repeat = repeat;
+    a.maxScroll = maxScroll;
+    a.index = 0;
+    a.due = millis();
+}
+
+/*
+ * Draws the marquee glyph parts, which fall into the given columns of the absolute origin mode
+ */
+void PixelsBase::drawMarquee(Animation& a, int16_t x1, int16_t x2) {
+
+    if ( a.font == NULL ) {
+        return;
+    }
+    int16_t fontType = pgm_read_byte_near(a.font + 2);
+    if ( fontType != ANTIALIASED_FONT && fontType != BITMASK_FONT ) {
+        return;
+    }
+    int16_t glyphHeight = pgm_read_byte_near(a.font + 3);
+
+    int16_t c1 = x1 - a.textX;
+    int16_t c2 = x2 - a.textX;
+    while ( a.cursor < a.glyphCount && a.columns[a.cursor + 1] <= c1 ) {
+        a.cursor++;
+    }
+
+    boolean origin = relativeOrigin;
+    relativeOrigin = ORIGIN_ABSOLUTE;
+    glyphClipX1 = x1;
+    glyphClipX2 = x2;
+
+    beginGfxOperation();
+    for ( int16_t t = a.cursor; t < a.glyphCount && a.columns[t] <= c2; t++ ) {
+        if ( a.glyphs[t] == 0 ) {
+            continue;
+        }
+        prog_uchar* data = a.font + a.glyphs[t];
+        int16_t length = (((int)(pgm_read_byte_near(data + 2) & 0xff) << 8) + (int)(pgm_read_byte_near(data + 3) & 0xff));
+        drawGlyph(fontType, false, a.textX + a.columns[t], a.y, glyphHeight, data, length);
+    }
+    endGfxOperation();
+
+    glyphClipX1 = -0x7fff;
+    glyphClipX2 = 0x7fff;
+    relativeOrigin = origin;
+}
+
+boolean PixelsBase::marqueeStep(Animation& a) {
+
+    int16_t bandStart = getScrollAreaStart();
+    int16_t bandEnd = getScrollAreaEnd();
+
+    if ( a.index == 0 ) {
+        drawMarquee(a, bandStart, bandEnd - 1);
+    }
+
+    // the hardware scroll moves the rest, only the exposed strip is drawn
+    scroll(a.step, SCROLL_CLEAN);
+    a.textX -= a.step;
+    drawMarquee(a, bandEnd - a.step, bandEnd - 1);
+
+    int dlx = 8;
+    int factor = 3;
+    if ( a.index < a.easingLen ) {
+        a.due += dlx+(a.easingLen-a.index)*(a.easingLen-a.index)*factor/2;
+    } else {
+        if ( a.count > 150 ) {
+            a.due += factor;
+        } else {
+            a.due += dlx+factor;
+        }
+    }
+
+    a.index += a.step;
+    if ( a.index < a.count ) {
+        return true;
+    }
+
+    a.index = 0;
+    a.cursor = 0;
+    a.easingLen = 0;
+
+    a.textX = bandEnd;
+    a.count = bandEnd - bandStart + a.columns[a.glyphCount];
+
+    if ( a.maxScroll <= 0 ) {
+        scroll(-getScroll(), 0);
+    }
+
+    if ( a.repeat != 0 ) {
+        a.repeat--;
+    }
+    return a.repeat == 0 || a.repeat > 1;
+}
+
 
-        for ( int16_t i = 0; i < length; i++ ) {
-            int16_t p1 = ctr / eff;
-            int16_t p2 = ctr % eff;
+/* Low level */
 
-            int16_t b = 0xff & pgm_read_byte_near(data + 8 + i);
-            int16_t len = 0x7f & b;
-            boolean color = fontType == BITMASK_FONT ? (0x80 & b) > 0 : true;
+void PixelsBase::putColor(int16_t x, int16_t y, boolean steep, double alpha) {
 
-            if ( color || glyphPrintMode == FILL_TEXT_BACKGROUND ) {
+    if ( steep ) {
+        int16_t tmp = x;
+        x = y;
+        y = tmp;
+    }
 
-#ifndef NO_FILL_TEXT_BACKGROUND
-                if ( glyphPrintMode == FILL_TEXT_BACKGROUND && prev != p1 ) {
-                    setColor(bg);
-                    if ( vraster ) {
-                        if ( prev < 0 ) {
-                            fillRectangle(xx, yy, mLeft + 1, glyphHeight + 1);
-                        } else {
-                            vLine(offsetLeft + p1, yy, vEdge);
-                        }
-                    } else {
-                        if ( prev < 0 ) {
-                            fillRectangle(xx, yy, glyphWidth + 1, mTop + 1);
-                        } else {
-                            hLine(xx, offsetTop + p1, hEdge);
-                        }
-                    }
-                    prev = p1;
-                }
-#endif
-                int16_t x = vraster ? offsetLeft + p1 : offsetLeft + p2;
-                int16_t y = vraster ? offsetTop + p2 : offsetTop + p1;
+    if ( x < 0 || x >= width || y < 0 || y >= height || isClipped(x, y) ) {
+        return;
+    }
 
-                if ( color && !clean ) {
-                    setColor(fg);
-                } else {
-                    setColor(bg);
-                }
+    RGB* result;
+    if ( alpha != 1 ) {
+        RGB* bg = getPixel(x, y);
+        result = computeColor(bg, alpha);
+        RGB* sav = getColor();
+        setColor(result);
+        drawPixel(x, y);
+        setColor(sav);
+    } else {
+        drawPixel(x, y);
+    }
+}
 
-                if ( fontType == BITMASK_FONT || (0xc0 & b) > 0 ) {
-                    if ( fontType == ANTIALIASED_FONT ) {
-                        len = 0x3f & b;
-                        ctr += len;
-                    }
 
-                    if ( fontType == BITMASK_FONT || (0x80 & b) > 0 ) {
+RGB* PixelsBase::computeColor(RGB* bg, double alpha) {
+    if ( alpha < 0 ) {
+        alpha = 0;
+        return bg;
+    }
+    if ( alpha > 1 ) {
+        alpha = 1;
+    }
+    computedBgColor->setColor( (int32_t)(bg->red * (1 - alpha) + foreground->red * alpha),
+        (int32_t)(bg->green * (1 - alpha) + foreground->green * alpha),
+        (int32_t)(bg->blue * (1 - alpha) + foreground->blue * alpha));
 
-                        while ( p2 + len > eff ) {
-                            if ( color ) {
-                                if ( vraster ) {
-                                    vLine(x, y, edge);
-                                } else {
-                                    hLine(x, y, edge);
-                                }
-                            }
-                            if (fontType == BITMASK_FONT) {
-                                ctr += eff - p2;
-                            }
+    return computedBgColor;
+}
 
-                            len -= eff - p2;
-                            p2 = 0;
-                            p1++;
-                            x = vraster ? offsetLeft + p1 : offsetLeft;
-                            y = vraster ? offsetTop : offsetTop + p1;
+RGB* PixelsBase::computeColor(RGB* fg, uint8_t opacity) {
+    int32_t sr = (int32_t)fg->red * (255 - opacity) + background->red * opacity;
+    int32_t sg = (int32_t)fg->green * (255 - opacity) + background->green * opacity;
+    int32_t sb = (int32_t)fg->blue * (255 - opacity) + background->blue * opacity;
+    sr /= 255;
+    sg /= 255;
+    sb /= 255;
+    if ( sr > 255 ) {
+        sr = 255;
+    }
+    if ( sg > 255 ) {
+        sg = 255;
+    }
+    if ( sb > 255 ) {
+        sb = 255;
+    }
+    computedFgColor->setColor(sr, sg, sb);
 
-#ifndef NO_FILL_TEXT_BACKGROUND
-                            if ( glyphPrintMode == FILL_TEXT_BACKGROUND ) {
-                                setColor(bg);
-                                if ( vraster ) {
-                                    vLine(x, yy, vEdge);
-                                } else {
-                                    hLine(xx, y, hEdge);
-                                }
-                                if ( !clean ) {
-                                    setColor(fg);
-                                }
-                                prev = p1;
-                            }
-#endif
-                        }
+    return computedFgColor;
+}
 
-                        if ( color ) {
-                            if ( vraster ) {
-                                vLine(x, y, y + len - 1);
-                            } else {
-                                hLine(x, y, x + len - 1);
-                            }
-                        } else {
-                            setColor(fg);
-                        }
+void PixelsBase::scroll(int16_t dy, int8_t flags) {
+    scroll(dy, 0, deviceWidth, flags);
+}
 
-#ifndef NO_FILL_TEXT_BACKGROUND
-                    } else if ( fontType == ANTIALIASED_FONT && glyphPrintMode == FILL_TEXT_BACKGROUND ) {
-                        setColor(bg);
-                        while ( p2 + len > eff ) {
-                            len -= eff - p2;
-                            p2 = 0;
-                            p1++;
-                            x = vraster ? offsetLeft + p1 : offsetLeft;
-                            y = vraster ? offsetTop : offsetTop + p1;
+void PixelsBase::scroll(int16_t dy, int16_t x1, int16_t x2, int8_t flags) {
 
-                            if ( vraster ) {
-                                vLine(x, yy, vEdge);
-                            } else {
-                                hLine(xx, y, hEdge);
-                            }
-                        }
-                        prev = p1;
-                        if ( !clean ) {
-                            setColor(fg);
-                        }
-#endif
-                    }
-                } else if (fontType == ANTIALIASED_FONT) {
-                    if ( clean ) {
-                        setColor(bg);
-                    } else {
-                        uint8_t opacity = (0xff & (b << 2));
-                        RGB* cl = computeColor(fg, opacity);
-                        setColor(cl);
-                    }
-                    drawPixel(x, y);
-                    ctr++;
-                }
-#ifndef NO_FILL_TEXT_BACKGROUND
-                last = p1;
-#endif
+    if(!canScroll()) {
+        return;
+    }
+
+    int16_t mdy = dy > 0 ? dy : -dy;
+
+    if (mdy > 1 && (flags & SCROLL_SMOOTH) > 0) {
+
+        Animation a;
+        prepareScroll(a, dy, x1, x2, flags);
+        runAnimation(a);
+
+    } else {
+
+        RGB* sav = getColor();
+        setColor(getBackground());
+        boolean savorigin = relativeOrigin;
+        relativeOrigin = false;
+
+        beginGfxOperation();
+
+        int16_t start = getScrollAreaStart();
+
+        if ( (flags & SCROLL_CLEAN) > 0 && dy > 0 ) {
+            if( (orientation % 2) == 0 ) { // PORTRAIT(_FLIP)
+                fillRectangle(0, start, deviceWidth, mdy);
+            } else {
+                fillRectangle(start, 0, mdy, deviceWidth);
             }
-            if ( fontType == BITMASK_FONT ) {
-                ctr += len;
+        }
+
+        currentScroll += dy;
+        while ( currentScroll < 0 ) {
+            currentScroll += scrollBand();
+        }
+        currentScroll %= scrollBand();
+
+        scrollCmd();
+
+        if ( (flags & SCROLL_CLEAN) > 0 && dy < 0 ) {
+            if( (orientation % 2) == 0 ) { // PORTRAIT(_FLIP)
+                fillRectangle(0, start, deviceWidth, mdy);
+            } else {
+                fillRectangle(start, 0, mdy, deviceWidth);
+            }
+        }
+
+        relativeOrigin = savorigin;
+        setColor(sav);
+
+        endGfxOperation(true);
+    }
+}
+
+
+void PixelsBase::prepareScroll(Animation& a, int16_t dy, int16_t x1, int16_t x2, int8_t flags) {
+
+    int16_t mdy = dy > 0 ? dy : -dy;
+
+    a.type = ANIMATION_SCROLL;
+    a.flags = flags;
+    a.x1 = x1;
+    a.x2 = x2;
+    a.index = 0;
+
+    if (mdy > 1 && (flags & SCROLL_SMOOTH) > 0) {
+        a.easingLen = 8;
+        if ( mdy / 2 < a.easingLen) {
+            a.easingLen = mdy / 2;
+        }
+        a.count = mdy;
+        a.step = dy < 0 ? -1 : 1;
+    } else {
+        a.easingLen = 0;
+        a.count = 1;
+        a.step = dy;
+    }
+
+    a.due = millis() + scrollStepDelay(a, 0, true);
+}
+
+/*
+ * The pause before (easing in) or after a smooth scroll step k
+ */
+uint16_t PixelsBase::scrollStepDelay(Animation& a, int16_t k, boolean before) {
+
+    if ( (a.flags & SCROLL_SMOOTH) == 0 || a.count < 2 ) {
+        return 0;
+    }
+
+    int16_t dlx = (a.flags & SCROLL_CLEAN) > 0 ? 0 : 7;
+    int16_t factor = 1;
+    int16_t e = a.easingLen;
+
+    if ( k < e ) {
+        return before ? dlx+(e-k)*(e-k)*factor/2+extraScrollDelay : 0;
+    }
+    if ( before ) {
+        return 0;
+    }
+    if ( k < a.count - e ) {
+        return a.count > 150 ? factor : dlx+factor+extraScrollDelay;
+    }
+    k -= a.count - e - 1;
+    return dlx+k*k*factor/2+extraScrollDelay;
+}
+
+boolean PixelsBase::animationStep(Animation& a) {
+
+    if ( a.type == ANIMATION_MARQUEE ) {
+        return marqueeStep(a);
+    }
+
+    scroll(a.step, a.x1, a.x2, a.flags & SCROLL_CLEAN);
+
+    a.due += scrollStepDelay(a, a.index, false);
+    a.index++;
+    if ( a.index >= a.count ) {
+        return false;
+    }
+    a.due += scrollStepDelay(a, a.index, true);
+    return true;
+}
+
+void PixelsBase::runAnimation(Animation& a) {
+    boolean running = a.type != ANIMATION_NONE;
+    while ( true ) {
+        // the pause after the last step is kept, so consecutive calls keep their pace
+        int32_t wait = (int32_t)(a.due - millis());
+        if ( wait > 0 ) {
+            delay(wait);
+        }
+        if ( !running ) {
+            break;
+        }
+        running = animationStep(a);
+    }
+    releaseAnimation(a);
+}
+
+void PixelsBase::releaseAnimation(Animation& a) {
+    a.type = ANIMATION_NONE;
+    delete[] a.glyphs;
+    delete[] a.columns;
+    a.glyphs = NULL;
+    a.columns = NULL;
+}
+
+int8_t PixelsBase::startAnimation(Animation& a) {
+    if ( a.type != ANIMATION_NONE ) {
+        for ( int8_t i = 0; i < MAX_ANIMATIONS; i++ ) {
+            if ( animations[i].type == ANIMATION_NONE ) {
+                animations[i] = a;
+                return i;
             }
         }
+    }
+    releaseAnimation(a);
+    return -1;
+}
+
+void PixelsBase::stopAnimation(int8_t handle) {
+    if ( handle >= 0 && handle < MAX_ANIMATIONS ) {
+        releaseAnimation(animations[handle]);
+    }
+}
+
+int8_t PixelsBase::startScroll(int16_t dy, int16_t x1, int16_t x2, int8_t flags) {
+    if ( !canScroll() ) {
+        return -2;
+    }
+    Animation a;
+    prepareScroll(a, dy, x1, x2, flags);
+    return startAnimation(a);
+}
 
-#ifndef NO_FILL_TEXT_BACKGROUND
-        if ( glyphPrintMode == FILL_TEXT_BACKGROUND ) {
-            setColor(bg);
-            if ( vraster ) {
-                fillRectangle(offsetLeft + last + 1, yy, glyphWidth - mLeft - last - 1, glyphHeight + 1);
-            } else {
-                fillRectangle(xx, offsetTop + last + 1, glyphWidth, glyphHeight - mTop - last);
+int8_t PixelsBase::startScrollText(int16_t x, int16_t y, String text, uint8_t scrollStep, uint8_t repeat, uint16_t maxScroll) {
+    if ( !canScroll() ) {
+        return -2;
+    }
+    Animation a;
+    prepareScrollText(a, x, y, text, scrollStep, repeat, maxScroll);
+    return startAnimation(a);
+}
+
+void PixelsBase::tick(uint32_t now) {
+    for ( int8_t i = 0; i < MAX_ANIMATIONS; i++ ) {
+        Animation& a = animations[i];
+        while ( a.type != ANIMATION_NONE && (int32_t)(now - a.due) >= 0 ) {
+            if ( !animationStep(a) ) {
+                releaseAnimation(a);
             }
         }
-#endif
+    }
+}
+
+boolean PixelsBase::setScrollArea(int16_t topFixed, int16_t bottomFixed) {
+
+    if ( topFixed < 0 || bottomFixed < 0 || topFixed + bottomFixed >= deviceHeight ) {
+        return false;
+    }
+
+    int16_t top = scrollTop;
+    int16_t bottom = scrollBottom;
 
+    // flipped orientations run against the device rows
+    scrollTop = orientation > 1 ? bottomFixed : topFixed;
+    scrollBottom = orientation > 1 ? topFixed : bottomFixed;
+
+    beginGfxOperation();
+    boolean result = scrollAreaCmd();
+    if ( result ) {
+        currentScroll = 0;
+        scrollCmd();
     } else {
+        scrollTop = top;
+        scrollBottom = bottom;
+    }
+    endGfxOperation();
 
-        if ( clean ) {
-            setColor(bg);
-        }
+    return result;
+}
 
-        for ( int16_t i = 0; i < length; i++ ) {
-            int16_t b = 0xff & pgm_read_byte_near(data + 8 + i);
-            int16_t x = i * 8 % effWidth;
-            int16_t y = i * 8 / effWidth;
+/*
+ * The scroll position in the device row direction
+ */
+int16_t PixelsBase::deviceScroll() {
+    return orientation > 1 ? (scrollBand() - currentScroll) % scrollBand() : currentScroll;
+}
 
-#ifndef NO_FILL_TEXT_BACKGROUND
-            if ( glyphPrintMode == FILL_TEXT_BACKGROUND && prev != y ) {
-                setColor(bg);
-                if ( prev < 0 ) {
-                    fillRectangle(xx, yy, glyphWidth + 1, mTop + 1);
-                } else {
-                    hLine(xx, offsetTop + y, hEdge);
-                }
-                if ( !clean ) {
-                    setColor(fg);
-                }
-                prev = y;
-            }
-#endif
+/*
+ * Maps a physical device row to the video RAM row, which is currently shown there
+ */
+int16_t PixelsBase::scrollRow(int16_t y) {
+    if ( y < scrollTop || y >= deviceHeight - scrollBottom ) {
+        return y;
+    }
+    return scrollTop + (y - scrollTop + deviceScroll()) % scrollBand();
+}
 
-            for ( uint8_t j = 0; j < 8; j++ ) {
-                if ( x + j == effWidth ) {
-                    x = -j;
-                    y++;
-#ifndef NO_FILL_TEXT_BACKGROUND
-                    if ( glyphPrintMode == FILL_TEXT_BACKGROUND && prev != y ) {
-                        setColor(bg);
-                        hLine(xx, offsetTop + y, hEdge);
-                        if ( !clean ) {
-                            setColor(fg);
-                        }
-                        prev = y;
-                    }
-#endif
-                }
-                int mask = 1 << (7 - j);
-                if ( (b & mask) == 0 ) {
-                    drawPixel(offsetLeft + x + j, offsetTop + y);
-                }
-            }
-#ifndef NO_FILL_TEXT_BACKGROUND
-            last = y;
-#endif
+/*
+ * Number of device rows starting at physical row y (video RAM row yy), which stay contiguous
+ * in video RAM while going in the dir direction
+ */
+int16_t PixelsBase::scrollRun(int16_t y, int16_t yy, int8_t dir) {
+    int16_t top = scrollTop;
+    int16_t bottom = deviceHeight - scrollBottom;
+    if ( relativeOrigin ) {
+        return dir > 0 ? deviceHeight - y : y + 1;
+    }
+    if ( dir > 0 ) {
+        if ( y < top ) {
+            return top - y;
         }
+        return y < bottom ? min(bottom - y, bottom - yy) : deviceHeight - y;
+    }
+    if ( y >= bottom ) {
+        return y - bottom + 1;
+    }
+    return y >= top ? min(y - top + 1, yy - top + 1) : y + 1;
+}
 
-#ifndef NO_FILL_TEXT_BACKGROUND
-        if ( glyphPrintMode == FILL_TEXT_BACKGROUND ) {
-            setColor(bg);
-            fillRectangle(xx, offsetTop + last + 1, glyphWidth + 1, glyphHeight - mTop - last);
+/*
+ * Splits physical device bounds into video RAM pieces: the fixed areas stay in place, the scrolling
+ * band part wraps around within the band. Returns the number of pieces (up to 4); shifts get the video
+ * RAM row offsets of the pieces in relation to the physical rows.
+ */
+uint8_t PixelsBase::scrollPieces(Bounds& bb, Bounds* pieces, int16_t* shifts) {
+
+    int16_t top = scrollTop;
+    int16_t bottom = deviceHeight - scrollBottom;
+    uint8_t n = 0;
+
+    if ( bb.y1 < top ) {
+        pieces[n] = Bounds(bb.x1, bb.y1, bb.x2, min(bb.y2, top - 1));
+        shifts[n++] = 0;
+    }
+
+    int16_t y1 = max(bb.y1, top);
+    int16_t y2 = min(bb.y2, bottom - 1);
+    if ( y1 <= y2 ) {
+        int16_t r = scrollRow(y1);
+        int16_t len = min(y2 - y1 + 1, bottom - r);
+        pieces[n] = Bounds(bb.x1, r, bb.x2, r + len - 1);
+        shifts[n++] = r - y1;
+        if ( len <= y2 - y1 ) {
+            pieces[n] = Bounds(bb.x1, top, bb.x2, top + y2 - y1 - len);
+            shifts[n++] = top - y1 - len;
         }
-#endif
     }
 
-    setColor(fg);
+    if ( bb.y2 >= bottom ) {
+        pieces[n] = Bounds(bb.x1, max(bb.y1, bottom), bb.x2, bb.y2);
+        shifts[n++] = 0;
+    }
+
+    return n;
 }
 
-void PixelsBase::scrollText( int16_t x, int16_t y, String text, uint8_t scrollStep, uint8_t repeat, uint16_t maxScroll ) {
+void PixelsBase::drawPixel(int16_t x, int16_t y) {
 
-    int extraRowDelay = 0; // increase to slow down
+    if ( dlRecording ) {
+        int16_t args[] = {x, y};
+        recordCommand(DL_PIXEL, args, sizeof(args));
+        return;
+    }
 
-    if ( getOrientation() % 2 == 0 ) {
-        setOrientation(LANDSCAPE);
+    int16_t xx, yy;
+    if ( !pixelToDevice(x, y, xx, yy) ) {
+        return;
     }
 
-    if ( repeat != 0  ) {
-        repeat++;
+    beginGfxOperation();
+    deviceRegion(xx, yy, xx, yy);
+    setCurrentPixel(foreground);
+    endGfxOperation();
+}
+
+void PixelsBase::drawPixels(int16_t* points, uint16_t count) {
+    if ( dlRecording ) {
+        int16_t args[] = {(int16_t)count};
+        recordCommand(DL_PIXELS, args, sizeof(args), &points, sizeof(points));
+        return;
     }
 
-    int maxX = getWidth() - 1;
-    int tw = getTextWidth(text);
+    if ( points == NULL || count < 1 ) {
+        return;
+    }
 
-    int skip = -1;
-    int loopLen = tw + x;
-    int space = maxX - x;
+    int color = foreground->convertTo565();
+    beginGfxOperation();
+    uint16_t i = 0;
+    while ( i < count ) {
+        int16_t x = points[2 * i];
+        int16_t y = points[2 * i + 1];
+        uint16_t n = 1;
+        while ( i + n < count && points[2 * (i + n) + 1] == y && points[2 * (i + n)] == x + (int16_t)n ) {
+            n++;
+        }
+        if ( n > 1 ) {
+            fill(color, x, y, x + n - 1, y);
+        } else {
+            int16_t xx, yy;
+            if ( pixelToDevice(x, y, xx, yy) ) {
+                deviceRegion(xx, yy, xx, yy);
+                setCurrentPixel((int16_t)color);
+            }
+        }
+        i += n;
+    }
+    endGfxOperation();
+}
 
-    if (getScroll() > 0) {
-        skip = (x - getScroll()) % getWidth();
-        loopLen += maxX - getScroll();
-        space = getScroll() - x;
+/*
+ * Maps a logical pixel to the video RAM
+ * @return false if the pixel is off the screen, out of the clip or scrolled out
+ */
+boolean PixelsBase::pixelToDevice(int16_t x, int16_t y, int16_t& xx, int16_t& yy) {
+    if ( x < 0 || y < 0 || x >= width || y >= height || isClipped(x, y) ) {
+        return false;
     }
 
-    int easingLen = 5;
-    if ( loopLen / 2 < easingLen) {
-        easingLen = loopLen / 2;
+    logicalToDevice(x, y, xx, yy);
+
+    // the relative origin mode clips the part of the band, which is scrolled out
+    Bounds bb(xx, yy, xx, yy);
+    return checkBounds(bb);
+}
+
+void PixelsBase::fill(int color, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+
+    Bounds bb(x1, y1, x2, y2);
+    if( !clipBounds(bb) || !transformBounds(bb) ) {
+        return;
     }
-    loopLen += easingLen;
 
-    int dlx = 8;
-    int factor = 3 + extraRowDelay;
-    int remains = 0;
+    Bounds pieces[4];
+    int16_t shifts[4];
+    uint8_t n = 1;
+    if ( relativeOrigin ) {
+        pieces[0] = bb;
+    } else {
+        n = scrollPieces(bb, pieces, shifts);
+    }
 
-    long maxLatency = 0;
-    boolean firstLoop = true;
+    beginGfxOperation();
 
-    if ( maxScroll > 0 ) {
-        loopLen = maxScroll;
-        repeat = 2;
+    for ( uint8_t i = 0; i < n; i++ ) {
+        Bounds& p = pieces[i];
+        if ( sliceHandler == NULL || fbData != NULL ) {
+            deviceFill(color, p.x1, p.y1, p.x2, p.y2);
+            continue;
+        }
+        for ( int16_t y = p.y1; y <= p.y2; y += sliceRows ) {
+            if ( y > p.y1 ) {
+                yieldSlice();
+            }
+            deviceFill(color, p.x1, y, p.x2, min(p.y2, y + sliceRows - 1));
+        }
     }
 
-    do {
-        for ( int i = 0; i < loopLen; i+=scrollStep ) {
+    endGfxOperation();
+}
 
-            long startMillis = millis();
+/*
+ * Releases the bus for the slice handler in between two chunks of a long operation
+ */
+void PixelsBase::yieldSlice() {
+    void (*handler)() = sliceHandler;
+    // a drawing attempt of the handler would not be sliced again
+    sliceHandler = NULL;
+    chipDeselect();
+    handler();
+    chipSelect();
+    sliceHandler = handler;
+}
 
-            int p = -1;
-            int e = -1;
-            int xx = 0;
-            int cw = 0;
+void PixelsBase::hLine(int16_t x1, int16_t y, int16_t x2) {
+    fill(foreground->convertTo565(), x1, y, x2, y);
+}
 
-            int l = 0;
-            int f = 0;
-            for (int t = 0; t < (int)text.length(); t++) {
-                char c = text.charAt(t);
-                f = l;
-                cw = getCharWidth(c);
-                if ( cw < 0 ) {
-                    return;
-                }
-                l += cw;
-                if ( l > remains && p < 0 ) {
-                    xx = f;
-                    p = t;
-                }
-                if ( l > space ) {
-                    e = t + 1;
-                    break;
-                }
-            }
-            if ( p < 0 ) {
-                p = text.length();
-            }
-            if ( e < 0 ) {
-                e = text.length();
-            }
+void PixelsBase::vLine(int16_t x, int16_t y1, int16_t y2) {
+    fill(foreground->convertTo565(), x, y1, x, y2);
+}
 
-            String s = text.substring(p, e);
-            int q = (x + xx) % getWidth();
+uint16_t PixelsBase::blendColor(uint16_t fg, uint16_t bg, uint8_t weight, uint8_t maxWeight) {
+    uint16_t r = (((fg >> 11) & 0x1F) * weight + ((bg >> 11) & 0x1F) * (maxWeight - weight)) / maxWeight;
+    uint16_t g = (((fg >> 5) & 0x3F) * weight + ((bg >> 5) & 0x3F) * (maxWeight - weight)) / maxWeight;
+    uint16_t b = ((fg & 0x1F) * weight + (bg & 0x1F) * (maxWeight - weight)) / maxWeight;
+    return (r << 11) | (g << 5) | b;
+}
 
-            if ( q != 0 || x != getWidth() || getScroll() != 0 ) {
-                if (i > skip) {
-                    print(q, y, s);
-                }
-            }
-            if ( q > maxX - cw && q > getScroll() && getScroll() != 0 ) {
-                print(q - getWidth(), y, s);
-            }
+void PixelsBase::readRasterLine(int16_t x, int16_t y, int16_t length, uint16_t* raster) {
+    readPixels(x, y, length, raster);
+}
 
-            remains = space;
-            space += scrollStep;
-            scroll(scrollStep, SCROLL_CLEAN);
+/*
+ * Reads a logical row from the frame buffer or from the video RAM; pixels off the screen get the
+ * background color. A row goes along a device row or column, which wraps around by the scroll, so
+ * it is read with at most two regions. Returns false if there is nothing to read the pixels from.
+ */
+boolean PixelsBase::readPixels(int16_t x, int16_t y, int16_t length, uint16_t* raster) {
+    uint16_t c = background->convertTo565();
+    for ( int16_t i = 0; i < length; i++ ) {
+        raster[i] = c;
+    }
 
-            long endMillis = millis();
-#ifndef PIXELMEISTER
-            if ( s.length() < 3 ) {
-                long latency = endMillis - startMillis;
+    if ( y < 0 || y >= height ) {
+        return false;
+    }
 
-                if (maxLatency > latency) {
-                    delay((int)(maxLatency - latency));
-                } else {
-                    if( firstLoop ) {
-                        maxLatency = latency;
-                    }
-                }
+    if ( fbData != NULL ) {
+        int16_t fbWidth = fbBounds.x2 - fbBounds.x1 + 1;
+        for ( int16_t i = 0; i < length; i++ ) {
+            if ( x + i < 0 || x + i >= width ) {
+                continue;
             }
-#endif
-
-            if ( i < easingLen ) {
-                delay(dlx+(easingLen-i)*(easingLen-i)*factor/2);
-            } else {
-                if ( loopLen > 150 ) {
-                    delay(factor);
-                } else {
-                    delay(dlx+factor);
-                }
+            int16_t xx, yy;
+            logicalToDevice(x + i, y, xx, yy);
+            if ( xx >= fbBounds.x1 && xx <= fbBounds.x2 && yy >= fbBounds.y1 && yy <= fbBounds.y2 ) {
+                raster[i] = fbData[(int32_t)(yy - fbBounds.y1) * fbWidth + xx - fbBounds.x1];
             }
-            startMillis = endMillis;
         }
+        return true;
+    }
 
-        firstLoop = false;
-
-        remains = 0;
-        space = 0;
-        easingLen = 0;
-        skip = -1;
+    int16_t i = x < 0 ? -x : 0;
+    int16_t end = x + length > width ? width - x : length;
 
-        x = getWidth();
-        loopLen = x + tw;
+    boolean origin = relativeOrigin;
+    boolean result = true;
 
-        if ( maxScroll <= 0 ) {
-            scroll(-getScroll(), 0);
-        }
+    beginGfxOperation();
+    while ( i < end ) {
+        int16_t xx, yy;
+        logicalToDevice(x + i, y, xx, yy);
 
-        if ( repeat != 0 ) {
-            repeat--;
+        int16_t n = end - i;
+        Bounds bb(xx, yy, xx, yy);
+        switch( orientation ) {
+        case LANDSCAPE:
+            n = min(n, scrollRun(x + i, yy, 1));
+            bb.y2 = yy + n - 1;
+            break;
+        case PORTRAIT_FLIP:
+            bb.x1 = xx - n + 1;
+            break;
+        case LANDSCAPE_FLIP:
+            n = min(n, scrollRun(deviceHeight - x - i - 1, yy, -1));
+            bb.y1 = yy - n + 1;
+            break;
+        default:
+            bb.x2 = xx + n - 1;
+            break;
         }
-    } while ( repeat == 0 || repeat > 1 );
-}
 
+        // the region is in device coordinates, so no scroll related clipping is needed
+        relativeOrigin = ORIGIN_ABSOLUTE;
+        int32_t read = readRegion(bb.x1, bb.y1, bb.x2, bb.y2, raster + i);
+        relativeOrigin = origin;
 
-/* Low level */
-
-void PixelsBase::putColor(int16_t x, int16_t y, boolean steep, double alpha) {
-
-    if ( steep ) {
-        int16_t tmp = x;
-        x = y;
-        y = tmp;
+        if ( read < 0 ) {
+            result = false;
+            break;
+        }
+        if ( orientation > 1 ) {
+            // the region is read against the logical row direction
+            for ( int16_t l = i, r = i + n - 1; l < r; l++, r-- ) {
+                swap(raster[l], raster[r]);
+            }
+        }
+        i += n;
     }
+    endGfxOperation();
 
-    if ( x < 0 || x >= width || y < 0 || y >= height ) {
-        return;
+    return result;
+}
+
+void PixelsBase::logicalToDevice(int16_t x, int16_t y, int16_t& xx, int16_t& yy) {
+    switch( orientation ) {
+    case LANDSCAPE:
+        xx = deviceWidth - y - 1;
+        yy = x;
+        break;
+    case PORTRAIT_FLIP:
+        xx = deviceWidth - x - 1;
+        yy = deviceHeight - y - 1;
+        break;
+    case LANDSCAPE_FLIP:
+        xx = y;
+        yy = deviceHeight - x - 1;
+        break;
+    default:
+        xx = x;
+        yy = y;
+        break;
     }
 
-    RGB* result;
-    if ( alpha != 1 ) {
-        RGB* bg = getPixel(x, y);
-        result = computeColor(bg, alpha);
-        RGB* sav = getColor();
-        setColor(result);
-        drawPixel(x, y);
-        setColor(sav);
-    } else {
-        drawPixel(x, y);
+    if ( !relativeOrigin ) {
+        yy = scrollRow(yy);
     }
 }
 
+boolean PixelsBase::enableFrameBuffer(uint16_t* buffer, int16_t x, int16_t y, int16_t width, int16_t height) {
 
-RGB* PixelsBase::computeColor(RGB* bg, double alpha) {
-    if ( alpha < 0 ) {
-        alpha = 0;
-        return bg;
+    disableFrameBuffer();
+
+    Bounds bb(x, y, x + width - 1, y + height - 1);
+    if ( bb.x1 < 0 ) {
+        bb.x1 = 0;
     }
-    if ( alpha > 1 ) {
-        alpha = 1;
+    if ( bb.y1 < 0 ) {
+        bb.y1 = 0;
     }
-    computedBgColor->setColor( (int32_t)(bg->red * (1 - alpha) + foreground->red * alpha),
-        (int32_t)(bg->green * (1 - alpha) + foreground->green * alpha),
-        (int32_t)(bg->blue * (1 - alpha) + foreground->blue * alpha));
-
-    return computedBgColor;
-}
-
-RGB* PixelsBase::computeColor(RGB* fg, uint8_t opacity) {
-    int32_t sr = (int32_t)fg->red * (255 - opacity) + background->red * opacity;
-    int32_t sg = (int32_t)fg->green * (255 - opacity) + background->green * opacity;
-    int32_t sb = (int32_t)fg->blue * (255 - opacity) + background->blue * opacity;
-    sr /= 255;
-    sg /= 255;
-    sb /= 255;
-    if ( sr > 255 ) {
-        sr = 255;
+    if ( bb.x2 >= deviceWidth ) {
+        bb.x2 = deviceWidth - 1;
     }
-    if ( sg > 255 ) {
-        sg = 255;
+    if ( bb.y2 >= deviceHeight ) {
+        bb.y2 = deviceHeight - 1;
     }
-    if ( sb > 255 ) {
-        sb = 255;
+    if ( bb.x2 < bb.x1 || bb.y2 < bb.y1 ) {
+        return false;
+    }
+
+    int32_t size = (int32_t)(bb.x2 - bb.x1 + 1) * (bb.y2 - bb.y1 + 1);
+
+    fbOwned = buffer == NULL;
+    if ( fbOwned ) {
+        buffer = new uint16_t[size];
+        if ( buffer == NULL ) {
+            return false;
+        }
     }
-    computedFgColor->setColor(sr, sg, sb);
 
-    return computedFgColor;
-}
+    // the display content is unknown, so the buffer starts with the background color
+    uint16_t c = background->convertTo565();
+    for ( int32_t i = 0; i < size; i++ ) {
+        buffer[i] = c;
+    }
 
-void PixelsBase::scroll(int16_t dy, int8_t flags) {
-    scroll(dy, 0, deviceWidth, flags);
+    fbData = buffer;
+    fbBounds = bb;
+    dirtyCount = 0;
+    return true;
 }
 
-void PixelsBase::scroll(int16_t dy, int16_t x1, int16_t x2, int8_t flags) {
+void PixelsBase::disableFrameBuffer() {
+    if ( fbData == NULL ) {
+        return;
+    }
+    flushFrameBuffer();
+    if ( fbOwned ) {
+        delete[] fbData;
+    }
+    fbData = NULL;
+    fbOwned = false;
+}
 
-    if(!canScroll()) {
+void PixelsBase::flushFrameBuffer() {
+    if ( fbData == NULL || dirtyCount == 0 ) {
         return;
     }
 
-    int16_t mdy = dy > 0 ? dy : -dy;
+    // dirty areas are in device coordinates, so no scroll related clipping is needed
+    boolean origin = relativeOrigin;
+    relativeOrigin = ORIGIN_ABSOLUTE;
 
-    if (mdy > 1 && (flags & SCROLL_SMOOTH) > 0) {
+    int16_t fbWidth = fbBounds.x2 - fbBounds.x1 + 1;
 
-        int16_t easingLen = 8;
-        if ( mdy / 2 < easingLen) {
-            easingLen = mdy / 2;
+    beginGfxOperation();
+    for ( uint8_t i = 0; i < dirtyCount; i++ ) {
+        Bounds& bb = dirtyRects[i];
+        setRegion(bb.x1, bb.y1, bb.x2, bb.y2);
+        for ( int16_t y = bb.y1; y <= bb.y2; y++ ) {
+            deviceWriteBlock(fbData + (int32_t)(y - fbBounds.y1) * fbWidth + bb.x1 - fbBounds.x1, bb.x2 - bb.x1 + 1);
         }
+    }
+    endGfxOperation();
 
-        int16_t dlx = (flags & SCROLL_CLEAN) > 0 ? 0 : 7;
-        int16_t factor = 1;
+    relativeOrigin = origin;
+    dirtyCount = 0;
+}
 
-        int16_t step = dy < 0 ? -1 : 1;
-        for ( int16_t i = 0; i < easingLen; i++ ) {
-            delay(dlx+(easingLen-i)*(easingLen-i)*factor/2+extraScrollDelay);
-            scroll(step, x1, x2, flags & SCROLL_CLEAN);
-        }
-        for ( int16_t i = 0; i < mdy - easingLen*2; i++ ) {
-            scroll(step, x1, x2, flags & SCROLL_CLEAN);
-            if ( mdy > 150 ) {
-                delay(factor);
-            } else {
-                delay(dlx+factor+extraScrollDelay);
-            }
-        }
-        for ( int16_t i = 1; i <= easingLen; i++ ) {
-            scroll(step, x1, x2, flags & SCROLL_CLEAN);
-            delay(dlx+i*i*factor/2+extraScrollDelay);
-        }
+/*
+ * Adds a changed area to the dirty list. Areas are merged while their bounding box costs
+ * no more pixels than the areas separately; if the list is full, the cheapest merge is taken.
+ */
+void PixelsBase::addDirtyRect(Bounds& area) {
 
-    } else {
+    Bounds bb = area;
+    if ( bb.x1 < fbBounds.x1 ) {
+        bb.x1 = fbBounds.x1;
+    }
+    if ( bb.y1 < fbBounds.y1 ) {
+        bb.y1 = fbBounds.y1;
+    }
+    if ( bb.x2 > fbBounds.x2 ) {
+        bb.x2 = fbBounds.x2;
+    }
+    if ( bb.y2 > fbBounds.y2 ) {
+        bb.y2 = fbBounds.y2;
+    }
+    if ( bb.x2 < bb.x1 || bb.y2 < bb.y1 ) {
+        return;
+    }
 
-        RGB* sav = getColor();
-        setColor(getBackground());
-        boolean savorigin = relativeOrigin;
-        relativeOrigin = false;
+    int32_t bestCost = 0x7FFFFFFF;
+    int8_t best = 0;
+
+    uint8_t i = 0;
+    while ( i < dirtyCount ) {
+        Bounds& d = dirtyRects[i];
+        Bounds u(min(bb.x1, d.x1), min(bb.y1, d.y1), max(bb.x2, d.x2), max(bb.y2, d.y2));
+        int32_t cost = (int32_t)(u.x2 - u.x1 + 1) * (u.y2 - u.y1 + 1)
+                - (int32_t)(bb.x2 - bb.x1 + 1) * (bb.y2 - bb.y1 + 1)
+                - (int32_t)(d.x2 - d.x1 + 1) * (d.y2 - d.y1 + 1);
+        if ( cost <= 0 ) {
+            // the merged area is taken out and checked against the rest again
+            bb = u;
+            dirtyRects[i] = dirtyRects[--dirtyCount];
+            i = 0;
+            bestCost = 0x7FFFFFFF;
+            continue;
+        }
+        if ( cost < bestCost ) {
+            bestCost = cost;
+            best = i;
+        }
+        i++;
+    }
 
-        beginGfxOperation();
+    if ( dirtyCount < MAX_DIRTY_RECTS ) {
+        dirtyRects[dirtyCount++] = bb;
+        return;
+    }
 
-        if ( (flags & SCROLL_CLEAN) > 0 && dy > 0 ) {
-            if( (orientation % 2) == 0 ) { // PORTRAIT(_FLIP)
-                fillRectangle(0, 0, deviceWidth, mdy);
-            } else {
-                fillRectangle(0, 0, mdy, deviceWidth);
-            }
-        }
+    Bounds& d = dirtyRects[best];
+    Bounds u(min(bb.x1, d.x1), min(bb.y1, d.y1), max(bb.x2, d.x2), max(bb.y2, d.y2));
+    dirtyRects[best] = dirtyRects[--dirtyCount];
+    addDirtyRect(u);
+}
 
-        currentScroll += dy;
-        while ( currentScroll < 0 ) {
-            currentScroll += deviceHeight;
-        }
-        currentScroll %= deviceHeight;
+void PixelsBase::beginDisplayList(uint8_t* buffer, uint16_t size) {
+    dlData = buffer;
+    dlSize = buffer == NULL ? 0 : size;
+    dlLength = 0;
+    dlOverflow = false;
+    dlStateValid = false;
+    dlRecording = true;
+}
 
-        scrollCmd();
+boolean PixelsBase::endDisplayList() {
+    dlRecording = false;
+    return !dlOverflow;
+}
 
-        if ( (flags & SCROLL_CLEAN) > 0 && dy < 0 ) {
-            if( (orientation % 2) == 0 ) { // PORTRAIT(_FLIP)
-                fillRectangle(0, 0, deviceWidth, mdy);
-            } else {
-                fillRectangle(0, 0, mdy, deviceWidth);
+/*
+ * Appends a command: opcode, payload length and the payload, which is made of int16_t arguments,
+ * data references and a zero terminated string. A drawing command is preceded by a state command
+ * if the colors, the font or the modes are changed since the last one.
+ */
+boolean PixelsBase::recordCommand(uint8_t op, const void* args, uint8_t argsSize,
+                                  const void* data, uint8_t dataSize, const char* text) {
+
+    if ( op != DL_STATE ) {
+        uint8_t state[DL_STATE_SIZE];
+        packState(state);
+        if ( !dlStateValid || memcmp(state, dlState, DL_STATE_SIZE) != 0 ) {
+            if ( !recordCommand(DL_STATE, state, DL_STATE_SIZE) ) {
+                return false;
             }
+            memcpy(dlState, state, DL_STATE_SIZE);
+            dlStateValid = true;
         }
+    }
 
-        relativeOrigin = savorigin;
-        setColor(sav);
+    uint16_t textSize = text == NULL ? 0 : strlen(text) + 1;
+    uint16_t size = argsSize + dataSize + textSize;
+    if ( size > 0xFF || dlOverflow || dlLength + 2 + size > dlSize ) {
+        dlOverflow = true;
+        return false;
+    }
 
-        endGfxOperation(true);
+    uint8_t* p = dlData + dlLength;
+    *p++ = op;
+    *p++ = size;
+    // commands without a part of the payload pass NULL for it, which memcpy() must not get
+    if ( argsSize > 0 ) {
+        memcpy(p, args, argsSize);
+    }
+    if ( dataSize > 0 ) {
+        memcpy(p + argsSize, data, dataSize);
+    }
+    if ( textSize > 0 ) {
+        memcpy(p + argsSize + dataSize, text, textSize);
     }
+    dlLength += 2 + size;
+    return true;
 }
 
+void PixelsBase::packState(uint8_t* state) {
+    state[0] = foreground->red;
+    state[1] = foreground->green;
+    state[2] = foreground->blue;
+    state[3] = background->red;
+    state[4] = background->green;
+    state[5] = background->blue;
+    state[6] = glyphPrintMode;
+    state[7] = relativeOrigin;
+    state[8] = antialiasing;
+    state[9] = lineCap;
+    state[10] = lineJoin;
+    memcpy(state + 11, &currentFont, sizeof(currentFont));
+    memcpy(state + 11 + sizeof(currentFont), &lineWidth, sizeof(lineWidth));
+}
 
-void PixelsBase::drawPixel(int16_t x, int16_t y) {
+void PixelsBase::unpackState(uint8_t* state) {
+    setColor(state[0], state[1], state[2]);
+    setBackground(state[3], state[4], state[5]);
+    glyphPrintMode = state[6];
+    relativeOrigin = state[7];
+    enableAntialiasing(state[8]);
+    lineCap = state[9];
+    lineJoin = state[10];
+    memcpy(&currentFont, state + 11, sizeof(currentFont));
+    memcpy(&lineWidth, state + 11 + sizeof(currentFont), sizeof(lineWidth));
+}
 
-    if ( x < 0 || y < 0 || x >= width || y >= height ) {
-        return;
-    }
+static const void* readReference(uint8_t* p) {
+    const void* ref;
+    memcpy(&ref, p, sizeof(ref));
+    return ref;
+}
 
-    int xx = x;
-    int yy = y;
+void PixelsBase::replayDisplayList() {
 
-    int s = getScroll();
+    uint16_t pos = 0;
+    while ( pos < dlLength ) {
+        uint8_t op = dlData[pos];
+        uint8_t size = dlData[pos + 1];
+        uint8_t* p = dlData + pos + 2;
+        pos += 2 + size;
 
-    if ( relativeOrigin ) {
-        switch( orientation ) {
-        case PORTRAIT:
-            if ( s > 0 && y >= s ) {
-                return;
-            }
+        // the payload is not aligned
+        int16_t a[8];
+        memcpy(a, p, size < (uint8_t)sizeof(a) ? size : sizeof(a));
+
+        switch ( op ) {
+        case DL_STATE:
+            unpackState(p);
             break;
-        case LANDSCAPE:
-            if ( s > 0 && x >= s ) {
-                return;
-            }
-            xx = deviceWidth - y - 1;
-            yy = x;
+        case DL_CLEAR:
+            clear();
             break;
-        case PORTRAIT_FLIP:
-            if ( s > 0 && y >= s ) {
-                return;
-            }
-            xx = deviceWidth - x - 1;
-            yy = deviceHeight - y - 1;
+        case DL_PIXEL:
+            drawPixel(a[0], a[1]);
             break;
-        case LANDSCAPE_FLIP:
-            if ( s > 0 && x >= s ) {
-                return;
-            }
-            xx = y;
-            yy = deviceHeight - x - 1;
+        case DL_LINE:
+            drawLine(a[0], a[1], a[2], a[3]);
             break;
-        }
-    } else {
-        switch( orientation ) {
-        case PORTRAIT:
-            yy += s;
+        case DL_RECTANGLE:
+            drawRectangle(a[0], a[1], a[2], a[3]);
             break;
-        case LANDSCAPE:
-            xx = deviceWidth - y - 1;
-            yy = x + s;
+        case DL_FILL_RECTANGLE:
+            fillRectangle(a[0], a[1], a[2], a[3]);
             break;
-        case PORTRAIT_FLIP:
-            xx = deviceWidth - x - 1;
-            yy = 2 * deviceHeight - y - 1 - s;
+        case DL_ROUND_RECTANGLE:
+            drawRoundRectangle(a[0], a[1], a[2], a[3], a[4]);
             break;
-        case LANDSCAPE_FLIP:
-            xx = y;
-            yy = 2 * deviceHeight - x - 1 - s;
+        case DL_FILL_ROUND_RECTANGLE:
+            fillRoundRectangle(a[0], a[1], a[2], a[3], a[4]);
+            break;
+        case DL_CIRCLE:
+            drawCircle(a[0], a[1], a[2]);
+            break;
+        case DL_FILL_CIRCLE:
+            fillCircle(a[0], a[1], a[2]);
+            break;
+        case DL_OVAL:
+            drawOval(a[0], a[1], a[2], a[3]);
+            break;
+        case DL_FILL_OVAL:
+            fillOval(a[0], a[1], a[2], a[3]);
+            break;
+        case DL_FILL_TRIANGLE:
+            fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5]);
+            break;
+        case DL_FILL_POLYGON:
+            fillPolygon((int16_t*)readReference(p + 4), a[0], a[1]);
+            break;
+        case DL_POLYLINE:
+            drawPolyline((int16_t*)readReference(p + 2), a[0]);
+            break;
+        case DL_POLYGON:
+            drawPolygon((int16_t*)readReference(p + 2), a[0]);
+            break;
+        case DL_PIXELS:
+            drawPixels((int16_t*)readReference(p + 2), (uint16_t)a[0]);
+            break;
+        case DL_LINES:
+            drawLines((int16_t*)readReference(p + 2), (uint16_t)a[0]);
+            break;
+        case DL_FILL_RECTS:
+            fillRects((int16_t*)readReference(p + 2), (uint16_t)a[0]);
+            break;
+        case DL_ARC:
+            drawArc(a[0], a[1], a[2], a[3], a[4], a[5]);
+            break;
+        case DL_FILL_ARC:
+            fillArc(a[0], a[1], a[2], a[3], a[4], a[5]);
+            break;
+        case DL_FILL_RING_SEGMENT:
+            fillRingSegment(a[0], a[1], a[2], a[3], a[4], a[5]);
+            break;
+        case DL_FILL_GRADIENT:
+            fillRectangleGradient(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7]);
+            break;
+        case DL_FILL_RADIAL:
+            fillOvalRadial(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+            break;
+        case DL_PATH:
+            drawPath((Path*)readReference(p));
+            break;
+        case DL_FILL_PATH:
+            fillPath((Path*)readReference(p + 2), a[0]);
+            break;
+        case DL_PUSH_CLIP:
+            pushClip(a[0], a[1], a[2], a[3]);
+            break;
+        case DL_POP_CLIP:
+            popClip();
+            break;
+        case DL_ICON:
+            drawIcon(a[0], a[1], (prog_uchar*)readReference(p + 4));
+            break;
+        case DL_ICON_SCALED:
+            drawIconScaled(a[0], a[1], (prog_uchar*)readReference(p + 6), a[2]);
+            break;
+        case DL_CLEAN_ICON:
+            cleanIcon(a[0], a[1], (prog_uchar*)readReference(p + 4));
+            break;
+        case DL_BITMAP:
+            drawBitmap(a[0], a[1], a[2], a[3], (prog_uint16_t*)readReference(p + 8));
+            break;
+        case DL_BITMAP_SCALED:
+            drawBitmapScaled(a[0], a[1], a[2], a[3], (prog_uint16_t*)readReference(p + 14), a[4], a[5], a[6]);
+            break;
+        case DL_BITMAP_KEYED:
+            drawBitmapKeyed(a[0], a[1], a[2], a[3], (prog_uint16_t*)readReference(p + 10), a[4]);
+            break;
+        case DL_BITMAP_ALPHA:
+            drawBitmapAlpha(a[0], a[1], a[2], a[3], (prog_uint16_t*)readReference(p + 10),
+                            (prog_uchar*)readReference(p + 10 + sizeof(void*)), a[4]);
+            break;
+        case DL_COMPRESSED_BITMAP:
+            drawCompressedBitmapScaled(a[0], a[1], (prog_uchar*)readReference(p + 10), a[2], a[3], a[4]);
+            break;
+        case DL_RASTER:
+            drawRaster(a[0], a[1], a[2], a[3], (Raster*)readReference(p + 8));
+            break;
+        case DL_RASTER_LINE:
+            drawRasterLine(a[0], a[1], a[2], (uint16_t*)readReference(p + 6));
+            break;
+        case DL_PRINT:
+            print(a[0], a[1], String((const char*)p + 4 + sizeof(void*)), (int8_t*)readReference(p + 4));
+            break;
+        case DL_CLEAN_TEXT:
+            cleanText(a[0], a[1], String((const char*)p + 4 + sizeof(void*)), (int8_t*)readReference(p + 4));
             break;
         }
-        yy %= deviceHeight;
     }
+}
 
-    beginGfxOperation();
-    setRegion(xx, yy, xx, yy);
-    setCurrentPixel(foreground);
-    endGfxOperation();
+int8_t PixelsBase::beginSlice(SliceToken& token, uint8_t type, int16_t x, int16_t y, int16_t width, int16_t height) {
+    token.type = type;
+    token.x = x;
+    token.y = y;
+    token.width = width;
+    token.height = width > 0 && height > 0 ? height : 0;
+    token.row = 0;
+    token.color = foreground->convertTo565();
+    token.bitmap = NULL;
+    token.raster = NULL;
+    return token.height > 0 ? 0 : -1;
 }
 
-void PixelsBase::fill(int color, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+int8_t PixelsBase::beginFill(SliceToken& token, int16_t x, int16_t y, int16_t width, int16_t height) {
+    return beginSlice(token, SLICE_FILL, x, y, width, height);
+}
 
-    Bounds bb(x1, y1, x2, y2);
-    if( !transformBounds(bb) ) {
-        return;
+int8_t PixelsBase::beginClear(SliceToken& token) {
+    beginSlice(token, SLICE_CLEAR, 0, 0, width, height);
+    token.color = background->convertTo565();
+    return 0;
+}
+
+int8_t PixelsBase::beginBitmap(SliceToken& token, int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data) {
+    int8_t result = beginSlice(token, SLICE_BITMAP, x, y, width, height);
+    token.bitmap = data;
+    if ( data == NULL ) {
+        token.height = 0;
+        return -1;
     }
+    return result;
+}
 
-    beginGfxOperation();
+int8_t PixelsBase::beginRaster(SliceToken& token, int16_t x, int16_t y, int16_t width, int16_t height, Raster* raster) {
+    int8_t result = beginSlice(token, SLICE_RASTER, x, y, width, height);
+    token.raster = raster;
+    if ( raster == NULL ) {
+        token.height = 0;
+        return -1;
+    }
+    return result;
+}
 
-    if ( relativeOrigin ) {
-        quickFill(color, bb.x1, bb.y1, bb.x2, bb.y2);
-    } else {
-        int s = currentScroll;
-        if ( orientation > 1 ) {
-            s = (deviceHeight - s - 1) % deviceHeight;
-            bb.y1 += s;
-            bb.y2 += s;
-        } else {
-            bb.y1 += s;
-            bb.y2 += s;
-        }
-        bb.y1 %= deviceHeight;
-        bb.y2 %= deviceHeight;
+/*
+ * Rows of a raster starting from the given one
+ */
+class RowOffsetRaster : public Raster {
+private:
+    Raster* source;
+    int16_t offset;
+
+public:
+    RowOffsetRaster(Raster* raster, int16_t row) {
+        source = raster;
+        offset = row;
+    }
 
-        if ( bb.y1 > bb.y2 ) {
-            quickFill(color, bb.x1, bb.y1, bb.x2, deviceHeight-1);
-            quickFill(color, bb.x1, 0, bb.x2, bb.y2);
-        } else {
-            quickFill(color, bb.x1, bb.y1, bb.x2, bb.y2);
-        }
+    uint16_t getPixel(int16_t x, int16_t y) {
+        return source->getPixel(x, y + offset);
     }
+};
 
-    endGfxOperation();
+boolean PixelsBase::resume(SliceToken& token) {
+    if ( token.isDone() ) {
+        return false;
+    }
+
+    int16_t rows = min(sliceRows, token.height - token.row);
+    int16_t y = token.y + token.row;
+
+    switch ( token.type ) {
+    case SLICE_FILL:
+        fill(token.color, token.x, y, token.x + token.width - 1, y + rows - 1);
+        break;
+    case SLICE_CLEAR: {
+        boolean s = relativeOrigin;
+        relativeOrigin = false;
+        fill(token.color, token.x, y, token.x + token.width - 1, y + rows - 1);
+        relativeOrigin = s;
+        break;
+    }
+    case SLICE_BITMAP: {
+        BitmapRaster raster(token.bitmap + (int32_t)token.row * token.width, token.width);
+        drawRaster(token.x, y, token.width, rows, &raster);
+        break;
+    }
+    case SLICE_RASTER: {
+        RowOffsetRaster raster(token.raster, token.row);
+        drawRaster(token.x, y, token.width, rows, &raster);
+        break;
+    }
+    }
+
+    token.row += rows;
+    return !token.isDone();
 }
 
-void PixelsBase::hLine(int16_t x1, int16_t y, int16_t x2) {
-    fill(foreground->convertTo565(), x1, y, x2, y);
+int8_t PixelsBase::renderDisplayList(uint16_t* strip, int16_t bandHeight) {
+
+    if ( dlData == NULL || dlRecording || fbData != NULL || strip == NULL || bandHeight <= 0 ) {
+        return -1;
+    }
+    if ( dlOverflow ) {
+        return -2;
+    }
+
+    // the replay changes the graphics state, the caller's one is restored afterwards
+    uint8_t state[DL_STATE_SIZE];
+    packState(state);
+    RGB* fg = foreground;
+    RGB* bg = background;
+    RGB fgValue = *fgBuffer;
+    RGB bgValue = *bgBuffer;
+
+    for ( int16_t y = 0; y < deviceHeight; y += bandHeight ) {
+        enableFrameBuffer(strip, 0, y, deviceWidth, bandHeight);
+        replayDisplayList();
+        // the band is composed completely, so it goes out as one window
+        dirtyRects[0] = fbBounds;
+        dirtyCount = 1;
+        disableFrameBuffer();
+    }
+
+    unpackState(state);
+    *fgBuffer = fgValue;
+    *bgBuffer = bgValue;
+    foreground = fg;
+    background = bg;
+    return 0;
 }
 
-void PixelsBase::vLine(int16_t x, int16_t y1, int16_t y2) {
-    fill(foreground->convertTo565(), x, y1, x, y2);
+int32_t PixelsBase::deviceRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+
+    if ( fbData == NULL ) {
+        return setRegion(x1, y1, x2, y2);
+    }
+
+    Bounds bb(x1, y1, x2, y2);
+    if( !checkBounds(bb) ) {
+        return 0;
+    }
+
+    fbWindow = bb;
+    fbX = bb.x1;
+    fbY = bb.y1;
+    addDirtyRect(bb);
+
+    return (int32_t)(bb.x2 - bb.x1 + 1) * (bb.y2 - bb.y1 + 1);
+}
+
+void PixelsBase::deviceFill(int color, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+
+    if ( fbData == NULL ) {
+        quickFill(color, x1, y1, x2, y2);
+        return;
+    }
+
+    Bounds bb(x1, y1, x2, y2);
+    if( !checkBounds(bb) ) {
+        return;
+    }
+    addDirtyRect(bb);
+
+    int16_t fbWidth = fbBounds.x2 - fbBounds.x1 + 1;
+    for ( int16_t y = max(bb.y1, fbBounds.y1); y <= min(bb.y2, fbBounds.y2); y++ ) {
+        uint16_t* p = fbData + (int32_t)(y - fbBounds.y1) * fbWidth;
+        for ( int16_t x = max(bb.x1, fbBounds.x1); x <= min(bb.x2, fbBounds.x2); x++ ) {
+            p[x - fbBounds.x1] = color;
+        }
+    }
+}
+
+void PixelsBase::deviceWriteBlock(uint16_t* data, int16_t length) {
+    for ( int16_t i = 0; i < length; i++ ) {
+        deviceWriteData(highByte(data[i]), lowByte(data[i]));
+    }
 }
 
 void PixelsBase::resetRegion() {
@@ -1914,12 +5446,24 @@ void PixelsBase::resetRegion() {
 }
 
 void PixelsBase::setCurrentPixel(int16_t color) {
+    if ( fbData != NULL ) {
+        // the frame buffer write pointer follows the device window order
+        if ( fbX >= fbBounds.x1 && fbX <= fbBounds.x2 && fbY >= fbBounds.y1 && fbY <= fbBounds.y2 ) {
+            fbData[(int32_t)(fbY - fbBounds.y1) * (fbBounds.x2 - fbBounds.x1 + 1) + fbX - fbBounds.x1] = color;
+        }
+        if ( ++fbX > fbWindow.x2 ) {
+            fbX = fbWindow.x1;
+            if ( ++fbY > fbWindow.y2 ) {
+                fbY = fbWindow.y1;
+            }
+        }
+        return;
+    }
     deviceWriteData(highByte(color), lowByte(color));
 }
 
 void PixelsBase::setCurrentPixel(RGB* color) {
-    int16_t c = color->convertTo565();
-    deviceWriteData(highByte(c), lowByte(c));
+    setCurrentPixel((int16_t)color->convertTo565());
 }
 
 boolean PixelsBase::transformBounds(Bounds& bb) {
@@ -1963,6 +5507,79 @@ boolean PixelsBase::transformBounds(Bounds& bb) {
     return true;
 }
 
+/*
+ * Cuts logical bounds to the clip rectangle
+ * @return false if nothing is left
+ */
+boolean PixelsBase::clipBounds(Bounds& bb) {
+    if ( clipDepth == 0 ) {
+        return true;
+    }
+    if ( bb.x2 < bb.x1 ) {
+        swap(bb.x1, bb.x2);
+    }
+    if ( bb.y2 < bb.y1 ) {
+        swap(bb.y1, bb.y2);
+    }
+    Bounds& c = clipStack[clipDepth - 1];
+    bb.x1 = max(bb.x1, c.x1);
+    bb.y1 = max(bb.y1, c.y1);
+    bb.x2 = min(bb.x2, c.x2);
+    bb.y2 = min(bb.y2, c.y2);
+    return bb.x1 <= bb.x2 && bb.y1 <= bb.y2;
+}
+
+/*
+ * The screen within the clip rectangle, in logical coordinates; scanline fillers skip the rows out of it
+ */
+Bounds PixelsBase::visibleArea() {
+    Bounds bb(0, 0, width - 1, height - 1);
+    if ( clipDepth > 0 ) {
+        Bounds& c = clipStack[clipDepth - 1];
+        bb.x1 = max(bb.x1, c.x1);
+        bb.y1 = max(bb.y1, c.y1);
+        bb.x2 = min(bb.x2, c.x2);
+        bb.y2 = min(bb.y2, c.y2);
+    }
+    return bb;
+}
+
+int8_t PixelsBase::pushClip(int16_t x, int16_t y, int16_t width, int16_t height) {
+    if ( dlRecording ) {
+        int16_t args[] = {x, y, width, height};
+        recordCommand(DL_PUSH_CLIP, args, sizeof(args));
+        return 0;
+    }
+
+    if ( clipDepth >= MAX_CLIPS ) {
+        return -1;
+    }
+    Bounds bb(x, y, x + width - 1, y + height - 1);
+    if ( clipDepth > 0 ) {
+        Bounds& c = clipStack[clipDepth - 1];
+        bb.x1 = max(bb.x1, c.x1);
+        bb.y1 = max(bb.y1, c.y1);
+        bb.x2 = min(bb.x2, c.x2);
+        bb.y2 = min(bb.y2, c.y2);
+    }
+    // an empty intersection stays empty (x2 < x1), so the matching popClip() is still needed
+    clipStack[clipDepth++] = bb;
+    return 0;
+}
+
+int8_t PixelsBase::popClip() {
+    if ( dlRecording ) {
+        recordCommand(DL_POP_CLIP, NULL, 0);
+        return 0;
+    }
+
+    if ( clipDepth == 0 ) {
+        return -1;
+    }
+    clipDepth--;
+    return 0;
+}
+
 boolean PixelsBase::checkBounds(Bounds& bb) {
     if (bb.x2 < bb.x1) {
         swap(bb.x1, bb.x2);
@@ -1984,19 +5601,59 @@ boolean PixelsBase::checkBounds(Bounds& bb) {
         bb.x2 = deviceWidth - 1;
     }
 
-    int16_t s = (relativeOrigin && orientation > 1) ? (deviceHeight - currentScroll) % deviceHeight : 0;
-    if ( bb.y1 < s ) {
-        if ( bb.y2 < s ) {
+    if ( bb.y1 < 0 ) {
+        if ( bb.y2 < 0 ) {
+            return false;
+        }
+        bb.y1 = 0;
+    }
+    if ( bb.y2 >= deviceHeight ) {
+        if ( bb.y1 >= deviceHeight ) {
+            return false;
+        }
+        bb.y2 = deviceHeight - 1;
+    }
+
+    if ( !relativeOrigin ) {
+        return true;
+    }
+
+    // relative coordinates map to the video RAM directly, so the clip rectangle applies here
+    // as well; absolute ones are clipped before they are shifted by the scroll position
+    if ( clipDepth > 0 ) {
+        Bounds c = clipStack[clipDepth - 1];
+        if ( c.x2 < c.x1 || c.y2 < c.y1 ) {
+            return false;
+        }
+        transformBounds(c);
+        bb.x1 = max(bb.x1, c.x1);
+        bb.y1 = max(bb.y1, c.y1);
+        bb.x2 = min(bb.x2, c.x2);
+        bb.y2 = min(bb.y2, c.y2);
+        if ( bb.x2 < bb.x1 || bb.y2 < bb.y1 ) {
             return false;
         }
-        bb.y1 = s;
     }
-    s = (relativeOrigin && orientation < 2 && currentScroll > 0) ? currentScroll : deviceHeight;
-    if ( bb.y2 >= s ) {
-        if ( bb.y1 >= s ) {
+
+    // band rows r1..r2-1 are scrolled out of the relative coordinate space
+    int16_t r1 = scrollTop;
+    int16_t r2 = scrollTop + deviceScroll();
+    if ( orientation < 2 ) {
+        r1 = currentScroll > 0 ? r2 : deviceHeight;
+        r2 = deviceHeight - scrollBottom;
+    }
+    if ( r1 >= r2 ) {
+        return true;
+    }
+
+    if ( bb.y1 >= r1 && bb.y1 < r2 ) {
+        if ( bb.y2 < r2 ) {
             return false;
         }
-        bb.y2 = s - 1;
+        bb.y1 = r2;
+    } else if ( bb.y1 < r1 && bb.y2 >= r1 ) {
+        // a region spanning the whole gap keeps the part before it
+        bb.y2 = min(bb.y2, r1 - 1);
     }
 
     return true;
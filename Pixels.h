@@ -116,9 +116,95 @@
 #define ANTIALIASED_FONT 2
 #define HEADER_LENGTH 5
 
+#define COMPRESSED_HEADER_LENGTH 12
+#define BMP_HEADER_LENGTH 54
+
+#ifndef RASTER_BUFFER_SIZE
+#define RASTER_BUFFER_SIZE 32 // pixels, a row buffer size of streamed bitmap decoders
+#endif
+#ifndef SCALED_ROW_BUFFER_SIZE
+#define SCALED_ROW_BUFFER_SIZE 128 // pixels, two decoded rows of compressed images resized in bilinear mode
+#endif
+#ifndef MAX_DIRTY_RECTS
+#define MAX_DIRTY_RECTS 8 // number of separately tracked changed areas of the frame buffer
+#endif
+#ifndef STREAM_BUFFER_SIZE
+#define STREAM_BUFFER_SIZE 32 // bytes, a read-ahead buffer size of ByteReader based streams
+#endif
+
+#define SCALE_NEAREST 0
+#define SCALE_BILINEAR 1
+
+/* gradient directions in degrees, counter-clockwise from left to right */
+#define GRADIENT_HORIZONTAL 0
+#define GRADIENT_VERTICAL 270
+
+/* display list commands */
+#define DL_STATE 1
+#define DL_CLEAR 2
+#define DL_PIXEL 3
+#define DL_LINE 4
+#define DL_RECTANGLE 5
+#define DL_FILL_RECTANGLE 6
+#define DL_ROUND_RECTANGLE 7
+#define DL_FILL_ROUND_RECTANGLE 8
+#define DL_CIRCLE 9
+#define DL_FILL_CIRCLE 10
+#define DL_OVAL 11
+#define DL_FILL_OVAL 12
+#define DL_ICON 13
+#define DL_ICON_SCALED 14
+#define DL_CLEAN_ICON 15
+#define DL_BITMAP 16
+#define DL_BITMAP_SCALED 17
+#define DL_BITMAP_KEYED 18
+#define DL_BITMAP_ALPHA 19
+#define DL_COMPRESSED_BITMAP 20
+#define DL_RASTER 21
+#define DL_RASTER_LINE 22
+#define DL_PRINT 23
+#define DL_CLEAN_TEXT 24
+#define DL_FILL_TRIANGLE 25
+#define DL_FILL_POLYGON 26
+#define DL_POLYLINE 27
+#define DL_POLYGON 28
+#define DL_ARC 29
+#define DL_FILL_ARC 30
+#define DL_FILL_RING_SEGMENT 31
+#define DL_FILL_GRADIENT 32
+#define DL_FILL_RADIAL 33
+#define DL_PATH 34
+#define DL_FILL_PATH 35
+#define DL_PUSH_CLIP 36
+#define DL_POP_CLIP 37
+#define DL_PIXELS 38
+#define DL_LINES 39
+#define DL_FILL_RECTS 40
+
+// colors, print mode, origin, antialiasing, line cap and join, font and line width
+#define DL_STATE_SIZE (11 + sizeof(prog_uchar*) + sizeof(double))
+
 #define SCROLL_SMOOTH 1
 #define SCROLL_CLEAN 2
 
+#ifndef MAX_CLIPS
+#define MAX_CLIPS 4 // depth of the clip rectangle stack
+#endif
+
+#ifndef MAX_ANIMATIONS
+#define MAX_ANIMATIONS 4 // number of scroll or marquee movements, which can be run by tick() at once
+#endif
+
+#define ANIMATION_NONE 0
+#define ANIMATION_SCROLL 1
+#define ANIMATION_MARQUEE 2
+
+#define SLICE_NONE 0
+#define SLICE_FILL 1
+#define SLICE_CLEAR 2
+#define SLICE_BITMAP 3
+#define SLICE_RASTER 4
+
 #define FILL_TOPDOWN 0
 #define FILL_LEFTRIGHT 0
 #define FILL_DOWNTOP 1
@@ -135,18 +221,59 @@
 #define TRANSPARENT_TEXT_BACKGROUND 0
 #define FILL_TEXT_BACKGROUND 1
 
+#define POLYGON_EVEN_ODD 0
+#define POLYGON_NONZERO 1
+
+/* ends of thick lines */
+#define LINE_CAP_BUTT 0
+#define LINE_CAP_ROUND 1
+#define LINE_CAP_SQUARE 2
+
+/* corners of thick polylines and polygon outlines */
+#define LINE_JOIN_MITER 0
+#define LINE_JOIN_ROUND 1
+#define LINE_JOIN_BEVEL 2
+
 
 #define ipart(X) ((int16_t)(X))
 #define iround(X) ((uint16_t)(((double)(X))+0.5))
 #define fpart(X) (((double)(X))-(double)ipart(X))
 #define rfpart(X) (1.0-fpart(X))
 
-extern regtype *registerCS; // chip select
-extern regsize bitmaskCS;
-
 #define chipSelect() cbi(registerCS, bitmaskCS)
 #define chipDeselect() sbi(registerCS, bitmaskCS)
 
+/*
+ * A controller class derives from the bus layer of the last included Pixels_<BUS>.h. PIXELS_CLASS
+ * renames the controller class, so several displays can be driven by one sketch:
+ *
+ *   #include <Pixels_PPI16.h>
+ *   #include <Pixels_ILI9341.h>  // class Pixels
+ *   #include <Pixels_SPIhw.h>
+ *   #define PIXELS_CLASS Oled
+ *   #include <Pixels_SSD1306.h>  // class Oled
+ *   #undef PIXELS_CLASS
+ */
+#define PIXELS_BUS_SPISW 1
+#define PIXELS_BUS_SPIHW 2
+#define PIXELS_BUS_PPI8 3
+#define PIXELS_BUS_PPI16 4
+
+/*
+ * Chip select line of a display instance. It is shared by the graphics layer (PixelsBase) and the bus
+ * layer of the instance, so several displays do not interfere.
+ */
+class ChipSelect {
+protected:
+    regtype *registerCS;
+    regsize bitmaskCS;
+
+    ChipSelect() {
+        registerCS = NULL;
+        bitmaskCS = 0;
+    }
+};
+
 class RGB {
 private:
     uint16_t col;
@@ -172,6 +299,13 @@ public:
     int16_t x2;
     int16_t y2;
 
+    Bounds() {
+        x1 = 0;
+        y1 = 0;
+        x2 = -1;
+        y2 = -1;
+    }
+
     Bounds( int16_t xx1, int16_t yy1, int16_t xx2, int16_t yy2 ) {
         x1 = xx1;
         y1 = yy1;
@@ -180,7 +314,496 @@ public:
     }
 };
 
-class PixelsBase {
+/**
+ * Sequential byte source for resources that do not fit into flash memory (SD card files etc).
+ * @see PixelsBase::setByteReader(ByteReader*)
+ */
+class ByteReader {
+public:
+    /**
+     * Opens a resource for reading
+     * @param path resource path
+     * @return <i>true</i> if the resource is opened
+     */
+    virtual boolean open(String path) = 0;
+    /**
+     * Reads next bytes of the opened resource
+     * @param buffer destination buffer
+     * @param length maximal number of bytes to read
+     * @return number of bytes read; 0 if the end of data is reached
+     */
+    virtual int16_t read(uint8_t* buffer, int16_t length) = 0;
+    /**
+     * Closes the opened resource
+     */
+    virtual void close() = 0;
+};
+
+/**
+ * Source of pixel colors for a streamed region output.
+ * @see PixelsBase::drawRaster(int16_t,int16_t,int16_t,int16_t,Raster*)
+ */
+class Raster {
+public:
+    /**
+     * @param x horizontal pixel position relative to the raster top-left corner
+     * @param y vertical pixel position relative to the raster top-left corner
+     * @return pixel color in RGB565 format
+     */
+    virtual uint16_t getPixel(int16_t x, int16_t y) = 0;
+};
+
+/**
+ * A single raster line, kept in RAM.
+ */
+class LineRaster : public Raster {
+private:
+    uint16_t* data;
+
+public:
+    LineRaster(uint16_t* buffer) {
+        data = buffer;
+    }
+
+    uint16_t getPixel(int16_t x, int16_t y) {
+        return data[x];
+    }
+};
+
+/**
+ * A rectangular pixel buffer (or a part of it) in RGB565 format, kept in RAM.
+ */
+class BufferRaster : public Raster {
+private:
+    uint16_t* data;
+    int16_t stride;
+
+public:
+    /**
+     * @param buffer pixel data of the top-left raster pixel
+     * @param bufferWidth width of the whole buffer
+     */
+    BufferRaster(uint16_t* buffer, int16_t bufferWidth) {
+        data = buffer;
+        stride = bufferWidth;
+    }
+
+    uint16_t getPixel(int16_t x, int16_t y) {
+        return data[(int32_t)y * stride + x];
+    }
+};
+
+/**
+ * A bitmap (or a part of a bitmap) in RGB565 format, stored in flash memory.
+ */
+class BitmapRaster : public Raster {
+private:
+    prog_uint16_t* data;
+    int16_t stride;
+
+public:
+    /**
+     * @param bitmap pixel data of the top-left raster pixel
+     * @param bitmapWidth width of the whole bitmap
+     */
+    BitmapRaster(prog_uint16_t* bitmap, int16_t bitmapWidth) {
+        data = bitmap;
+        stride = bitmapWidth;
+    }
+
+    uint16_t getPixel(int16_t x, int16_t y) {
+        return pgm_read_word_near(data + (int32_t)y * stride + x);
+    }
+};
+
+/**
+ * A raster, resampled to the given dimensions. Steps are kept in 16.16 fixed point, pixel centers
+ * are aligned, so an integer magnification replicates every source pixel the same number of times.
+ * An integer magnification in both directions is always sampled as the nearest pixel, as
+ * interpolation would only blur the replicated pixels.
+ */
+class ScaledRaster : public Raster {
+private:
+    Raster* source;
+    int16_t sourceWidth;
+    int16_t sourceHeight;
+    int32_t stepX;
+    int32_t stepY;
+    uint8_t mode;
+    int16_t rowOffset;
+
+public:
+    /**
+     * @param src source raster
+     * @param srcWidth source raster width
+     * @param srcHeight source raster height
+     * @param targetWidth resulting width
+     * @param targetHeight resulting height
+     * @param scaleMode SCALE_NEAREST or SCALE_BILINEAR
+     */
+    ScaledRaster(Raster* src, int16_t srcWidth, int16_t srcHeight, int16_t targetWidth, int16_t targetHeight, uint8_t scaleMode) {
+        source = src;
+        sourceWidth = srcWidth;
+        sourceHeight = srcHeight;
+        stepX = ((int32_t)srcWidth << 16) / targetWidth;
+        stepY = ((int32_t)srcHeight << 16) / targetHeight;
+        mode = scaleMode;
+        if ( targetWidth % srcWidth == 0 && targetHeight % srcHeight == 0 ) {
+            mode = SCALE_NEAREST;
+        }
+        rowOffset = 0;
+    }
+
+    /**
+     * @return SCALE_NEAREST or SCALE_BILINEAR, the mode the raster is actually sampled in
+     */
+    uint8_t getMode() {
+        return mode;
+    }
+
+    /**
+     * Shifts the requested rows, used to output a scaled image row by row
+     * @param offset the resulting image row, which corresponds to the raster row 0
+     */
+    void setRowOffset(int16_t offset) {
+        rowOffset = offset;
+    }
+
+    /**
+     * @return the source column, which the resulting column is sampled from in the nearest mode
+     */
+    int16_t getSourceColumn(int16_t u) {
+        return (u * stepX + (stepX >> 1)) >> 16;
+    }
+
+    /**
+     * @return the source row, which the resulting row is sampled from. Bilinear mode also needs the next row.
+     */
+    int16_t getSourceRow(int16_t v) {
+        int32_t f = v * stepY + (stepY >> 1);
+        if ( mode == SCALE_BILINEAR ) {
+            f -= 0x8000;
+            if ( f < 0 ) {
+                f = 0;
+            }
+        }
+        return f >> 16;
+    }
+
+    uint16_t getPixel(int16_t x, int16_t y);
+};
+
+/**
+ * Colors between two RGB565 colors along a linear or a radial gradient. The gradient position is kept
+ * in fixed point and advanced by increments between neighbor pixels, an optional 4x4 ordered dithering
+ * hides 565 banding of smooth gradients.
+ * @see PixelsBase::fillRectangleGradient(int16_t,int16_t,int16_t,int16_t,uint16_t,uint16_t,int16_t,boolean)
+ * @see PixelsBase::fillOvalRadial(int16_t,int16_t,int16_t,int16_t,uint16_t,uint16_t,boolean)
+ */
+class GradientRaster : public Raster {
+private:
+    uint16_t from;
+    uint16_t to;
+    boolean dither;
+    boolean radial;
+
+    // linear: position in 1/65536 of the gradient at (0, 0) and its column and row increments;
+    // radial: squared distance weights (1.0 at the edge is 2^24)
+    int32_t base;
+    int32_t kx;
+    int32_t ky;
+
+    int16_t originX;
+    int16_t originY;
+
+    // the last requested pixel and its position terms
+    int16_t lastX;
+    int16_t lastY;
+    int32_t tx;
+    int32_t ty;
+
+public:
+    /**
+     * @param fromColor color at the gradient start (or at the center of a radial gradient) in RGB565 format
+     * @param toColor color at the gradient end (or at the edge of a radial gradient) in RGB565 format
+     * @param dithered <i>true</i> to apply ordered dithering
+     */
+    GradientRaster(uint16_t fromColor, uint16_t toColor, boolean dithered) {
+        from = fromColor;
+        to = toColor;
+        dither = dithered;
+        radial = false;
+        base = kx = ky = 0;
+        originX = originY = 0;
+        lastX = lastY = 0;
+        tx = ty = 0;
+    }
+
+    /**
+     * Sets a linear gradient, which spans over a raster of the given dimensions
+     * @param width raster width
+     * @param height raster height
+     * @param angle direction from the start to the end color in degrees, 0 is left to right, 90 is bottom to top
+     */
+    void setLinear(int16_t width, int16_t height, int16_t angle);
+
+    /**
+     * Sets a radial gradient around the raster pixel (0, 0), which reaches the end color half
+     * a pixel out of the given radii
+     * @param rx horizontal radius
+     * @param ry vertical radius
+     */
+    void setRadial(int16_t rx, int16_t ry);
+
+    /**
+     * Shifts the requested pixels, used to output a gradient in parts
+     * @param x gradient column, which corresponds to the raster column 0
+     * @param y gradient row, which corresponds to the raster row 0
+     */
+    void setOrigin(int16_t x, int16_t y) {
+        originX = x;
+        originY = y;
+    }
+
+    uint16_t getPixel(int16_t x, int16_t y);
+};
+
+/*
+ * Progress of a scroll or text marquee movement, advanced one scroll step at a time
+ */
+class Animation {
+public:
+    uint8_t type;
+    int8_t flags;
+    uint32_t due; // time of the next step, ms
+    int16_t index; // next step (scroll) or scrolled distance (marquee)
+    int16_t count; // number of steps (scroll) or pass length (marquee)
+    int16_t step; // scroll distance of a step
+    int16_t easingLen;
+
+    int16_t x1; // scrolled columns (scroll)
+    int16_t x2;
+
+    /* marquee */
+    prog_uchar* font;
+    uint16_t* glyphs; // glyph offsets in the font, 0 for missing glyphs
+    int16_t* columns; // text column of each glyph and the text width at the end
+    int16_t glyphCount;
+    int16_t cursor; // first glyph, which is not scrolled out
+    int16_t textX; // text position in the absolute origin mode
+    int16_t y;
+    uint8_t repeat;
+    uint16_t maxScroll;
+
+    Animation() {
+        type = ANIMATION_NONE;
+        glyphs = NULL;
+        columns = NULL;
+    }
+};
+
+/*
+ * Resume token of a long fill or raster output, drawn a few rows at a time by PixelsBase::resume()
+ */
+class SliceToken {
+public:
+    uint8_t type;
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+    int16_t row; // next row to draw
+    uint16_t color;
+    prog_uint16_t* bitmap;
+    Raster* raster;
+
+    SliceToken() {
+        type = SLICE_NONE;
+        row = 0;
+        height = 0;
+    }
+
+    boolean isDone() {
+        return row >= height;
+    }
+};
+
+/*
+ * A non-horizontal polygon edge, stepped one row at a time. The position is kept as an integer
+ * part and a remainder of the exact slope, so long edges do not accumulate rounding errors.
+ */
+class PolygonEdge {
+public:
+    int16_t x1;
+    int16_t y1; // top row
+    int16_t y2; // bottom row
+    int8_t winding; // 1 for edges going down, -1 for edges going up
+
+    int16_t row; // current row
+    int16_t x; // rounded x at the current row
+
+    /* (row - y1) * (x2 - x1) = q * dy + r */
+    int16_t q;
+    int32_t r;
+    int16_t qStep;
+    int32_t rStep;
+    int32_t dy;
+
+    /**
+     * @return <i>false</i> for a horizontal edge, which is left unchanged
+     */
+    boolean set(int16_t xa, int16_t ya, int16_t xb, int16_t yb);
+    void start(int16_t y);
+
+    inline void step() {
+        row++;
+        q += qStep;
+        r += rStep;
+        if ( r >= dy ) {
+            r -= dy;
+            q++;
+        }
+        x = x1 + q + (2 * r >= dy ? 1 : 0);
+    }
+};
+
+/*
+ * Angular range of an arc around a center. Angles are in degrees, 0 at 3 o'clock, growing
+ * counter-clockwise. A row meets the range as one interval, which is kept, or, for arcs over
+ * a half turn, removed.
+ */
+class ArcSector {
+public:
+    int16_t cx;
+    int16_t cy;
+    /* start and end directions (y up), scaled by the radii */
+    int32_t ax;
+    int32_t ay;
+    int32_t bx;
+    int32_t by;
+    boolean reflex; // more than a half turn
+    int8_t openStart; // 1 leaves the start ray out
+    int8_t openEnd;
+
+    /**
+     * @param openFirst leaves the ray at <code>startAngle</code> out, so a neighbor range can own it
+     * @param openLast leaves the ray at <code>startAngle + arcAngle</code> out
+     */
+    void set(int16_t x, int16_t y, int16_t rx, int16_t ry, int16_t startAngle, int16_t arcAngle, boolean openFirst, boolean openLast);
+    /**
+     * @return <i>true</i> if pixels of the row between <code>lo</code> and <code>hi</code> belong to
+     * the range, <i>false</i> if only the pixels out of the interval do
+     */
+    boolean row(int16_t y, int16_t& lo, int16_t& hi);
+};
+
+/**
+ * A vector path of straight lines and Bezier curves, flattened to polylines as it is built. Curves
+ * are subdivided in 1/16 pixel fixed point until every piece is flat within a quarter of a pixel,
+ * so gentle curves take a few points and tight ones more. Every moveTo() starts a new contour.
+ * The edge table of a filled path is kept with the path and reused until the path changes.
+ *
+ *   Path arrow(32);
+ *   arrow.moveTo(10, 10);
+ *   arrow.lineTo(40, 25);
+ *   arrow.quadTo(20, 30, 10, 40);
+ *   arrow.close();
+ *   pxs.fillPath(&arrow);
+ *
+ * @see PixelsBase::drawPath(Path*)
+ * @see PixelsBase::fillPath(Path*,uint8_t)
+ */
+class Path {
+private:
+    int16_t* points;
+    uint16_t capacity;
+    uint16_t count;
+
+    /* contour ends (exclusive point indices) and closed flags */
+    uint16_t* ends;
+    boolean* closed;
+    uint8_t contourCapacity;
+    uint8_t contours;
+
+    /* the pen position and whether the last contour takes further segments */
+    int16_t penX;
+    int16_t penY;
+    boolean open;
+
+    PolygonEdge* edges;
+    PolygonEdge** active;
+    uint16_t edgeCount;
+    boolean edgesValid;
+
+    int8_t startContour();
+    int8_t addPoint(int16_t x, int16_t y);
+    int8_t flatten(int32_t* p, uint8_t depth);
+
+public:
+    /**
+     * @param maxPoints capacity of the flattened path, a contour takes up to 255 points
+     * @param maxContours maximal number of contours
+     */
+    Path(uint16_t maxPoints, uint8_t maxContours = 4);
+    ~Path();
+
+    /**
+     * Removes all contours, the pen goes to (0, 0)
+     */
+    void reset();
+
+    /**
+     * Starts a new contour at the given point
+     * @return 0 on success; -1 if the path is full
+     */
+    int8_t moveTo(int16_t x, int16_t y);
+    /**
+     * Adds a straight line from the pen position
+     * @return 0 on success; -1 if the path is full
+     */
+    int8_t lineTo(int16_t x, int16_t y);
+    /**
+     * Adds a quadratic Bezier curve from the pen position
+     * @param cx the <i>x</i> coordinate of the control point
+     * @param cy the <i>y</i> coordinate of the control point
+     * @return 0 on success; -1 if the path is full
+     */
+    int8_t quadTo(int16_t cx, int16_t cy, int16_t x, int16_t y);
+    /**
+     * Adds a cubic Bezier curve from the pen position
+     * @param c1x the <i>x</i> coordinate of the first control point
+     * @param c1y the <i>y</i> coordinate of the first control point
+     * @param c2x the <i>x</i> coordinate of the second control point
+     * @param c2y the <i>y</i> coordinate of the second control point
+     * @return 0 on success; -1 if the path is full
+     */
+    int8_t cubicTo(int16_t c1x, int16_t c1y, int16_t c2x, int16_t c2y, int16_t x, int16_t y);
+    /**
+     * Closes the current contour with a line to its start, where the pen returns
+     */
+    void close();
+
+    uint8_t getContours() {
+        return contours;
+    }
+
+    /**
+     * @return points of the contour as x1, y1, x2, y2, ...
+     */
+    int16_t* getContour(uint8_t index, uint8_t& length, boolean& isClosed);
+
+    /**
+     * Edge table of all contours sorted by the top rows, built on the first call after a change
+     * @param table sorted edges
+     * @param activeTable room for the active edges of a scanline fill
+     * @return number of edges; -1 if there is no memory for the table
+     */
+    int16_t getEdges(PolygonEdge*& table, PolygonEdge**& activeTable);
+};
+
+class BitStream;
+
+class PixelsBase : public virtual ChipSelect {
 protected:
     /* device physical dimension in portrait orientation */
     int16_t deviceWidth;
@@ -196,6 +819,10 @@ protected:
 
     boolean relativeOrigin;
 
+    /* clip rectangles in logical coordinates, every one within the previous one */
+    Bounds clipStack[MAX_CLIPS];
+    uint8_t clipDepth;
+
     /* currently selected font */
     prog_uchar* currentFont;
 
@@ -203,6 +830,8 @@ protected:
     RGB* background;
 
     double lineWidth;
+    uint8_t lineCap;
+    uint8_t lineJoin;
 
     uint8_t fillDirection;
     boolean antialiasing;
@@ -215,6 +844,58 @@ protected:
     boolean scrollCleanMode;
     uint16_t extraScrollDelay;
 
+    Animation animations[MAX_ANIMATIONS];
+
+    void prepareScroll(Animation& a, int16_t dy, int16_t x1, int16_t x2, int8_t flags);
+    void prepareScrollText(Animation& a, int16_t x, int16_t y, String text, uint8_t scrollStep, uint8_t repeat, uint16_t maxScroll);
+    uint16_t scrollStepDelay(Animation& a, int16_t k, boolean before);
+    boolean animationStep(Animation& a);
+    boolean marqueeStep(Animation& a);
+    void drawMarquee(Animation& a, int16_t x1, int16_t x2);
+    void releaseAnimation(Animation& a);
+    void runAnimation(Animation& a);
+    int8_t startAnimation(Animation& a);
+
+    /* cooperative slicing of long fills and raster outputs */
+    void (*sliceHandler)();
+    int16_t sliceRows;
+    void yieldSlice();
+    int8_t beginSlice(SliceToken& token, uint8_t type, int16_t x, int16_t y, int16_t width, int16_t height);
+
+    boolean isConvex(int16_t* points, uint8_t count);
+    void fillConvex(int16_t* points, uint8_t count);
+    int8_t fillEdges(PolygonEdge* edges, uint16_t count, uint8_t rule, PolygonEdge** activeTable = NULL);
+    void drawPolygonEdgesAntialiased(int16_t* points, uint8_t count);
+    int8_t fillPoints(int16_t* points, uint8_t count, uint8_t rule);
+
+    /* thick outlines */
+    int16_t strokeWidth();
+    void fillConvexFine(int32_t* points, uint8_t count);
+    void drawFineEdgeAntialiased(int32_t* p, int32_t* q);
+    void strokeSegment(int16_t* a, int16_t* b, int16_t ux, int16_t uy, uint8_t startCap, uint8_t endCap);
+    void strokeJoin(int16_t* v, int16_t pux, int16_t puy, int16_t ux, int16_t uy);
+    void strokePolyline(int16_t* points, uint8_t count, boolean closed);
+    void strokeRoundRectangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry);
+
+    /* antialiased round shapes as blended edge runs and interior spans */
+    void fillRoundRectangleAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry);
+
+    /* round shapes as spans per row: rings, arcs, pies */
+    void fillRoundRing(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry, int16_t outer, int16_t inner, ArcSector* sector, int color, int16_t* halfWidths = NULL);
+    void fillSector(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t rx, int16_t ry, int16_t outer, int16_t inner, int16_t startAngle, int16_t arcAngle, boolean openFirst, boolean openLast, int color, int16_t* halfWidths = NULL);
+
+    /* fixed (not scrolled) device rows above and below the scrolling band */
+    int16_t scrollTop;
+    int16_t scrollBottom;
+
+    inline int16_t scrollBand() {
+        return deviceHeight - scrollTop - scrollBottom;
+    }
+    int16_t deviceScroll();
+    int16_t scrollRow(int16_t y);
+    int16_t scrollRun(int16_t y, int16_t yy, int8_t dir);
+    uint8_t scrollPieces(Bounds& bb, Bounds* pieces, int16_t* shifts);
+
     int16_t caretX;
     int16_t caretY;
 
@@ -233,8 +914,46 @@ protected:
 
     int gfxOpNestingDepth;
 
+    /* off-screen frame buffer, in device coordinates */
+    uint16_t* fbData;
+    boolean fbOwned;
+    Bounds fbBounds;
+    Bounds fbWindow;
+    int16_t fbX;
+    int16_t fbY;
+    Bounds dirtyRects[MAX_DIRTY_RECTS];
+    uint8_t dirtyCount;
+
+    void addDirtyRect(Bounds& bb);
+
+    /* display list, recorded between beginDisplayList() and endDisplayList() */
+    uint8_t* dlData;
+    uint16_t dlSize;
+    uint16_t dlLength;
+    boolean dlRecording;
+    boolean dlOverflow;
+    boolean dlStateValid;
+    uint8_t dlState[DL_STATE_SIZE];
+
+    boolean recordCommand(uint8_t op, const void* args, uint8_t argsSize,
+                          const void* data = NULL, uint8_t dataSize = 0, const char* text = NULL);
+    void packState(uint8_t* state);
+    void unpackState(uint8_t* state);
+    void replayDisplayList();
+
     boolean transformBounds(Bounds& bb);
     boolean checkBounds(Bounds& bb);
+
+    boolean clipBounds(Bounds& bb);
+    Bounds visibleArea();
+
+    inline boolean isClipped(int16_t x, int16_t y) {
+        if ( clipDepth == 0 ) {
+            return false;
+        }
+        Bounds& c = clipStack[clipDepth - 1];
+        return x < c.x1 || x > c.x2 || y < c.y1 || y > c.y2;
+    }
     void printString(int16_t xx, int16_t yy, String text, boolean clean, int8_t kerning[] = NULL);
     void drawGlyph(int16_t fontType, boolean clean, int16_t xx, int16_t yy,
                                int16_t height, prog_uchar* data, int16_t length);
@@ -252,27 +971,61 @@ protected:
     void putColor(int16_t x, int16_t y, boolean steep, double weight);
     RGB* computeColor(RGB* bg, double weight);
     RGB* computeColor(RGB* fg, uint8_t opacity);
+    uint16_t blendColor(uint16_t fg, uint16_t bg, uint8_t weight, uint8_t maxWeight);
 
     void resetRegion();
 
+    int32_t deviceRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+    void deviceFill(int color, int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+    void logicalToDevice(int16_t x, int16_t y, int16_t& xx, int16_t& yy);
+
     void hLine(int16_t x1, int16_t y1, int16_t x2);
     void vLine(int16_t x1, int16_t y1, int16_t y2);
+    void thinLine(int color, int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+    boolean pixelToDevice(int16_t x, int16_t y, int16_t& xx, int16_t& yy);
 
     virtual void deviceWriteData(uint8_t hi, uint8_t lo) {}
+    virtual void deviceWriteBlock(uint16_t* data, int16_t length);
+
+    /*
+     * Reads a device memory region into the buffer in the region scan order. Returns the number of
+     * pixels read or -1 if the controller or the bus cannot read the video RAM back.
+     */
+    virtual int32_t readRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t* data) { return -1; }
+    boolean readPixels(int16_t x, int16_t y, int16_t length, uint16_t* raster);
 
     virtual void scrollCmd() {}
+    virtual boolean scrollAreaCmd() {
+        return scrollTop == 0 && scrollBottom == 0;
+    }
 
     virtual void drawCircleAntialiaced(int16_t x, int16_t y, int16_t radius, boolean bordermode);
-    virtual void drawFatLineAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
     virtual void drawLineAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
     virtual void drawRoundRectangleAntialiased(int16_t x, int16_t y, int16_t width, int16_t height, int16_t rx, int16_t ry, boolean bordermode);
 
-    int16_t* loadFileBytes(String);
+    ByteReader* byteReader;
+
+    void putRaster(Bounds& bb, int16_t shift, int16_t x, int16_t y, Raster* raster);
+    int8_t drawCompressedStream(int16_t x, int16_t y, uint8_t* header, BitStream& bs,
+                                int16_t targetWidth = 0, int16_t targetHeight = 0, uint8_t scaleMode = SCALE_NEAREST,
+                                uint16_t* rows = NULL);
+    int8_t drawCompressedStreamBilinear(int16_t x, int16_t y, uint8_t* header, BitStream& bs,
+                                        int16_t targetWidth, int16_t targetHeight);
+
+    /* glyph output magnification in 8.8 fixed point, relative to the glyph top-left corner */
+    uint16_t glyphScale;
+    int16_t glyphX;
+    int16_t glyphY;
+    /* glyph output column range */
+    int16_t glyphClipX1;
+    int16_t glyphClipX2;
+    void glyphFill(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
 
     RGB* computedBgColor;
     RGB* computedFgColor;
     RGB* bgBuffer;
     RGB* fgBuffer;
+    RGB* pixelBuffer;
 
     virtual void beginGfxOperation() {
         chipSelect();
@@ -351,9 +1104,11 @@ public:
         return scrollEnabled & scrollSupported;
     }
     /**
-     * Sets the current line width. For time being the line width is respected by
-     * drawLine(int16_t,int16_t,int16_t,int16_t) and a line width control is still "under construction".
+     * Sets the current line width. Lines, polylines and outlines of rectangles, round rectangles,
+     * circles and ovals wider than one pixel are filled as spans; the width is rounded to whole pixels.
      * @param width new line width.
+     * @see setLineCap(uint8_t)
+     * @see setLineJoin(uint8_t)
      */
     inline void setLineWidth(double width) {
         lineWidth = width;
@@ -365,6 +1120,35 @@ public:
     inline double getLineWidth() {
         return lineWidth;
     }
+    /**
+     * Sets the shape of thick line ends.
+     * @param cap LINE_CAP_BUTT (default), LINE_CAP_ROUND or LINE_CAP_SQUARE
+     */
+    inline void setLineCap(uint8_t cap) {
+        lineCap = cap;
+    }
+    /**
+     * Returns the current shape of thick line ends.
+     * @return LINE_CAP_BUTT, LINE_CAP_ROUND or LINE_CAP_SQUARE
+     */
+    inline uint8_t getLineCap() {
+        return lineCap;
+    }
+    /**
+     * Sets the shape of thick polyline and polygon corners. Miter corners sharper than about
+     * 29 degrees are beveled.
+     * @param join LINE_JOIN_MITER (default), LINE_JOIN_ROUND or LINE_JOIN_BEVEL
+     */
+    inline void setLineJoin(uint8_t join) {
+        lineJoin = join;
+    }
+    /**
+     * Returns the current shape of thick polyline and polygon corners.
+     * @return LINE_JOIN_MITER, LINE_JOIN_ROUND or LINE_JOIN_BEVEL
+     */
+    inline uint8_t getLineJoin() {
+        return lineJoin;
+    }
     /**
      * Returns device width.
      * @return device width.
@@ -400,6 +1184,149 @@ public:
     inline boolean isOriginRelative() {
         return relativeOrigin;
     }
+    /**
+     * Limits all the following output to the given rectangle within the current clip rectangle, until
+     * the matching popClip(). Clipping happens before any device access: rows, spans, glyphs and
+     * images out of the clip rectangle are skipped. The rectangle is in the coordinates of the current
+     * orientation; reading pixels is not clipped.
+     * @param x the <i>x</i> coordinate of the clip rectangle
+     * @param y the <i>y</i> coordinate of the clip rectangle
+     * @param width the width of the clip rectangle
+     * @param height the height of the clip rectangle
+     * @return 0 on success; -1 if MAX_CLIPS rectangles are already pushed
+     * @see popClip()
+     */
+    int8_t pushClip(int16_t x, int16_t y, int16_t width, int16_t height);
+    /**
+     * Restores the clip rectangle, which was current before the last pushClip()
+     * @return 0 on success; -1 if no clip rectangle is pushed
+     * @see pushClip(int16_t,int16_t,int16_t,int16_t)
+     */
+    int8_t popClip();
+    /**
+     * Redirects all the output to an off-screen RGB565 frame buffer. The buffer covers the whole
+     * display or its part, given in physical (portrait, not scrolled) device coordinates; the output
+     * outside of the part is discarded. Changed areas are tracked and sent to the display by
+     * flushFrameBuffer(). While the frame buffer is enabled getPixel() reports actual pixel colors.
+     * @param buffer memory for width * height pixels or NULL to allocate it
+     * @param x the left edge of the covered area
+     * @param y the top edge of the covered area
+     * @param width the covered area width
+     * @param height the covered area height
+     * @return <i>false</i> if the memory cannot be allocated
+     * @see flushFrameBuffer()
+     */
+    boolean enableFrameBuffer(uint16_t* buffer, int16_t x, int16_t y, int16_t width, int16_t height);
+    /**
+     * Redirects all the output to an off-screen frame buffer, which covers the whole display
+     * @return <i>false</i> if the memory cannot be allocated
+     * @see enableFrameBuffer(uint16_t*,int16_t,int16_t,int16_t,int16_t)
+     */
+    boolean enableFrameBuffer() {
+        return enableFrameBuffer(NULL, 0, 0, deviceWidth, deviceHeight);
+    }
+    /**
+     * Flushes the frame buffer changes and restores the direct output to the display
+     */
+    void disableFrameBuffer();
+    /**
+     * Sends the changed frame buffer areas to the display
+     */
+    void flushFrameBuffer();
+    /**
+     * @return <i>true</i> if the output goes to an off-screen frame buffer
+     */
+    inline boolean isFrameBufferEnabled() {
+        return fbData != NULL;
+    }
+    /**
+     * Starts a display list recording. Subsequent drawing calls (shape, bitmap, icon, raster and text
+     * output, clear()) produce no output, but are stored to the buffer as compact commands together
+     * with the color, font and mode changes they depend on. Bitmap, icon, font, kerning, raster and polygon
+     * data are referenced, not copied, so they have to stay valid until the list is rendered.
+     * loadBitmap() and scroll operations are not recorded.
+     * @param buffer memory for the commands
+     * @param size the buffer size in bytes
+     * @see renderDisplayList(uint16_t*,int16_t)
+     */
+    void beginDisplayList(uint8_t* buffer, uint16_t size);
+    /**
+     * Stops the display list recording
+     * @return <i>false</i> if the commands did not fit the buffer
+     */
+    boolean endDisplayList();
+    /**
+     * Renders the recorded display list band by band: the commands are replayed into a strip buffer,
+     * which covers the full device width and <code>bandHeight</code> physical rows, then the strip
+     * goes to the display as one window. The screen is composed off-screen with a small amount of RAM,
+     * every device pixel is written once. The list stays valid and can be rendered again.
+     * @param strip memory for deviceWidth * bandHeight pixels, for example 240x16 for a 240x320 display
+     * @param bandHeight band height in physical rows
+     * @return 0 on success, -1 if there is nothing to render or the frame buffer is enabled,
+     * -2 if the list is incomplete because of a buffer overflow
+     */
+    int8_t renderDisplayList(uint16_t* strip, int16_t bandHeight);
+    /**
+     * Splits long fills and raster outputs (clear(), fillRectangle(), bitmaps, rasters) into chunks of
+     * device rows. Between two chunks the chip select is released and the handler is called, so a control
+     * loop keeps its deadlines while the screen is repainted. The handler must not draw on this display.
+     * @param handler function to call between chunks; NULL disables the slicing
+     * @see setSliceRows(int16_t)
+     */
+    void setSliceHandler(void (*handler)()) {
+        sliceHandler = handler;
+    }
+    /**
+     * Sets the chunk height of sliced operations
+     * @param rows device rows per chunk (by setSliceHandler()) or logical rows per resume() call
+     */
+    void setSliceRows(int16_t rows) {
+        sliceRows = rows > 0 ? rows : 1;
+    }
+    /**
+     * Prepares a rectangle fill with the current color, which is drawn by resume() calls.
+     * @param token resume token, keeps the operation progress
+     * @return 0 on success, -1 if there is nothing to draw
+     * @see resume(SliceToken&)
+     */
+    int8_t beginFill(SliceToken& token, int16_t x, int16_t y, int16_t width, int16_t height);
+    /**
+     * Prepares a screen clear, which is drawn by resume() calls.
+     * @param token resume token, keeps the operation progress
+     * @return 0 on success
+     * @see resume(SliceToken&)
+     */
+    int8_t beginClear(SliceToken& token);
+    /**
+     * Prepares a bitmap output, which is drawn by resume() calls.
+     * @param token resume token, keeps the operation progress
+     * @param data RGB565 bitmap
+     * @return 0 on success, -1 if there is nothing to draw
+     * @see resume(SliceToken&)
+     */
+    int8_t beginBitmap(SliceToken& token, int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data);
+    /**
+     * Prepares a raster output, which is drawn by resume() calls.
+     * @param token resume token, keeps the operation progress
+     * @param raster pixel source, has to stay valid until the token is done
+     * @return 0 on success, -1 if there is nothing to draw
+     * @see resume(SliceToken&)
+     */
+    int8_t beginRaster(SliceToken& token, int16_t x, int16_t y, int16_t width, int16_t height, Raster* raster);
+    /**
+     * Draws the next setSliceRows() rows of a prepared operation. The chip select is released on return,
+     * so the caller may use the bus for other devices in between.
+     *
+     *   SliceToken token;
+     *   pxs.beginClear(token);
+     *   while ( pxs.resume(token) ) {
+     *       controlLoop();
+     *   }
+     *
+     * @param token resume token
+     * @return <i>true</i> if the operation has more rows to draw
+     */
+    boolean resume(SliceToken& token);
     /**
      * Outout fine tuning method for slow devices
      * @param direction accepts FILL_TOPDOWN, FILL_LEFTRIGHT, FILL_DOWNTOP or FILL_RIGHTLEFT
@@ -464,6 +1391,7 @@ public:
     /**
      * Gets a pixel color at the point
      * <code>(x,&nbsp;y)</code> in the current coordinate system.
+     * The color is read from the frame buffer, if enabled, or from the video RAM.
      * If video RAM read is not supported by the hardware, returns the
      * graphics context's current background color
      * @param   x  <i>x</i> coordinate.
@@ -471,6 +1399,17 @@ public:
      * @return  pixel color or the graphics context's current background color.
      */
     RGB* getPixel(int16_t x, int16_t y);
+    /**
+     * Reads a horizontal line of pixels, starting at the point
+     * <code>(x,&nbsp;y)</code> in the current coordinate system.
+     * If video RAM read is not supported by the hardware, the line is
+     * filled with the graphics context's current background color
+     * @param   x  <i>x</i> coordinate of the leftmost pixel.
+     * @param   y  <i>y</i> coordinate.
+     * @param   length  number of pixels.
+     * @param   raster  destination buffer for the pixel colors in RGB565 format.
+     */
+    virtual void readRasterLine(int16_t x, int16_t y, int16_t length, uint16_t* raster);
     /**
      * Draws a pixel, using the current color, at the point
      * <code>(x,&nbsp;y)</code>
@@ -479,6 +1418,14 @@ public:
      * @param   y  <i>y</i> coordinate.
      */
     void drawPixel(int16_t x, int16_t y);
+    /**
+     * Draws a set of pixels with the current color as one operation. Adjacent points of a row
+     * (x, x + 1, ...) go out as one run.
+     * @param       points pixel coordinates: x1, y1, x2, y2, ...
+     * @param       count number of pixels
+     * @see         drawPixel(int16_t,int16_t)
+     */
+    void drawPixels(int16_t* points, uint16_t count);
     /**
      * Draws a line, using the current color, between the points
      * <code>(x1,&nbsp;y1)</code> and <code>(x2,&nbsp;y2)</code>
@@ -491,6 +1438,28 @@ public:
      * @see     setOriginAbsolute()
      */
     void drawLine(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+    /**
+     * Draws connected lines through the given points with the current color, line width,
+     * cap and join.
+     * @param       points vertex coordinates: x1, y1, x2, y2, ...
+     * @param       count number of vertices
+     * @see         drawPolygon(int16_t*,uint8_t)
+     */
+    void drawPolyline(int16_t* points, uint8_t count);
+    /**
+     * Draws a set of unconnected lines with the current color and line width as one operation.
+     * @param       points segment end coordinates: x1, y1, x2, y2 of the first line, then of the second one, ...
+     * @param       count number of lines
+     * @see         drawLine(int16_t,int16_t,int16_t,int16_t)
+     */
+    void drawLines(int16_t* points, uint16_t count);
+    /**
+     * Draws the outline of a closed polygon with the current color, line width and join.
+     * @param       points vertex coordinates: x1, y1, x2, y2, ...
+     * @param       count number of vertices
+     * @see         fillPolygon(int16_t*,uint8_t,uint8_t)
+     */
+    void drawPolygon(int16_t* points, uint8_t count);
     /**
      * Draws the outline of a circle, defined by center coordinates and a radius,
      * with the current color.
@@ -549,6 +1518,70 @@ public:
      * @see        fillRoundRectangle(int16_t,int16_t,int16_t,int16_t,int16_t)
      */
     void drawRoundRectangle(int16_t x, int16_t y, int16_t width, int16_t height, int16_t r);
+    /**
+     * Draws an outline of a circular or elliptical arc along the oval drawn by
+     * drawOval(int16_t,int16_t,int16_t,int16_t) with the same bounds. The current line width
+     * applies, the arc ends are cut along the radii.
+     * <p>
+     * Angles are in degrees. 0 is at the 3 o'clock position, positive values go counter-clockwise.
+     * The angles are relative to the bounding rectangle, so 45 degrees always points to its corner.
+     * @param       x the <i>x</i> coordinate of the upper left corner of the oval.
+     * @param       y the <i>y</i> coordinate of the upper left corner of the oval.
+     * @param       width the width of the oval.
+     * @param       height the height of the oval.
+     * @param       startAngle the beginning angle.
+     * @param       arcAngle the angular extent of the arc, relative to the start angle.
+     * @see         fillArc(int16_t,int16_t,int16_t,int16_t,int16_t,int16_t)
+     */
+    void drawArc(int16_t x, int16_t y, int16_t width, int16_t height, int16_t startAngle, int16_t arcAngle);
+    /**
+     * Fills a pie shaped part of the oval filled by fillOval(int16_t,int16_t,int16_t,int16_t)
+     * with the same bounds. The angles are as by drawArc(int16_t,int16_t,int16_t,int16_t,int16_t,int16_t).
+     * @param       x the <i>x</i> coordinate of the upper left corner of the oval.
+     * @param       y the <i>y</i> coordinate of the upper left corner of the oval.
+     * @param       width the width of the oval.
+     * @param       height the height of the oval.
+     * @param       startAngle the beginning angle.
+     * @param       arcAngle the angular extent of the arc, relative to the start angle.
+     * @see         fillPie(int16_t,int16_t,int16_t,int16_t,int16_t)
+     */
+    void fillArc(int16_t x, int16_t y, int16_t width, int16_t height, int16_t startAngle, int16_t arcAngle);
+    /**
+     * Fills a pie shaped part of a circle, defined by center coordinates and a radius.
+     * @param       x the <i>x</i> coordinate of the circle center.
+     * @param       y the <i>y</i> coordinate of the circle center.
+     * @param       radius circle radius.
+     * @param       startAngle the beginning angle in degrees, 0 is at 3 o'clock.
+     * @param       arcAngle the angular extent of the pie, positive values go counter-clockwise.
+     * @see         fillRingSegment(int16_t,int16_t,int16_t,int16_t,int16_t,int16_t)
+     */
+    void fillPie(int16_t x, int16_t y, int16_t radius, int16_t startAngle, int16_t arcAngle);
+    /**
+     * Fills a part of a ring between two circles around the same center; the typical gauge scale.
+     * Pixels at the distances from <code>innerRadius</code> to <code>outerRadius</code> are covered.
+     * @param       x the <i>x</i> coordinate of the center.
+     * @param       y the <i>y</i> coordinate of the center.
+     * @param       outerRadius the outer radius.
+     * @param       innerRadius the inner radius, 0 for a pie.
+     * @param       startAngle the beginning angle in degrees, 0 is at 3 o'clock.
+     * @param       arcAngle the angular extent of the segment, positive values go counter-clockwise.
+     * @see         updateRingSegment(int16_t,int16_t,int16_t,int16_t,int16_t,int16_t,int16_t)
+     */
+    void fillRingSegment(int16_t x, int16_t y, int16_t outerRadius, int16_t innerRadius, int16_t startAngle, int16_t arcAngle);
+    /**
+     * Changes a ring segment drawn by fillRingSegment(int16_t,int16_t,int16_t,int16_t,int16_t,int16_t)
+     * from one extent to another. Only the difference is drawn: with the current color if the segment
+     * grows, with the background color if it shrinks. The remaining pixels are left untouched, so a gauge
+     * needle or value update costs as much as the angle change. The call is not recorded by display lists.
+     * @param       x the <i>x</i> coordinate of the center.
+     * @param       y the <i>y</i> coordinate of the center.
+     * @param       outerRadius the outer radius.
+     * @param       innerRadius the inner radius, 0 for a pie.
+     * @param       startAngle the beginning angle in degrees, 0 is at 3 o'clock.
+     * @param       oldArcAngle the currently drawn extent.
+     * @param       newArcAngle the new extent.
+     */
+    void updateRingSegment(int16_t x, int16_t y, int16_t outerRadius, int16_t innerRadius, int16_t startAngle, int16_t oldArcAngle, int16_t newArcAngle);
     /**
      * Fills a circle, defined by center coordinates and a radius, with the current color.
      * @param       x the <i>x</i> coordinate of the circle center.
@@ -588,6 +1621,46 @@ public:
      * @see           drawRectangle(int16_t,int16_t,int16_t,int16_t)
      */
     void fillRectangle(int16_t x, int16_t y, int16_t width, int16_t height);
+    /**
+     * Fills a set of rectangles with the current color as one operation. Neighbor rectangles
+     * of the list, which continue each other to a larger one (stacked bars, table cells), are filled
+     * as one region. Rectangles of zero or negative size are skipped.
+     * @param         rects   rectangles: x, y, width, height of the first one, then of the second one, ...
+     * @param         count   number of rectangles
+     * @see           fillRectangle(int16_t,int16_t,int16_t,int16_t)
+     */
+    void fillRects(int16_t* rects, uint16_t count);
+    /**
+     * Fills the specified rectangle with a linear gradient between two colors. The rectangle is output
+     * as one region, pixel colors are computed on the fly.
+     * @param         x   the <i>x</i> coordinate of the rectangle to be filled.
+     * @param         y   the <i>y</i> coordinate of the rectangle to be filled.
+     * @param         width   the width of the rectangle to be filled.
+     * @param         height   the height of the rectangle to be filled.
+     * @param         fromColor   color at the start side (corner) in RGB565 format
+     * @param         toColor   color at the opposite side (corner) in RGB565 format
+     * @param         angle   gradient direction in degrees, counter-clockwise from left to right:
+     *                        GRADIENT_HORIZONTAL, GRADIENT_VERTICAL (top to bottom) or any other angle
+     * @param         dither   <i>true</i> to smooth the color steps of the RGB565 format by ordered dithering
+     * @see           fillRectangle(int16_t,int16_t,int16_t,int16_t)
+     */
+    void fillRectangleGradient(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t fromColor, uint16_t toColor,
+                               int16_t angle = GRADIENT_HORIZONTAL, boolean dither = false);
+    /**
+     * Fills an oval bounded by the specified rectangle with a radial gradient from the center to
+     * the edge. Pixels with centers up to half a pixel out of the oval are filled, every row is output
+     * as one region.
+     * @param       x the <i>x</i> coordinate of the upper left corner of the oval to be filled.
+     * @param       y the <i>y</i> coordinate of the upper left corner of the oval to be filled.
+     * @param       width the width of the oval to be filled.
+     * @param       height the height of the oval to be filled.
+     * @param       centerColor color at the center in RGB565 format
+     * @param       edgeColor color at the edge in RGB565 format
+     * @param       dither <i>true</i> to smooth the color steps of the RGB565 format by ordered dithering
+     * @see         fillOval(int16_t,int16_t,int16_t,int16_t)
+     */
+    void fillOvalRadial(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t centerColor, uint16_t edgeColor,
+                        boolean dither = false);
     /**
      * Fills the specified rounded corner rectangle with the current color.
      * The left and right edges of the rectangle
@@ -602,6 +1675,44 @@ public:
      * @see         drawRoundRectangle(int16_t,int16_t,int16_t,int16_t,int16_t)
      */
     void fillRoundRectangle(int16_t x, int16_t y, int16_t width, int16_t height, int16_t r);
+    /**
+     * Fills a triangle with the current color. The vertices are pixel centers, every row from the top
+     * to the bottom vertex gets a span between the edge positions, rounded to the nearest pixels.
+     * @param       x1 the <i>x</i> coordinate of the first vertex.
+     * @param       y1 the <i>y</i> coordinate of the first vertex.
+     * @param       x2 the <i>x</i> coordinate of the second vertex.
+     * @param       y2 the <i>y</i> coordinate of the second vertex.
+     * @param       x3 the <i>x</i> coordinate of the third vertex.
+     * @param       y3 the <i>y</i> coordinate of the third vertex.
+     * @see         fillPolygon(int16_t*,uint8_t,uint8_t)
+     */
+    void fillTriangle(int16_t x1, int16_t y1, int16_t x2, int16_t y2, int16_t x3, int16_t y3);
+    /**
+     * Fills a closed polygon with the current color. A convex polygon is filled directly from its
+     * two side chains, other polygons need a temporary edge table.
+     * @param       points vertex coordinates: x1, y1, x2, y2, ...
+     * @param       count number of vertices
+     * @param       rule POLYGON_EVEN_ODD or POLYGON_NONZERO, matters for self-intersecting polygons
+     * @return      0 on success; -1 if there are less than 3 vertices or no memory for the edge table
+     * @see         fillTriangle(int16_t,int16_t,int16_t,int16_t,int16_t,int16_t)
+     */
+    int8_t fillPolygon(int16_t* points, uint8_t count, uint8_t rule = POLYGON_EVEN_ODD);
+    /**
+     * Draws the contours of a path with the current color and line width, closed contours get
+     * a join at their start.
+     * @param       path the path
+     * @see         fillPath(Path*,uint8_t)
+     */
+    void drawPath(Path* path);
+    /**
+     * Fills a path with the current color. All contours count as closed, so a contour within
+     * another one makes a hole by the even-odd rule or when it runs the other way round.
+     * @param       path the path
+     * @param       rule POLYGON_EVEN_ODD or POLYGON_NONZERO
+     * @return      0 on success; -1 if there is no memory for the edge table
+     * @see         drawPath(Path*)
+     */
+    int8_t fillPath(Path* path, uint8_t rule = POLYGON_NONZERO);
     /**
      * Draws specified bitmap image.
      * The image is drawn with its top-left corner at
@@ -616,6 +1727,58 @@ public:
      * @see      loadBitmap(int16_t,int16_t,int16_t,int16_t,String)
      */
     int8_t drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data);
+    /**
+     * Draws specified bitmap image, resized to the given dimensions. The resized image
+     * is output as one region, without intermediate buffers.
+     * The image is drawn with its top-left corner at
+     * (<i>x</i>,&nbsp;<i>y</i>) in the current coordinate
+     * space.
+     * @param    x   the <i>x</i> coordinate.
+     * @param    y   the <i>y</i> coordinate.
+     * @param    width   the width of the image.
+     * @param    height   the height of the image.
+     * @param    data the specified bitmap image to be drawn.
+     * @param    targetWidth   the resulting width. An integer multiple of the width replicates pixels.
+     * @param    targetHeight   the resulting height. An integer multiple of the height replicates rows.
+     * @param    scaleMode   SCALE_NEAREST or SCALE_BILINEAR. Integer multiples of both dimensions
+     *                       replicate pixels in either mode.
+     * @see      drawBitmap(int16_t,int16_t,int16_t,int16_t,int[])
+     */
+    int8_t drawBitmapScaled(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data,
+                            int16_t targetWidth, int16_t targetHeight, uint8_t scaleMode = SCALE_NEAREST);
+    /**
+     * Draws specified bitmap image, pixels of the key color are treated as transparent
+     * and skipped.
+     * The image is drawn with its top-left corner at
+     * (<i>x</i>,&nbsp;<i>y</i>) in the current coordinate
+     * space.
+     * @param    x   the <i>x</i> coordinate.
+     * @param    y   the <i>y</i> coordinate.
+     * @param    width   the width of the image.
+     * @param    height   the height of the image.
+     * @param    data the specified bitmap image to be drawn.
+     * @param    key transparent color in RGB565 format.
+     * @see      drawBitmap(int16_t,int16_t,int16_t,int16_t,int[])
+     */
+    int8_t drawBitmapKeyed(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data, uint16_t key);
+    /**
+     * Draws specified bitmap image, blended according to the given alpha plane. Fully transparent
+     * pixels are skipped, semi-transparent ones are blended with the background color (or with
+     * the actual content, if the display is able to report it).
+     * The image is drawn with its top-left corner at
+     * (<i>x</i>,&nbsp;<i>y</i>) in the current coordinate
+     * space.
+     * @param    x   the <i>x</i> coordinate.
+     * @param    y   the <i>y</i> coordinate.
+     * @param    width   the width of the image.
+     * @param    height   the height of the image.
+     * @param    data the specified bitmap image to be drawn.
+     * @param    alpha alpha plane. Every row starts from a byte boundary, values are packed high bits first.
+     * @param    alphaDepth bits per alpha value: 1 or 4
+     * @return   0 on success; -1 if the data is null or the alpha depth is not supported
+     * @see      drawBitmap(int16_t,int16_t,int16_t,int16_t,int[])
+     */
+    int8_t drawBitmapAlpha(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data, prog_uchar* alpha, uint8_t alphaDepth);
     /**
      * Draws specified bitmap image.
      * The image is drawn with its top-left corner at
@@ -628,6 +1791,24 @@ public:
      * @see      drawBitmap(int16_t,int16_t,int16_t,int16_t,int[])
      */
     int8_t drawCompressedBitmap(int16_t x, int16_t y, prog_uchar* data);
+    /**
+     * Draws specified compressed bitmap image, resized to the given dimensions. The image
+     * is resized while it is decoded and goes out in chunks of RASTER_BUFFER_SIZE pixels.
+     * Bilinear mode keeps two decoded rows in a buffer of SCALED_ROW_BUFFER_SIZE pixels, images
+     * too wide for it are resampled as the nearest pixels.
+     * The image is drawn with its top-left corner at
+     * (<i>x</i>,&nbsp;<i>y</i>) in the current coordinate
+     * space.
+     * @param    x   the <i>x</i> coordinate.
+     * @param    y   the <i>y</i> coordinate.
+     * @param    data compressed (with Pixelmeister) bitmap image bytes.
+     * @param    targetWidth   the resulting width.
+     * @param    targetHeight   the resulting height.
+     * @param    scaleMode   SCALE_NEAREST or SCALE_BILINEAR
+     * @see      drawCompressedBitmap(int16_t,int16_t,prog_uchar*)
+     */
+    int8_t drawCompressedBitmapScaled(int16_t x, int16_t y, prog_uchar* data,
+                                      int16_t targetWidth, int16_t targetHeight, uint8_t scaleMode = SCALE_NEAREST);
     /**
      * Draws an icon, prepared with Pixelmeister.
      * The icon is drawn with its top-left corner at
@@ -639,6 +1820,19 @@ public:
      * @param    y   the <i>y</i> coordinate.
      */
     void drawIcon(int16_t xx, int16_t yy, prog_uchar data[]);
+    /**
+     * Draws an icon, prepared with Pixelmeister, magnified or reduced to the given height.
+     * Every icon pixel run is output as one filled rectangle.
+     * The icon is drawn with its top-left corner at
+     * (<i>x</i>,&nbsp;<i>y</i>) in the current coordinate
+     * space.
+     * @param    data icon image bytes.
+     * @param    x   the <i>x</i> coordinate.
+     * @param    y   the <i>y</i> coordinate.
+     * @param    targetHeight   the resulting icon height, the width is scaled proportionally.
+     * @see      drawIcon(int16_t,int16_t,prog_uchar[])
+     */
+    void drawIconScaled(int16_t xx, int16_t yy, prog_uchar data[], int16_t targetHeight);
     /**
      * Paint icon pixels with background color. The icon should be in Pixelmeister format.
      * The icon is drawn with its top-left corner at
@@ -665,15 +1859,49 @@ public:
         return pgm_read_byte_near(data + 5);
     }
     /**
-     * Loads from an external FAT-drive and draws specified bitmap image.
+     * Draws a region, which pixel colors are given by a raster object.
+     * The region is drawn with its top-left corner at
+     * (<i>x</i>,&nbsp;<i>y</i>) in the current coordinate
+     * space. The pixels are requested in the device memory order.
+     * @param    x   the <i>x</i> coordinate.
+     * @param    y   the <i>y</i> coordinate.
+     * @param    width   the width of the region.
+     * @param    height   the height of the region.
+     * @param    raster   pixel colors source.
+     */
+    void drawRaster(int16_t x, int16_t y, int16_t width, int16_t height, Raster* raster);
+    /**
+     * Draws a horizontal line of pixels, given in RGB565 format.
+     * @param    x   the <i>x</i> coordinate of the leftmost pixel.
+     * @param    y   the <i>y</i> coordinate.
+     * @param    length   number of pixels.
+     * @param    raster   pixel colors.
+     */
+    void drawRasterLine(int16_t x, int16_t y, int16_t length, uint16_t* raster);
+    /**
+     * Sets a byte source for loadBitmap(int16_t,int16_t,int16_t,int16_t,String)
+     * @param    reader   SDReader (Pixels_SD.h), PosixReader (Pixels_Posix.h) or a custom implementation
+     */
+    void setByteReader(ByteReader* reader) {
+        byteReader = reader;
+    }
+    /**
+     * Loads with the current byte reader and draws specified bitmap image.
+     * The image is streamed through a fixed size row buffer, so it does not need
+     * to fit into RAM. Supported formats are 24-bit uncompressed BMP, Pixelmeister
+     * compressed ('Z') images and raw RGB565 pixel data (high byte first).
      * The image is drawn with its top-left corner at
      * (<i>x</i>,&nbsp;<i>y</i>) in the current coordinate
      * space.
      * @param    path to the image.
      * @param    x   the <i>x</i> coordinate.
      * @param    y   the <i>y</i> coordinate.
-     * @param    width   the width of the image.
-     * @param    height   the height of the image.
+     * @param    width   the width of the image. Ignored for BMP and 'Z' images, which define their dimensions.
+     * @param    height   the height of the image. Ignored for BMP and 'Z' images, which define their dimensions.
+     * @return   0 on success; -1 if no reader is set or the resource cannot be opened;
+     *           -8 if BMP format variant is not supported; -9 if raw image dimensions are not given;
+     *           other negative values indicate compressed image format errors
+     * @see      setByteReader(ByteReader*)
      * @see      drawBitmap(int16_t,int16_t,int16_t,int16_t,int[])
      */
     int8_t loadBitmap(int16_t x, int16_t y, int16_t width, int16_t height, String path);
@@ -699,6 +1927,34 @@ public:
         return currentScroll;
     }
 
+    /**
+     * Limits the hardware scroll to a band between fixed header and footer areas, so the areas never
+     * need to be repainted. The areas are given along the scroll direction of the current orientation
+     * (top and bottom for PORTRAIT, left and right for LANDSCAPE) and stay in place physically if the
+     * orientation changes. The scroll position is reset. setScrollArea(0, 0) restores full screen scroll.
+     * @param topFixed number of fixed rows at the beginning of the scroll direction
+     * @param bottomFixed number of fixed rows at the end of the scroll direction
+     * @return <i>false</i> if the controller cannot scroll a part of the screen or the areas do not fit
+     * @see scroll(int16_t,int8_t)
+     */
+    boolean setScrollArea(int16_t topFixed, int16_t bottomFixed);
+
+    /**
+     * @return the first scrolled row (column by LANDSCAPE orientations) in the absolute origin mode
+     * @see setScrollArea(int16_t,int16_t)
+     */
+    int16_t getScrollAreaStart() {
+        return orientation > 1 ? scrollBottom : scrollTop;
+    }
+
+    /**
+     * @return the row (column by LANDSCAPE orientations) next to the last scrolled one in the absolute origin mode
+     * @see setScrollArea(int16_t,int16_t)
+     */
+    int16_t getScrollAreaEnd() {
+        return deviceHeight - (orientation > 1 ? scrollTop : scrollBottom);
+    }
+
     /**
      * adds a ms pause to each scrolling step in smooth scrolling mode. Slows the scrolling down.
      * It can be useful for performant MCU devices to adjust a scrolling speed and to make it acceptable for a reading.
@@ -804,6 +2060,13 @@ public:
      * <a href="http://pd4ml.com/pixelmeister/">Pixelmeister</a>.
      */
     int setFont(prog_uchar font[]);
+    /**
+     * Gets the current font
+     * @return the font or NULL if none is set
+     */
+    inline prog_uchar* getFont() {
+        return currentFont;
+    }
     /**
      * Draws the text given by the specified string, using current font and color.
      * The baseline of the leftmost character is at position (<i>x</i>,&nbsp;<i>y</i>)
@@ -882,50 +2145,145 @@ public:
      * @see setScrollStepDelay(uint16_t)
      */
     void scrollText( int16_t x, int16_t y, String text, uint8_t scrollStep, uint8_t repeat, uint16_t maxScroll );
+
+    /**
+     * Starts a scroll movement, which is advanced by tick() instead of blocking the caller.
+     * The steps and the easing are the same as by scroll(int16_t,int16_t,int16_t,int8_t).
+     * @param dy negative or positive scroll distance
+     * @param x1 first scrolled column
+     * @param x2 last scrolled column
+     * @param flags can be 0, SCROLL_SMOOTH or/and SCROLL_CLEAN
+     * @return animation handle; -1 if MAX_ANIMATIONS movements are already running; -2 if the display cannot scroll
+     * @see tick(uint32_t)
+     */
+    int8_t startScroll(int16_t dy, int16_t x1, int16_t x2, int8_t flags);
+    /**
+     * Starts a scroll movement of the whole screen width, which is advanced by tick().
+     * @param dy negative or positive scroll distance
+     * @param flags can be 0, SCROLL_SMOOTH or/and SCROLL_CLEAN
+     * @return animation handle; -1 if MAX_ANIMATIONS movements are already running; -2 if the display cannot scroll
+     * @see tick(uint32_t)
+     */
+    int8_t startScroll(int16_t dy, int8_t flags) {
+        return startScroll(dy, 0, deviceWidth, flags);
+    }
+    /**
+     * Starts a text marquee, which is advanced by tick(). The parameters are the same as of scrollText().
+     * @return animation handle; -1 if MAX_ANIMATIONS movements are already running or there is no memory
+     *         for the glyph list; -2 if the display cannot scroll
+     * @see scrollText(int16_t,int16_t,String,uint8_t,uint8_t,uint16_t)
+     */
+    int8_t startScrollText(int16_t x, int16_t y, String text, uint8_t scrollStep, uint8_t repeat, uint16_t maxScroll);
+    /**
+     * @param handle animation handle
+     * @return <i>true</i> if the movement is not finished yet
+     */
+    boolean isAnimating(int8_t handle) {
+        return handle >= 0 && handle < MAX_ANIMATIONS && animations[handle].type != ANIMATION_NONE;
+    }
+    /**
+     * Stops a movement at the current step. An infinite marquee can only be stopped this way.
+     * @param handle animation handle
+     */
+    void stopAnimation(int8_t handle);
+    /**
+     * Advances all the running movements to the given time. A movement, which is late, catches up
+     * with several steps in one call. Should be called from loop() as often as possible:
+     *
+     *   pxs.tick(millis());
+     *
+     * @param now current time in milliseconds
+     */
+    void tick(uint32_t now);
 };
 
 class BitStream {
 private:
     prog_uchar* data;
-    size_t size;
+    uint32_t size;
     int32_t bitpos;
 
+    ByteReader* reader;
+    uint8_t* cache;
+    int16_t cacheSize;
+    int16_t cacheLen;
+    uint32_t cacheStart;
+
+    uint8_t byteAt(uint32_t offset) {
+        if ( reader == NULL ) {
+            return pgm_read_byte_near(data + offset);
+        }
+        if ( offset >= cacheStart + cacheLen ) {
+            // the stream is read strictly forward, so the missing byte follows the cached ones
+            cacheStart += cacheLen;
+            cacheLen = reader->read(cache, cacheSize);
+            if ( cacheLen <= 0 ) {
+                cacheLen = 0;
+                return 0;
+            }
+        }
+        return cache[offset - cacheStart];
+    }
+
 public:
     BitStream (prog_uchar* src_buffer, size_t byte_size, int8_t offset = 0) {
         bitpos = offset;
         data = src_buffer;
         size = byte_size + (offset>>3);
+        reader = NULL;
+    }
+
+    /**
+     * Constructs a stream over an opened byte reader
+     * @param src byte source
+     * @param buffer read-ahead buffer
+     * @param buffer_size read-ahead buffer size
+     */
+    BitStream (ByteReader* src, uint8_t* buffer, int16_t buffer_size) {
+        bitpos = 0;
+        data = NULL;
+        size = 0xFFFFFFFF;
+        reader = src;
+        cache = buffer;
+        cacheSize = buffer_size;
+        cacheLen = 0;
+        cacheStart = 0;
     }
 
     bool endOfData() {
-        return (size_t)((bitpos + 1) >> 3) >= size;
+        if ( reader != NULL ) {
+            byteAt(bitpos >> 3);
+            return (uint32_t)(bitpos >> 3) >= cacheStart + cacheLen;
+        }
+        return (uint32_t)((bitpos + 1) >> 3) >= size;
     }
 
     uint8_t testCurrentByte() {
-        uint8_t res = (uint8_t)pgm_read_byte_near(data + (bitpos>>3));
+        uint8_t res = byteAt(bitpos>>3);
         return res;
     }
 
     uint8_t readBit() {
-        uint8_t res = (uint8_t)(pgm_read_byte_near(data + (bitpos>>3)) & (uint8_t)( (uint16_t)0x80 >> (bitpos & 7) ));
+        uint8_t res = (uint8_t)(byteAt(bitpos>>3) & (uint8_t)( (uint16_t)0x80 >> (bitpos & 7) ));
         bitpos++;
         return res;
     }
 
     uint8_t readBits(uint8_t len) {
 
-        uint16_t end_offset = (bitpos + len - 1)>>3;
+        uint32_t end_offset = (bitpos + len - 1)>>3;
         if ( end_offset >= size ) {
             return 0;
         }
 
         uint8_t i;
-        uint16_t byte_offset = bitpos >> 3;
+        uint32_t byte_offset = bitpos >> 3;
         if (byte_offset == end_offset) {
-            uint16_t x = pgm_read_byte_near(data + byte_offset);
+            uint16_t x = byteAt(byte_offset);
             i = (uint8_t)(x >> (8 - ((bitpos & 7) + len))) & ((1 << len) - 1);
         } else {
-            uint16_t x = ((uint16_t)pgm_read_byte_near(data + byte_offset) << 8) + pgm_read_byte_near(data + end_offset);
+            uint16_t x = (uint16_t)byteAt(byte_offset) << 8;
+            x += byteAt(end_offset);
             i = (uint8_t)(x >> (16 - ((bitpos & 7) + len))) & ((1 << len) - 1);
         }
         bitpos += len;
@@ -28,7 +28,6 @@
 class PixelsAntialiased : public PixelsBase {
 protected:
     virtual void drawCircleAntialiaced(int16_t x, int16_t y, int16_t radius, boolean bordermode);
-    virtual void drawFatLineAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
     virtual void drawLineAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
     virtual void drawRoundRectangleAntialiased(int16_t x, int16_t y, int16_t width, int16_t height, int16_t rx, int16_t ry, boolean bordermode);
 
@@ -88,60 +87,6 @@ void PixelsAntialiased::drawLineAntialiased(int16_t x1, int16_t y1, int16_t x2,
     }
 }
 
-void PixelsAntialiased::drawFatLineAntialiased(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
-#ifdef ENABLE_FAT_LINES
-// the code still needs to be completed. Problems by line caps
-
-    double wd = lineWidth;
-
-    int16_t dx = abs(x2 - x1);
-    int16_t sx = x1 < x2 ? 1 : -1;
-    int16_t dy = abs(y2 - y1);
-    int16_t sy = y1 < y2 ? 1 : -1;
-    int16_t err = dx - dy;
-
-    int16_t e2;
-    int16_t x;
-    int16_t y;
-
-    double ed = dx + dy == 0 ? 1 : sqrt((double) dx * dx + (double) dy * dy);
-
-    wd = (wd + 1) / 2;
-    while ( true ) {
-        putColor(x1, y1, false, 1 - max(0, abs(err-dx+dy)/ed - wd + 1));
-        e2 = err;
-        x = x1;
-        boolean out = false;
-        if (2 * e2 >= -dx) { /* x step */
-            for (e2 += dy, y = y1; e2 < ed * wd && (y2 != y || dx > dy); e2 += dx) {
-                putColor(x1, y += sy, false, 1 - max(0, abs(e2)/ed - wd + 1));
-            }
-            if (x1 == x2) {
-                out = true;
-            }
-            e2 = err;
-            err -= dy;
-            x1 += sx;
-        }
-        if (2 * e2 <= dy) { /* y step */
-            for (e2 = dx - e2; e2 < ed * wd && (x2 != x || dx < dy); e2 += dy) {
-                putColor(x += sx, y1, false, 1 - max(0, abs(e2)/ed - wd + 1));
-            }
-            if (y1 == y2) {
-                out = true;
-            }
-            err += dx;
-            y1 += sy;
-        }
-        if ( out ) {
-            break;
-        }
-    }
-#else
-    drawLineAntialiased(x1, y1, x2, y2);
-#endif
-}
-
 void PixelsAntialiased::drawRoundRectangleAntialiased(int16_t x, int16_t y, int16_t width, int16_t height, int16_t rx, int16_t ry, boolean bordermode) {
 
     int16_t i;
@@ -20,22 +20,30 @@
 
 #include "Pixels.h"
 
+#ifndef PIXELS_BUS
+#error Include a Pixels_<BUS>.h header before Pixels_<CONTROLLER>.h
+#endif
+
 #ifndef PIXELS_HX8340_H
 #define PIXELS_HX8340_H
 #define PIXELS_MAIN
 
+#if defined(PIXELS_CLASS)
+#define Pixels PIXELS_CLASS
+#endif
+
 #if defined(PIXELS_ANTIALIASING_H)
 #define PixelsBase PixelsAntialiased
 #endif
 
 class Pixels : public PixelsBase
-#if defined(PIXELS_SPISW_H)
+#if PIXELS_BUS == PIXELS_BUS_SPISW
                                     , public SPIsw
-#elif defined(PIXELS_SPIHW_H)
+#elif PIXELS_BUS == PIXELS_BUS_SPIHW
                                     , public SPIhw
-#elif defined(PIXELS_PPI8_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI8
                                     , public PPI8
-#elif defined(PIXELS_PPI16_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI16
                                     , public PPI16
 #endif
 {
@@ -243,4 +251,7 @@ void Pixels::deviceWriteData(uint8_t high, uint8_t low) {
     writeData(high);
     writeData(low);
 }
+#if defined(PIXELS_CLASS)
+#undef Pixels
+#endif
 #endif
@@ -20,23 +20,31 @@
 
 #include "Pixels.h"
 
+#ifndef PIXELS_BUS
+#error Include a Pixels_<BUS>.h header before Pixels_<CONTROLLER>.h
+#endif
+
 #ifndef PIXELS_HX8352_H
 #define PIXELS_HX8352_H
 #define PIXELS_MAIN
 
+#if defined(PIXELS_CLASS)
+#define Pixels PIXELS_CLASS
+#endif
+
 #if defined(PIXELS_ANTIALIASING_H)
 #define PixelsBase PixelsAntialiased
 #endif
 
 class Pixels : public PixelsBase
 
-#if defined(PIXELS_SPISW_H)
+#if PIXELS_BUS == PIXELS_BUS_SPISW
                                     , public SPIsw
-#elif defined(PIXELS_SPIHW_H)
+#elif PIXELS_BUS == PIXELS_BUS_SPIHW
                                     , public SPIhw
-#elif defined(PIXELS_PPI8_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI8
                                     , public PPI8
-#elif defined(PIXELS_PPI16_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI16
                                     , public PPI16
 #endif
 {
@@ -48,6 +56,7 @@ protected:
     void setFillDirection(uint8_t direction);
 
     void scrollCmd();
+    boolean scrollAreaCmd();
 
 public:
     Pixels() : PixelsBase(240, 400) {
@@ -232,9 +241,25 @@ void Pixels::init() {
     chipDeselect();
 }
 
+boolean Pixels::scrollAreaCmd() {
+    int16_t band = scrollBand();
+    writeCmd(0x0E);
+    writeData(highByte(scrollTop));
+    writeCmd(0x0F);
+    writeData(lowByte(scrollTop));
+    writeCmd(0x10);
+    writeData(highByte(band));
+    writeCmd(0x11);
+    writeData(lowByte(band));
+    writeCmd(0x12);
+    writeData(highByte(scrollBottom));
+    writeCmd(0x13);
+    writeData(lowByte(scrollBottom));
+    return true;
+}
+
 void Pixels::scrollCmd() {
-    int16_t s = (orientation > 1 ? deviceHeight - currentScroll : currentScroll) % deviceHeight;
-//    int16_t s = (orientation < 2 ? deviceHeight - currentScroll : currentScroll) % deviceHeight;
+    int16_t s = scrollTop + deviceScroll();
 
     writeCmd(0x14);
     writeData(highByte(s));
@@ -306,4 +331,7 @@ int32_t Pixels::setRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
 void Pixels::deviceWriteData(uint8_t high, uint8_t low) {
     writeData(high, low);
 }
+#if defined(PIXELS_CLASS)
+#undef Pixels
+#endif
 #endif
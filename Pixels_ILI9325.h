@@ -23,27 +23,38 @@
 
 #include "Pixels.h"
 
+#ifndef PIXELS_BUS
+#error Include a Pixels_<BUS>.h header before Pixels_<CONTROLLER>.h
+#endif
+
 #ifndef PIXELS_ILI9325_H
 #define PIXELS_ILI9325_H
 #define PIXELS_MAIN
 
+#if defined(PIXELS_CLASS)
+#define Pixels PIXELS_CLASS
+#endif
+
 #if defined(PIXELS_ANTIALIASING_H)
 #define PixelsBase PixelsAntialiased
 #endif
 
 class Pixels : public PixelsBase
-#if defined(PIXELS_SPISW_H)
+#if PIXELS_BUS == PIXELS_BUS_SPISW
                             , public SPIsw
-#elif defined(PIXELS_SPIHW_H)
+#elif PIXELS_BUS == PIXELS_BUS_SPIHW
                             , public SPIhw
-#elif defined(PIXELS_PPI8_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI8
                             , public PPI8
-#elif defined(PIXELS_PPI16_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI16
                             , public PPI16
 #endif
 {
 protected:
     int32_t setRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+#if PIXELS_BUS == PIXELS_BUS_PPI16
+    int32_t readRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t* data);
+#endif
     void quickFill(int b, int16_t x1, int16_t y1, int16_t x2, int16_t y2);
     void setFillDirection(uint8_t direction);
 
@@ -251,4 +262,31 @@ int32_t Pixels::setRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
 
     return (int32_t)(bb.x2 - bb.x1 + 1) * (bb.y2 - bb.y1 + 1);
 }
+
+#if PIXELS_BUS == PIXELS_BUS_PPI16
+int32_t Pixels::readRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t* data) {
+
+    if ( !canReadData() ) {
+        return -1;
+    }
+
+    int32_t counter = setRegion(x1, y1, x2, y2);
+    if( counter == 0 ) {
+        return 0;
+    }
+
+    // setRegion() leaves R22h selected
+    beginRead();
+    readData(); // dummy read
+    for ( int32_t i = 0; i < counter; i++ ) {
+        data[i] = readData();
+    }
+
+    endRead();
+    return counter;
+}
+#endif
+#if defined(PIXELS_CLASS)
+#undef Pixels
+#endif
 #endif
@@ -22,22 +22,30 @@
 
 #include "Pixels.h"
 
+#ifndef PIXELS_BUS
+#error Include a Pixels_<BUS>.h header before Pixels_<CONTROLLER>.h
+#endif
+
 #ifndef PIXELS_ILI9341_H
 #define PIXELS_ILI9341_H
 #define PIXELS_MAIN
 
+#if defined(PIXELS_CLASS)
+#define Pixels PIXELS_CLASS
+#endif
+
 #if defined(PIXELS_ANTIALIASING_H)
 #define PixelsBase PixelsAntialiased
 #endif
 
 class Pixels : public PixelsBase
-#if defined(PIXELS_SPISW_H)
+#if PIXELS_BUS == PIXELS_BUS_SPISW
                                     , public SPIsw
-#elif defined(PIXELS_SPIHW_H)
+#elif PIXELS_BUS == PIXELS_BUS_SPIHW
                                     , public SPIhw
-#elif defined(PIXELS_PPI8_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI8
                                     , public PPI8
-#elif defined(PIXELS_PPI16_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI16
                                     , public PPI16
 #endif
 {
@@ -47,10 +55,14 @@ protected:
     }
 
     int32_t setRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+#if PIXELS_BUS == PIXELS_BUS_PPI16
+    int32_t readRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t* data);
+#endif
     void quickFill(int b, int16_t x1, int16_t y1, int16_t x2, int16_t y2);
     void setFillDirection(uint8_t direction);
 
     void scrollCmd();
+    boolean scrollAreaCmd();
 
 public:
     Pixels() : PixelsBase(240, 320) { // ElecFreaks TFT2.2SP shield as default
@@ -185,8 +197,20 @@ void Pixels::init() {
     chipDeselect();
 }
 
+boolean Pixels::scrollAreaCmd() {
+    int16_t band = scrollBand();
+    writeCmd(0x33);
+    writeData(highByte(scrollTop));
+    writeData(lowByte(scrollTop));
+    writeData(highByte(band));
+    writeData(lowByte(band));
+    writeData(highByte(scrollBottom));
+    writeData(lowByte(scrollBottom));
+    return true;
+}
+
 void Pixels::scrollCmd() {
-    int16_t s = (orientation > 1 ? deviceHeight - currentScroll : currentScroll) % deviceHeight;
+    int16_t s = scrollTop + deviceScroll();
     writeCmd(0x37);
     writeData(highByte(s));
     writeData(lowByte(s));
@@ -256,4 +280,39 @@ int32_t Pixels::setRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
 
     return (int32_t)(bb.x2 - bb.x1 + 1) * (bb.y2 - bb.y1 + 1);
 }
+
+#if PIXELS_BUS == PIXELS_BUS_PPI16
+int32_t Pixels::readRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t* data) {
+
+    if ( !canReadData() ) {
+        return -1;
+    }
+
+    int32_t counter = setRegion(x1, y1, x2, y2);
+    if( counter == 0 ) {
+        return 0;
+    }
+
+    writeCmd(0x2e);
+    beginRead();
+    readData(); // dummy read
+
+    // RGB565 pixels are read as 8 bit color components, two pixels per three bus cycles
+    for ( int32_t i = 0; i < counter; i += 2 ) {
+        uint16_t rg = readData();
+        uint16_t br = readData();
+        data[i] = ((rg >> 11) << 11) | (((rg & 0xFF) >> 2) << 5) | (br >> 11);
+        if ( i + 1 < counter ) {
+            uint16_t gb = readData();
+            data[i + 1] = (((br & 0xFF) >> 3) << 11) | ((gb >> 10) << 5) | ((gb & 0xFF) >> 3);
+        }
+    }
+
+    endRead();
+    return counter;
+}
+#endif
+#if defined(PIXELS_CLASS)
+#undef Pixels
+#endif
 #endif
@@ -22,27 +22,27 @@
 
 #include "Pixels.h"
 
-#ifdef PIXELS_MAIN
-#error Pixels_PPI16.h must be included before Pixels_<CONTROLLER>.h
-#endif
-
 #ifndef PIXELS_PPI16_H
 #define PIXELS_PPI16_H
 
 #if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
 #define DATAPORTH PORTA // 22-29
 #define DATAPORTL PORTC // 30-37
+#define DATAPINH PINA
+#define DATAPINL PINC
 #define DATADIRH DDRA
 #define DATADIRL DDRC
 #else
 // shortage of pins for non-Mega boards
 #define DATAPORTH PORTD // 0-7
 #define DATAPORTL PORTB // 8-13
+#define DATAPINH PIND
+#define DATAPINL PINB
 #define DATADIRH DDRD
 #define DATADIRL DDRB
 #endif
 
-class PPI16 {
+class PPI16 : public virtual ChipSelect {
 private:
     regtype *registerRD;
     regtype *registerWR;
@@ -114,6 +114,33 @@ protected:
         writeBus(b, b);
     }
 
+    void beginRead() {
+        REG_PIOA_ODR = 0x0000c080;
+        REG_PIOB_ODR = 0x04000000;
+        REG_PIOC_ODR = 0x0000003e;
+        REG_PIOD_ODR = 0x0000064f;
+        sbi(registerRS, bitmaskRS);
+    }
+
+    // inverse of the writeBus() pin mapping
+    uint16_t readData() {
+        cbi(registerRD, bitmaskRD);
+        delayMicroseconds(1);
+        uint32_t a = REG_PIOA_PDSR;
+        uint32_t b = REG_PIOB_PDSR;
+        uint32_t c = REG_PIOC_PDSR;
+        uint32_t d = REG_PIOD_PDSR;
+        sbi(registerRD, bitmaskRD);
+        uint8_t hi = ((a >> 13) & 0x06) | ((b >> 26) & 0x01) | ((d << 3) & 0x78) | ((d << 1) & 0x80);
+        uint8_t lo = ((c >> 5) & 0x01) | ((c >> 3) & 0x02) | ((c >> 1) & 0x04) | ((c << 1) & 0x08)
+                | ((c << 3) & 0x10) | ((d >> 5) & 0x20) | ((a >> 1) & 0x40) | ((d >> 2) & 0x80);
+        return (hi << 8) | lo;
+    }
+
+    void endRead() {
+        setDirectionRegisters();
+    }
+
 #else
 
     void writeCmd(uint8_t b) {
@@ -136,6 +163,25 @@ protected:
         DATAPORTH = b; DATAPORTL = b; pulse_low(registerWR, bitmaskWR);
     }
 
+    void beginRead() {
+        DATADIRH = 0x00;
+        DATADIRL = 0x00;
+        sbi(registerRS, bitmaskRS);
+    }
+
+    uint16_t readData() {
+        cbi(registerRD, bitmaskRD);
+        delayMicroseconds(1);
+        uint16_t data = (DATAPINH << 8) | DATAPINL;
+        sbi(registerRD, bitmaskRD);
+        return data;
+    }
+
+    void endRead() {
+        DATADIRH = 0xFF;
+        DATADIRL = 0xFF;
+    }
+
 #endif
 
     void writeCmdData(uint8_t cmd, uint16_t data) {
@@ -143,6 +189,14 @@ protected:
         writeData(highByte(data), lowByte(data));
     }
 
+    /*
+     * Video RAM read back needs the RD pin to be assigned with setPpiPins(). A read sequence is
+     * beginRead(), readData() calls and endRead(), which turns the data bus back to output.
+     */
+    inline boolean canReadData() {
+        return pinRD > 0;
+    }
+
 public:
     /**
      * Overrides SPI pins
@@ -196,6 +250,8 @@ void PPI16::initInterface() {
     bitmaskRST	= digitalPinToBitMask(pinRST);
     if ( pinRD > 0 ) {
         bitmaskRD	= digitalPinToBitMask(pinRD);
+        pinMode(pinRD,OUTPUT);
+        sbi(registerRD, bitmaskRD);
     }
 
     pinMode(pinRS,OUTPUT);
@@ -210,3 +266,7 @@ void PPI16::initInterface() {
     reset();
 }
 #endif
+
+// the next included Pixels_<CONTROLLER>.h uses this bus
+#undef PIXELS_BUS
+#define PIXELS_BUS PIXELS_BUS_PPI16
@@ -20,10 +20,6 @@
 
 #include "Pixels.h"
 
-#ifdef PIXELS_MAIN
-#error Pixels_PPI8.h must be included before Pixels_<CONTROLLER>.h
-#endif
-
 #ifndef PIXELS_PPI8_H
 #define PIXELS_PPI8_H
 
@@ -35,7 +31,7 @@
 #define DATADIR DDRD
 #endif
 
-class PPI8 {
+class PPI8 : public virtual ChipSelect {
 private:
     regtype *registerRD;
     regtype *registerWR;
@@ -147,3 +143,7 @@ void PPI8::initInterface() {
     reset();
 }
 #endif
+
+// the next included Pixels_<CONTROLLER>.h uses this bus
+#undef PIXELS_BUS
+#define PIXELS_BUS PIXELS_BUS_PPI8
@@ -0,0 +1,59 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2013  Igor Repinetski
+ *
+ * The code is written in C/C++ for Arduino and can be easily ported to any microcontroller by rewritting the low level pin access functions.
+ *
+ * Text output methods of the library rely on Pixelmeister's font data format. See: http://pd4ml.com/pixelmeister
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ *
+ * This library includes some code portions and algoritmic ideas derived from works of
+ * - Andreas Schiffler -- aschiffler at ferzkopp dot net (SDL_gfx Project)
+ * - K. Townsend http://microBuilder.eu (lpc1343codebase Project)
+ */
+
+/*
+ * POSIX file byte reader for PixelsBase::loadBitmap(), for ports running on top of an operating system
+ * (Linux framebuffer, host side simulation etc)
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include "Pixels.h"
+
+#ifndef PIXELS_POSIX_H
+#define PIXELS_POSIX_H
+
+class PosixReader : public ByteReader {
+private:
+    int fd;
+
+public:
+    PosixReader() {
+        fd = -1;
+    }
+
+    boolean open(String path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        return fd >= 0;
+    }
+
+    int16_t read(uint8_t* buffer, int16_t length) {
+        if ( fd < 0 ) {
+            return 0;
+        }
+        ssize_t len = ::read(fd, buffer, length);
+        return len < 0 ? 0 : (int16_t)len;
+    }
+
+    void close() {
+        if ( fd >= 0 ) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,271 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2013  Igor Repinetski
+ *
+ * The code is written in C/C++ for Arduino and can be easily ported to any microcontroller by rewritting the low level pin access functions.
+ *
+ * Text output methods of the library rely on Pixelmeister's font data format. See: http://pd4ml.com/pixelmeister
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ *
+ * This library includes some code portions and algoritmic ideas derived from works of
+ * - Andreas Schiffler -- aschiffler at ferzkopp dot net (SDL_gfx Project)
+ * - K. Townsend http://microBuilder.eu (lpc1343codebase Project)
+ */
+
+/*
+ * Progress bar (bar graph): remembers the drawn level, so a value change fills or clears only the
+ * span between the old and the new level. A change in either direction is a single window write:
+ * one fill by a solid bar, one raster output of the changed segments by a segmented ("LED") bar.
+ *
+ *   ProgressBar bar(&pxs, 10, 100, 200, 12, 0, 100);
+ *   bar.setColors(0x07E0, 0x2104);
+ *   bar.setSegments(8, 2);
+ *   bar.draw();
+ *   ...
+ *   bar.setValue(percent);
+ *
+ * Gaps between segments get the display background color.
+ */
+
+#include "Pixels.h"
+
+#ifndef PIXELS_PROGRESSBAR_H
+#define PIXELS_PROGRESSBAR_H
+
+/* directions, in which the bar grows */
+#define BAR_LEFT_TO_RIGHT 0
+#define BAR_RIGHT_TO_LEFT 1
+#define BAR_BOTTOM_TO_TOP 2
+#define BAR_TOP_TO_BOTTOM 3
+
+class ProgressBar : public Raster {
+private:
+    PixelsBase* pixels;
+
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    int16_t height;
+    int16_t minValue;
+    int16_t maxValue;
+    uint8_t direction;
+
+    uint16_t color;
+    uint16_t trackColor;
+    uint16_t gapColor;
+    int16_t segment; // segment length in pixels; 0 for a solid bar
+    int16_t gap;
+
+    int16_t value;
+    int16_t level; // drawn length in pixels; -1 if not drawn yet
+
+    /* the part along the bar output by drawRaster() */
+    int16_t rasterFrom;
+    int16_t rasterTo;
+
+    int16_t length() {
+        return direction < BAR_BOTTOM_TO_TOP ? width : height;
+    }
+    int16_t toLevel(int16_t val);
+    void drawSpan(int16_t from, int16_t to);
+
+public:
+    /**
+     * @param pxs the display to draw on
+     * @param x the bar left edge
+     * @param y the bar top edge
+     * @param width the bar width
+     * @param height the bar height
+     * @param minVal the value of an empty bar
+     * @param maxVal the value of a full bar
+     * @param dir BAR_LEFT_TO_RIGHT, BAR_RIGHT_TO_LEFT, BAR_BOTTOM_TO_TOP or BAR_TOP_TO_BOTTOM
+     */
+    ProgressBar(PixelsBase* pxs, int16_t x, int16_t y, int16_t width, int16_t height, int16_t minVal, int16_t maxVal, uint8_t dir = BAR_LEFT_TO_RIGHT);
+
+    /**
+     * Sets the bar colors; draw() applies them to the whole bar.
+     * @param fill color of the filled part in RGB565 format
+     * @param track color of the empty part in RGB565 format
+     */
+    void setColors(uint16_t fill, uint16_t track) {
+        color = fill;
+        trackColor = track;
+    }
+
+    /**
+     * Splits the bar into segments, which are lit or dimmed as a whole: the level is rounded
+     * down to whole segments. draw() applies the change to the whole bar.
+     * @param size segment length along the bar in pixels; 0 for a solid bar
+     * @param gapSize distance between segments in pixels
+     */
+    void setSegments(int16_t size, int16_t gapSize) {
+        segment = size > 0 ? size : 0;
+        gap = gapSize > 0 ? gapSize : 0;
+    }
+
+    /**
+     * Draws the whole bar at the current value.
+     */
+    void draw();
+
+    /**
+     * Changes the value. Only the difference to the drawn level is output; nothing if the level
+     * does not change. The first call draws the whole bar.
+     * @param val new value, limited to the bar range
+     */
+    void setValue(int16_t val);
+
+    int16_t getValue() {
+        return value;
+    }
+
+    uint16_t getPixel(int16_t u, int16_t v);
+};
+
+ProgressBar::ProgressBar(PixelsBase* pxs, int16_t xx, int16_t yy, int16_t w, int16_t h, int16_t minVal, int16_t maxVal, uint8_t dir) {
+    pixels = pxs;
+    x = xx;
+    y = yy;
+    width = w;
+    height = h;
+    minValue = minVal;
+    maxValue = maxVal > minVal ? maxVal : minVal + 1;
+    direction = dir;
+
+    color = 0xFFFF;
+    trackColor = 0;
+    gapColor = 0;
+    segment = 0;
+    gap = 0;
+
+    value = minValue;
+    level = -1;
+    rasterFrom = 0;
+    rasterTo = 0;
+}
+
+int16_t ProgressBar::toLevel(int16_t val) {
+    int32_t range = (int32_t)maxValue - minValue;
+    int32_t v = (int32_t)val - minValue;
+    if ( segment == 0 ) {
+        return v * length() / range;
+    }
+    int16_t pitch = segment + gap;
+    int16_t count = (length() + gap) / pitch;
+    return (int16_t)(v * count / range) * pitch;
+}
+
+/*
+ * Outputs the pixels from..to along the bar as one window: a fill if the span has a single color,
+ * a raster of segments and gaps otherwise
+ */
+void ProgressBar::drawSpan(int16_t from, int16_t to) {
+    int16_t x1;
+    int16_t y1;
+    int16_t x2;
+    int16_t y2;
+    switch ( direction ) {
+    case BAR_RIGHT_TO_LEFT:
+        x1 = x + width - 1 - to;
+        x2 = x + width - 1 - from;
+        y1 = y;
+        y2 = y + height - 1;
+        break;
+    case BAR_BOTTOM_TO_TOP:
+        x1 = x;
+        x2 = x + width - 1;
+        y1 = y + height - 1 - to;
+        y2 = y + height - 1 - from;
+        break;
+    case BAR_TOP_TO_BOTTOM:
+        x1 = x;
+        x2 = x + width - 1;
+        y1 = y + from;
+        y2 = y + to;
+        break;
+    default:
+        x1 = x + from;
+        x2 = x + to;
+        y1 = y;
+        y2 = y + height - 1;
+    }
+
+    int16_t pitch = segment + gap;
+    boolean solid = segment == 0 || (from / pitch == to / pitch && to % pitch < segment);
+    boolean lit = from < level;
+    if ( solid && lit == (to < level) ) {
+        RGB c;
+        c = c.convert565toRGB(lit ? color : trackColor);
+        RGB* fg = pixels->getColor();
+        pixels->setColor(&c);
+        pixels->fillRectangle(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+        pixels->setColor(fg);
+    } else {
+        rasterFrom = from;
+        rasterTo = to;
+        pixels->drawRaster(x1, y1, x2 - x1 + 1, y2 - y1 + 1, this);
+    }
+}
+
+uint16_t ProgressBar::getPixel(int16_t u, int16_t v) {
+    int16_t p;
+    switch ( direction ) {
+    case BAR_RIGHT_TO_LEFT:
+        p = rasterTo - u;
+        break;
+    case BAR_BOTTOM_TO_TOP:
+        p = rasterTo - v;
+        break;
+    case BAR_TOP_TO_BOTTOM:
+        p = rasterFrom + v;
+        break;
+    default:
+        p = rasterFrom + u;
+    }
+    if ( segment > 0 ) {
+        // gaps and the rest after the last whole segment
+        int16_t pitch = segment + gap;
+        if ( p % pitch >= segment || p >= (length() + gap) / pitch * pitch - gap ) {
+            return gapColor;
+        }
+    }
+    return p < level ? color : trackColor;
+}
+
+void ProgressBar::draw() {
+    level = toLevel(value);
+    gapColor = pixels->getBackground()->convertTo565();
+    drawSpan(0, length() - 1);
+}
+
+void ProgressBar::setValue(int16_t val) {
+    if ( val < minValue ) {
+        val = minValue;
+    } else if ( val > maxValue ) {
+        val = maxValue;
+    }
+    value = val;
+
+    if ( level < 0 ) {
+        draw();
+        return;
+    }
+
+    int16_t newLevel = toLevel(val);
+    if ( newLevel == level ) {
+        return;
+    }
+
+    int16_t from = min(level, newLevel);
+    int16_t to = max(level, newLevel) - 1;
+    if ( segment > 0 ) {
+        // the span ends with a segment, not with the gap after it
+        to -= gap;
+    }
+    level = newLevel;
+    drawSpan(from, to);
+}
+
+#endif
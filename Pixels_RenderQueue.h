@@ -0,0 +1,390 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2013  Igor Repinetski
+ *
+ * The code is written in C/C++ for Arduino and can be easily ported to any microcontroller by rewritting the low level pin access functions.
+ *
+ * Text output methods of the library rely on Pixelmeister's font data format. See: http://pd4ml.com/pixelmeister
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ *
+ * This library includes some code portions and algoritmic ideas derived from works of
+ * - Andreas Schiffler -- aschiffler at ferzkopp dot net (SDL_gfx Project)
+ * - K. Townsend http://microBuilder.eu (lpc1343codebase Project)
+ */
+
+/*
+ * Render queue: a lock-free single producer, single consumer ring of drawing commands. PixelsBase
+ * is not reentrant, so an interrupt handler (or a task on another core) must not draw directly.
+ * It posts commands to the queue instead, which never blocks, and the code owning the display
+ * executes them with drain().
+ *
+ *   RenderQueue queue(&pxs);
+ *
+ *   ISR(TIMER1_COMPA_vect) {                   // producer
+ *       queue.begin(TEMPERATURE_WIDGET);
+ *       queue.fill(10, 10, 60, 16, 0x0000);
+ *       queue.print(10, 24, text, font, 0xFFE0);
+ *       queue.commit();
+ *   }
+ *
+ *   void loop() {                              // consumer
+ *       queue.drain();
+ *   }
+ *
+ * Commands posted between begin() and commit() form an update of a widget region, which becomes
+ * visible to drain() as a whole. An update supersedes the earlier queued updates of the same region,
+ * so drain() skips them: a slow consumer draws only the latest state of a widget. Text is copied to
+ * the queue, bitmap, icon and font data are referenced and have to stay valid.
+ *
+ * Every producer needs its own queue. The consumer has to be the only code drawing on the display
+ * while drain() runs.
+ */
+
+#include "Pixels.h"
+
+#ifndef PIXELS_RENDERQUEUE_H
+#define PIXELS_RENDERQUEUE_H
+
+#ifndef RENDER_QUEUE_SIZE
+#define RENDER_QUEUE_SIZE 8 // number of command slots, a power of 2
+#endif
+
+#ifndef RENDER_QUEUE_TEXT
+#define RENDER_QUEUE_TEXT 12 // max text length of a command, including the terminating zero
+#endif
+
+#if RENDER_QUEUE_SIZE > 128 || (RENDER_QUEUE_SIZE & (RENDER_QUEUE_SIZE - 1)) != 0
+#error RENDER_QUEUE_SIZE should be a power of 2 not exceeding 128
+#endif
+
+/* orders the slot writes and the index update for the other side; a compiler barrier is enough on single core AVR */
+#ifndef RENDER_QUEUE_BARRIER
+#if defined(__AVR__)
+#define RENDER_QUEUE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define RENDER_QUEUE_BARRIER() __sync_synchronize()
+#endif
+#endif
+
+#define QUEUE_FILL 1
+#define QUEUE_TEXT 2
+#define QUEUE_BITMAP 3
+#define QUEUE_ICON 4
+
+#define NO_REGION 0
+
+class RenderQueue {
+private:
+    class Command {
+    public:
+        uint8_t op;
+        uint8_t region;
+        boolean first; // the first command of an update
+        boolean filled; // text background is filled
+        int16_t x;
+        int16_t y;
+        int16_t width;
+        int16_t height;
+        uint16_t color;
+        uint16_t background;
+        const void* data;
+        char text[RENDER_QUEUE_TEXT];
+    };
+
+    PixelsBase* pixels;
+    Command commands[RENDER_QUEUE_SIZE];
+
+    /* free running positions, (head - tail) is the number of committed commands */
+    volatile uint8_t head; // written by the producer only
+    volatile uint8_t tail; // written by the consumer only
+
+    /* producer side */
+    uint8_t writePos;
+    uint8_t region;
+    boolean inUpdate;
+    boolean overflow;
+    uint16_t dropped;
+
+    Command* add(uint8_t op, int16_t x, int16_t y);
+    boolean superseded(uint8_t pos, uint8_t end);
+    void execute(Command& c);
+
+public:
+    /**
+     * @param pxs the display, the commands are drawn on
+     */
+    RenderQueue(PixelsBase* pxs);
+
+    /**
+     * Starts an update: the subsequent commands are not visible to drain() until commit().
+     * Called by the producer.
+     * @param rgn widget region identifier; an update supersedes the queued updates of the same region.
+     * NO_REGION updates are never skipped.
+     */
+    void begin(uint8_t rgn = NO_REGION);
+    /**
+     * Publishes the update. If any of its commands did not fit the queue, the whole update is dropped.
+     * Called by the producer.
+     * @return <i>false</i> if the update is dropped
+     */
+    boolean commit();
+
+    /**
+     * Queues a rectangle fill. Outside of begin()/commit() a command is published at once as a NO_REGION update.
+     * @param color fill color in RGB565 format
+     * @return <i>false</i> if the queue is full
+     */
+    boolean fill(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color);
+    /**
+     * Queues a text output with a transparent background. The text is truncated to RENDER_QUEUE_TEXT - 1 characters.
+     * @param x the baseline <i>x</i> coordinate
+     * @param y the baseline <i>y</i> coordinate
+     * @param text the text, copied to the queue
+     * @param font Pixelmeister font
+     * @param color text color in RGB565 format
+     * @return <i>false</i> if the queue is full
+     */
+    boolean print(int16_t x, int16_t y, const char* text, prog_uchar* font, uint16_t color);
+    /**
+     * Queues a text output, which fills the glyph backgrounds.
+     * @param background background color in RGB565 format
+     * @return <i>false</i> if the queue is full
+     * @see print(int16_t,int16_t,const char*,prog_uchar*,uint16_t)
+     */
+    boolean print(int16_t x, int16_t y, const char* text, prog_uchar* font, uint16_t color, uint16_t background);
+    /**
+     * Queues a bitmap output
+     * @param data RGB565 bitmap, referenced
+     * @return <i>false</i> if the queue is full
+     */
+    boolean drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data);
+    /**
+     * Queues an icon output
+     * @param data Pixelmeister icon, referenced
+     * @param color icon color in RGB565 format
+     * @return <i>false</i> if the queue is full
+     */
+    boolean drawIcon(int16_t x, int16_t y, prog_uchar* data, uint16_t color);
+
+    /**
+     * Gets the number of updates dropped because the queue was full
+     */
+    uint16_t getDropped() {
+        return dropped;
+    }
+
+    /**
+     * Draws the committed updates, skipping the superseded ones. The updates committed meanwhile
+     * are left for the next call. Called by the display owner. The display colors, font and print mode
+     * are restored afterwards.
+     * @return number of commands drawn
+     */
+    uint8_t drain();
+};
+
+RenderQueue::RenderQueue(PixelsBase* pxs) {
+    pixels = pxs;
+    head = 0;
+    tail = 0;
+    writePos = 0;
+    region = NO_REGION;
+    inUpdate = false;
+    overflow = false;
+    dropped = 0;
+}
+
+void RenderQueue::begin(uint8_t rgn) {
+    writePos = head;
+    region = rgn;
+    inUpdate = true;
+    overflow = false;
+}
+
+boolean RenderQueue::commit() {
+    inUpdate = false;
+    if ( overflow || writePos == head ) {
+        if ( overflow ) {
+            dropped++;
+        }
+        writePos = head;
+        return !overflow;
+    }
+    // the commands have to be in memory before the consumer sees them
+    RENDER_QUEUE_BARRIER();
+    head = writePos;
+    return true;
+}
+
+RenderQueue::Command* RenderQueue::add(uint8_t op, int16_t x, int16_t y) {
+    if ( !inUpdate ) {
+        begin(NO_REGION);
+        inUpdate = false;
+    }
+    if ( overflow ) {
+        return NULL;
+    }
+    if ( (uint8_t)(writePos - tail) >= RENDER_QUEUE_SIZE ) {
+        overflow = true;
+        if ( !inUpdate ) {
+            dropped++;
+        }
+        return NULL;
+    }
+
+    Command* c = &commands[writePos & (RENDER_QUEUE_SIZE - 1)];
+    c->op = op;
+    c->region = region;
+    c->first = writePos == head;
+    c->filled = false;
+    c->x = x;
+    c->y = y;
+    writePos++;
+    return c;
+}
+
+boolean RenderQueue::fill(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t color) {
+    Command* c = add(QUEUE_FILL, x, y);
+    if ( c == NULL ) {
+        return false;
+    }
+    c->width = width;
+    c->height = height;
+    c->color = color;
+    return inUpdate || commit();
+}
+
+boolean RenderQueue::print(int16_t x, int16_t y, const char* text, prog_uchar* font, uint16_t color) {
+    Command* c = add(QUEUE_TEXT, x, y);
+    if ( c == NULL ) {
+        return false;
+    }
+    c->data = font;
+    c->color = color;
+    uint8_t i = 0;
+    for ( ; i < RENDER_QUEUE_TEXT - 1 && text[i] != 0; i++ ) {
+        c->text[i] = text[i];
+    }
+    c->text[i] = 0;
+    return inUpdate || commit();
+}
+
+boolean RenderQueue::print(int16_t x, int16_t y, const char* text, prog_uchar* font, uint16_t color, uint16_t background) {
+    boolean update = inUpdate;
+    if ( !update ) {
+        begin(NO_REGION);
+    }
+    if ( print(x, y, text, font, color) ) {
+        Command& c = commands[(uint8_t)(writePos - 1) & (RENDER_QUEUE_SIZE - 1)];
+        c.filled = true;
+        c.background = background;
+    }
+    return update || commit();
+}
+
+boolean RenderQueue::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data) {
+    Command* c = add(QUEUE_BITMAP, x, y);
+    if ( c == NULL ) {
+        return false;
+    }
+    c->width = width;
+    c->height = height;
+    c->data = data;
+    return inUpdate || commit();
+}
+
+boolean RenderQueue::drawIcon(int16_t x, int16_t y, prog_uchar* data, uint16_t color) {
+    Command* c = add(QUEUE_ICON, x, y);
+    if ( c == NULL ) {
+        return false;
+    }
+    c->data = data;
+    c->color = color;
+    return inUpdate || commit();
+}
+
+/*
+ * Checks if a later update in [pos, end) refers the same region as the update started at pos
+ */
+boolean RenderQueue::superseded(uint8_t pos, uint8_t end) {
+    uint8_t rgn = commands[pos & (RENDER_QUEUE_SIZE - 1)].region;
+    if ( rgn == NO_REGION ) {
+        return false;
+    }
+    for ( uint8_t p = pos + 1; p != end; p++ ) {
+        Command& c = commands[p & (RENDER_QUEUE_SIZE - 1)];
+        if ( c.first && c.region == rgn ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderQueue::execute(Command& c) {
+    RGB color;
+    color = color.convert565toRGB(c.color);
+    pixels->setColor(&color);
+
+    switch ( c.op ) {
+    case QUEUE_FILL:
+        pixels->fillRectangle(c.x, c.y, c.width, c.height);
+        break;
+    case QUEUE_TEXT: {
+        RGB background;
+        if ( c.filled ) {
+            background = background.convert565toRGB(c.background);
+            pixels->setBackground(&background);
+        }
+        pixels->setPrintMode(c.filled ? FILL_TEXT_BACKGROUND : TRANSPARENT_TEXT_BACKGROUND);
+        if ( pixels->setFont((prog_uchar*)c.data) == 0 ) {
+            pixels->print(c.x, c.y, c.text);
+        }
+        break;
+    }
+    case QUEUE_BITMAP:
+        pixels->drawBitmap(c.x, c.y, c.width, c.height, (prog_uint16_t*)c.data);
+        break;
+    case QUEUE_ICON:
+        pixels->drawIcon(c.x, c.y, (prog_uchar*)c.data);
+        break;
+    }
+}
+
+uint8_t RenderQueue::drain() {
+    uint8_t end = head;
+    // the commands are read after the position, which published them
+    RENDER_QUEUE_BARRIER();
+
+    RGB* fg = pixels->getColor();
+    RGB* bg = pixels->getBackground();
+    prog_uchar* font = pixels->getFont();
+    int8_t printMode = pixels->getPrintMode();
+
+    uint8_t drawn = 0;
+    uint8_t pos = tail;
+    boolean skip = false;
+    while ( pos != end ) {
+        Command& c = commands[pos & (RENDER_QUEUE_SIZE - 1)];
+        if ( c.first ) {
+            skip = superseded(pos, end);
+        }
+        if ( !skip ) {
+            execute(c);
+            drawn++;
+        }
+        pos++;
+    }
+
+    pixels->setColor(fg);
+    pixels->setBackground(bg);
+    pixels->setFont(font);
+    pixels->setPrintMode(printMode);
+
+    // the slots are released after they are read
+    RENDER_QUEUE_BARRIER();
+    tail = end;
+    return drawn;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2013  Igor Repinetski
+ *
+ * The code is written in C/C++ for Arduino and can be easily ported to any microcontroller by rewritting the low level pin access functions.
+ *
+ * Text output methods of the library rely on Pixelmeister's font data format. See: http://pd4ml.com/pixelmeister
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ *
+ * This library includes some code portions and algoritmic ideas derived from works of
+ * - Andreas Schiffler -- aschiffler at ferzkopp dot net (SDL_gfx Project)
+ * - K. Townsend http://microBuilder.eu (lpc1343codebase Project)
+ */
+
+/*
+ * SD card byte reader for PixelsBase::loadBitmap(). Relies on the standard Arduino SD library,
+ * which is expected to be initialized with SD.begin() by the sketch:
+ *
+ *   SDReader reader;
+ *   pxs.setByteReader(&reader);
+ *   pxs.loadBitmap(0, 0, 0, 0, "logo.bmp");
+ */
+
+#include <SD.h>
+#include "Pixels.h"
+
+#ifndef PIXELS_SD_H
+#define PIXELS_SD_H
+
+class SDReader : public ByteReader {
+private:
+    File file;
+
+public:
+    boolean open(String path) {
+        file = SD.open(path.c_str());
+        return file;
+    }
+
+    int16_t read(uint8_t* buffer, int16_t length) {
+        int16_t len = file.read(buffer, length);
+        return len < 0 ? 0 : len;
+    }
+
+    void close() {
+        file.close();
+    }
+};
+
+#endif
@@ -20,10 +20,6 @@
 
 #include "Pixels.h"
 
-#ifdef PIXELS_MAIN
-#error Pixels_SPIhw.h must be included before Pixels_<CONTROLLER>.h
-#endif
-
 #ifndef PIXELS_SPIHW_H
 #define PIXELS_SPIHW_H
 
@@ -32,7 +28,7 @@
 //#undef chipDeselect
 //#define chipDeselect()
 
-class SPIhw {
+class SPIhw : public virtual ChipSelect {
 private:
     uint8_t pinSCL;
     uint8_t pinSDA;
@@ -282,3 +278,7 @@ void SPIhw::setSPIClockDivider(uint8_t rate) {
 }
 
 #endif // PIXELS_SPIHW_H
+
+// the next included Pixels_<CONTROLLER>.h uses this bus
+#undef PIXELS_BUS
+#define PIXELS_BUS PIXELS_BUS_SPIHW
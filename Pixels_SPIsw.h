@@ -20,16 +20,10 @@
 
 #include "Pixels.h"
 
-#ifdef PIXELS_MAIN
-#error Pixels_SPIsw.h must be included before Pixels_<CONTROLLER>.h
-#endif
-
 #ifndef PIXELS_SPISW_H
 #define PIXELS_SPISW_H
 
-bool eightBit = true;
-
-class SPIsw {
+class SPIsw : public virtual ChipSelect {
 private:
     uint8_t pinSCL;
     uint8_t pinSDA;
@@ -44,6 +38,8 @@ private:
     regsize bitmaskSDA;
     regsize bitmaskWR;
 
+    bool eightBit;
+
     void busWrite(uint8_t data);
 
 protected:
@@ -185,3 +181,7 @@ void SPIsw::writeData(uint8_t data) {
 #endif
 }
 #endif
+
+// the next included Pixels_<CONTROLLER>.h uses this bus
+#undef PIXELS_BUS
+#define PIXELS_BUS PIXELS_BUS_SPISW
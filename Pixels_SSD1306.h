@@ -23,22 +23,30 @@
 
 #include "Pixels.h"
 
+#ifndef PIXELS_BUS
+#error Include a Pixels_<BUS>.h header before Pixels_<CONTROLLER>.h
+#endif
+
 #ifndef PIXELS_SSD1306_H
 #define PIXELS_SSD1306_H
 #define PIXELS_MAIN
 
+#if defined(PIXELS_CLASS)
+#define Pixels PIXELS_CLASS
+#endif
+
 #if defined(PIXELS_ANTIALIASING_H)
 #define PixelsBase PixelsAntialiased
 #endif
 
 class Pixels : public PixelsBase
-#if defined(PIXELS_SPISW_H)
+#if PIXELS_BUS == PIXELS_BUS_SPISW
                                     , public SPIsw
-#elif defined(PIXELS_SPIHW_H)
+#elif PIXELS_BUS == PIXELS_BUS_SPIHW
                                     , public SPIhw
-#elif defined(PIXELS_PPI8_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI8
                                     , public PPI8
-#elif defined(PIXELS_PPI16_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI16
                                     , public PPI16
 #endif
 {
@@ -75,7 +83,6 @@ public:
     }
 
     void init();
-    int8_t drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data);
 };
 
 #if defined(PIXELS_ANTIALIASING_H)
@@ -212,12 +219,12 @@ void Pixels::deviceWriteData(uint8_t high, uint8_t low) {
         }
     }
 
-    my++;
-    if ( my > yy2 ) {
-        my = yy1;
-        mx++;
-        if ( mx > xx2 ) { // yy2 ?????????
-            mx--;
+    mx++;
+    if ( mx > xx2 ) {
+        mx = xx1;
+        my++;
+        if ( my > yy2 ) {
+            my--;
             return;
         }
     }
@@ -291,83 +298,6 @@ void Pixels::endGfxOperation(boolean force) {
     }
 }
 
-int8_t Pixels::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, prog_uint16_t* data) {
-
-    Bounds bb(x, y, x+width-1, y+height-1);
-    if( !transformBounds(bb) ) {
-        return 1;
-    }
-
-    if( !checkBounds(bb) ) {
-        return 1;
-    }
-
-    beginGfxOperation();
-    setRegion(bb.x1, bb.y1, bb.x2, bb.y2);
-
-    int sc = currentScroll;
-    if ( sc == 0 ) {
-        sc = deviceHeight;
-    }
-
-    switch( orientation ) {
-    case PORTRAIT:
-        {
-            for ( int16_t i = bb.x1; i <= bb.x2; i++ ) {
-                for ( int16_t j = bb.y1; j <= bb.y2; j++ ) {
-                    int16_t px = pgm_read_word_near(data + (j - y) * width + i - x);
-                    setCurrentPixel(px);
-                }
-            }
-        }
-        break;
-    case LANDSCAPE:
-        {
-            int h1 = height - max(0, (y + height) - deviceWidth) - 1;
-            int w1 = width - max(0, (x + width) - sc) - 1;
-            int w = bb.x2 - bb.x1 + 1;
-            int h = bb.y2 - bb.y1 + 1;
-            for ( int16_t i = 0; i < w; i++ ) {
-                for ( int16_t j = h - 1; j >= 0; j-- ) {
-                    int16_t px = pgm_read_word_near(data + (h1 - i) * width + (w1 - j));
-                    setCurrentPixel(px);
-                }
-            }
-        }
-        break;
-    case PORTRAIT_FLIP:
-        {
-            int h = bb.y2 - bb.y1 + 1;
-            int w = bb.x2 - bb.x1 + 1;
-            int cutH = y < 0 ? 0 : height - h;
-            int cutW = x < 0 ? 0 : width - w;
-            for ( int16_t i = 0; i < w; i++ ) {
-                for ( int16_t j = 0; j < h; j++ ) {
-                    int16_t px = pgm_read_word_near(data + (height - j - 1 - cutH) * width + (width - i - 1 - cutW));
-                    setCurrentPixel(px);
-                }
-            }
-        }
-        break;
-    case LANDSCAPE_FLIP:
-        {
-            int h1 = height - max(0, (y + height) - deviceWidth) - 1;
-            int w1 = width - max(0, (x + width) - sc) - 1;
-            int w = bb.x2 - bb.x1 + 1;
-            int h = bb.y2 - bb.y1 + 1;
-            for ( int16_t i = w - 1; i >= 0; i-- ) {
-                for ( int16_t j = 0; j < h; j++ ) {
-                    int16_t px = pgm_read_word_near(data + (h1 - i) * width + (w1 - j));
-                    setCurrentPixel(px);
-                }
-            }
-        }
-        break;
-    }
-
-    endGfxOperation(false);
-    return 0;
-}
 
 //boolean Pixels::checkBounds(Bounds& bb) {
 //    if (bb.x2 < bb.x1) {
@@ -437,4 +367,7 @@ int8_t Pixels::drawBitmap(int16_t x, int16_t y, int16_t width, int16_t height, p
 //}
 
 
+#if defined(PIXELS_CLASS)
+#undef Pixels
+#endif
 #endif
@@ -0,0 +1,447 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2013  Igor Repinetski
+ *
+ * The code is written in C/C++ for Arduino and can be easily ported to any microcontroller by rewritting the low level pin access functions.
+ *
+ * Text output methods of the library rely on Pixelmeister's font data format. See: http://pd4ml.com/pixelmeister
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ *
+ * This library includes some code portions and algoritmic ideas derived from works of
+ * - Andreas Schiffler -- aschiffler at ferzkopp dot net (SDL_gfx Project)
+ * - K. Townsend http://microBuilder.eu (lpc1343codebase Project)
+ */
+
+/*
+ * Sprites: movable images, which keep the covered screen content in a save-under buffer.
+ * A move restores only the uncovered strips of the old position, so there is no erase-redraw flicker.
+ *
+ *   Sprite marker(&pxs, markerBitmap, 9, 9);
+ *   marker.setColorKey(0);
+ *   marker.show(10, 10);
+ *   marker.moveTo(12, 11);
+ *
+ * Overlapping sprites should be combined in a SpriteList, which keeps them z-ordered.
+ * The save-under content is read with PixelsBase::readRasterLine(), so without video RAM
+ * readback support the covered content is assumed to be the background color.
+ */
+
+#include "Pixels.h"
+
+#ifndef PIXELS_SPRITE_H
+#define PIXELS_SPRITE_H
+
+#ifndef MAX_SPRITES
+#define MAX_SPRITES 8
+#endif
+
+#if MAX_SPRITES > 16
+#error MAX_SPRITES should not exceed 16
+#endif
+
+class Sprite : public Raster {
+private:
+    PixelsBase* pixels;
+    prog_uint16_t* image;
+    int16_t width;
+    int16_t height;
+
+    int16_t x;
+    int16_t y;
+    boolean visible;
+
+    boolean keyed;
+    uint16_t colorKey;
+
+    /* covered screen content */
+    uint16_t* saveUnder;
+
+    void save(int16_t u1, int16_t v1, int16_t u2, int16_t v2);
+    void restore(int16_t u1, int16_t v1, int16_t u2, int16_t v2);
+
+    Sprite(const Sprite&);
+    Sprite& operator=(const Sprite&);
+
+public:
+    /**
+     * @param pxs the display to draw on
+     * @param bitmap sprite image in RGB565 format
+     * @param w image width
+     * @param h image height
+     */
+    Sprite(PixelsBase* pxs, prog_uint16_t* bitmap, int16_t w, int16_t h);
+    ~Sprite();
+
+    /**
+     * Sets a transparent color of the sprite image.
+     * @param key color in RGB565 format
+     */
+    void setColorKey(uint16_t key);
+    /**
+     * Replaces the sprite image. A visible sprite is redrawn in place.
+     * @param bitmap new image of the same dimensions
+     */
+    void setImage(prog_uint16_t* bitmap);
+
+    /**
+     * Saves the covered content and draws the sprite with its top-left corner at (<i>x</i>,&nbsp;<i>y</i>).
+     */
+    void show(int16_t xx, int16_t yy);
+    /**
+     * Restores the covered content.
+     */
+    void hide();
+    /**
+     * Moves the sprite. Only the uncovered parts of the old position are restored
+     * and only the newly covered parts are read into the save-under buffer.
+     */
+    void moveTo(int16_t xx, int16_t yy);
+
+    boolean isVisible() {
+        return visible;
+    }
+
+    int16_t getX() {
+        return x;
+    }
+
+    int16_t getY() {
+        return y;
+    }
+
+    int16_t getWidth() {
+        return width;
+    }
+
+    int16_t getHeight() {
+        return height;
+    }
+
+    /**
+     * @return <i>true</i> if the sprite is visible and intersects the given rectangle
+     */
+    boolean intersects(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+        return visible && x <= x2 && x + width - 1 >= x1 && y <= y2 && y + height - 1 >= y1;
+    }
+
+    uint16_t getPixel(int16_t u, int16_t v);
+};
+
+/**
+ * Z-ordered sprite collection. Sprites, which overlap a changed one from above, are temporarily
+ * hidden, so every save-under buffer stays consistent.
+ */
+class SpriteList {
+private:
+    Sprite* sprites[MAX_SPRITES];
+    int8_t z[MAX_SPRITES];
+    uint8_t count;
+
+    int8_t indexOf(Sprite* sprite);
+    uint16_t hideAbove(int8_t idx, int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+    void showAbove(int8_t idx, uint16_t hidden);
+
+public:
+    SpriteList() {
+        count = 0;
+    }
+
+    /**
+     * Adds a hidden sprite to the list. Sprites with bigger z values are drawn over the ones with smaller z values.
+     * @return <i>false</i> if the list is full
+     */
+    boolean add(Sprite* sprite, int8_t zOrder);
+    /**
+     * Hides the sprite and removes it from the list.
+     */
+    void remove(Sprite* sprite);
+
+    void show(Sprite* sprite, int16_t x, int16_t y);
+    void hide(Sprite* sprite);
+    void moveTo(Sprite* sprite, int16_t x, int16_t y);
+    void setImage(Sprite* sprite, prog_uint16_t* bitmap);
+};
+
+Sprite::Sprite(PixelsBase* pxs, prog_uint16_t* bitmap, int16_t w, int16_t h) {
+    pixels = pxs;
+    image = bitmap;
+    width = w;
+    height = h;
+    x = 0;
+    y = 0;
+    visible = false;
+    keyed = false;
+    colorKey = 0;
+    saveUnder = new uint16_t[(int32_t)w * h];
+}
+
+Sprite::~Sprite() {
+    delete[] saveUnder;
+}
+
+void Sprite::setColorKey(uint16_t key) {
+    keyed = true;
+    colorKey = key;
+    if ( visible ) {
+        pixels->drawRaster(x, y, width, height, this);
+    }
+}
+
+void Sprite::setImage(prog_uint16_t* bitmap) {
+    image = bitmap;
+    if ( visible ) {
+        pixels->drawRaster(x, y, width, height, this);
+    }
+}
+
+uint16_t Sprite::getPixel(int16_t u, int16_t v) {
+    uint16_t c = pgm_read_word_near(image + (int32_t)v * width + u);
+    if ( keyed && c == colorKey ) {
+        return saveUnder[(int32_t)v * width + u];
+    }
+    return c;
+}
+
+/*
+ * Reads screen content of the sprite area part (in sprite coordinates) into the save-under buffer
+ */
+void Sprite::save(int16_t u1, int16_t v1, int16_t u2, int16_t v2) {
+    for ( int16_t v = v1; v <= v2; v++ ) {
+        pixels->readRasterLine(x + u1, y + v, u2 - u1 + 1, saveUnder + (int32_t)v * width + u1);
+    }
+}
+
+/*
+ * Puts the save-under buffer part (in sprite coordinates) back to the screen
+ */
+void Sprite::restore(int16_t u1, int16_t v1, int16_t u2, int16_t v2) {
+    if ( u1 > u2 || v1 > v2 ) {
+        return;
+    }
+    BufferRaster raster(saveUnder + (int32_t)v1 * width + u1, width);
+    pixels->drawRaster(x + u1, y + v1, u2 - u1 + 1, v2 - v1 + 1, &raster);
+}
+
+void Sprite::show(int16_t xx, int16_t yy) {
+    if ( visible ) {
+        moveTo(xx, yy);
+        return;
+    }
+    x = xx;
+    y = yy;
+    save(0, 0, width - 1, height - 1);
+    visible = true;
+    pixels->drawRaster(x, y, width, height, this);
+}
+
+void Sprite::hide() {
+    if ( !visible ) {
+        return;
+    }
+    restore(0, 0, width - 1, height - 1);
+    visible = false;
+}
+
+void Sprite::moveTo(int16_t xx, int16_t yy) {
+    if ( !visible ) {
+        x = xx;
+        y = yy;
+        return;
+    }
+
+    int16_t dx = xx - x;
+    int16_t dy = yy - y;
+    if ( dx == 0 && dy == 0 ) {
+        return;
+    }
+
+    if ( abs(dx) >= width || abs(dy) >= height ) {
+        hide();
+        show(xx, yy);
+        return;
+    }
+
+    // the overlap of the old and the new position in the old sprite coordinates
+    int16_t ou1 = dx > 0 ? dx : 0;
+    int16_t ou2 = dx > 0 ? width - 1 : width - 1 + dx;
+    int16_t ov1 = dy > 0 ? dy : 0;
+    int16_t ov2 = dy > 0 ? height - 1 : height - 1 + dy;
+
+    // restores the uncovered horizontal strip and the uncovered vertical strip next to the overlap
+    if ( dy > 0 ) {
+        restore(0, 0, width - 1, ov1 - 1);
+    } else if ( dy < 0 ) {
+        restore(0, ov2 + 1, width - 1, height - 1);
+    }
+    if ( dx > 0 ) {
+        restore(0, ov1, ou1 - 1, ov2);
+    } else if ( dx < 0 ) {
+        restore(ou2 + 1, ov1, width - 1, ov2);
+    }
+
+    // moves the still covered content to its place in the new sprite coordinates
+    int16_t rows = ov2 - ov1 + 1;
+    int16_t cols = ou2 - ou1 + 1;
+    for ( int16_t r = 0; r < rows; r++ ) {
+        int16_t v = ov1 + (dy > 0 ? r : rows - 1 - r);
+        uint16_t* dst = saveUnder + (int32_t)(v - dy) * width + ou1 - dx;
+        uint16_t* src = saveUnder + (int32_t)v * width + ou1;
+        memmove(dst, src, cols * sizeof(uint16_t));
+    }
+
+    x = xx;
+    y = yy;
+
+    // saves the newly covered strips
+    if ( dy > 0 ) {
+        save(0, rows, width - 1, height - 1);
+    } else if ( dy < 0 ) {
+        save(0, 0, width - 1, -dy - 1);
+    }
+    int16_t nv1 = dy > 0 ? 0 : -dy;
+    int16_t nv2 = nv1 + rows - 1;
+    if ( dx > 0 ) {
+        save(cols, nv1, width - 1, nv2);
+    } else if ( dx < 0 ) {
+        save(0, nv1, -dx - 1, nv2);
+    }
+
+    pixels->drawRaster(x, y, width, height, this);
+}
+
+int8_t SpriteList::indexOf(Sprite* sprite) {
+    for ( int8_t i = 0; i < count; i++ ) {
+        if ( sprites[i] == sprite ) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Hides visible sprites above the given one, which overlap the area directly or via other hidden sprites.
+ * Returns a bit set of the hidden sprites
+ */
+uint16_t SpriteList::hideAbove(int8_t idx, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+    uint16_t hidden = 0;
+    for ( int8_t i = idx + 1; i < count; i++ ) {
+        Sprite* s = sprites[i];
+        boolean affected = s->intersects(x1, y1, x2, y2);
+        for ( int8_t j = idx + 1; j < i && !affected; j++ ) {
+            affected = (hidden & (1 << j)) &&
+                    s->intersects(sprites[j]->getX(), sprites[j]->getY(),
+                                  sprites[j]->getX() + sprites[j]->getWidth() - 1, sprites[j]->getY() + sprites[j]->getHeight() - 1);
+        }
+        if ( affected ) {
+            hidden |= 1 << i;
+        }
+    }
+    for ( int8_t i = count - 1; i > idx; i-- ) {
+        if ( hidden & (1 << i) ) {
+            sprites[i]->hide();
+        }
+    }
+    return hidden;
+}
+
+void SpriteList::showAbove(int8_t idx, uint16_t hidden) {
+    for ( int8_t i = idx + 1; i < count; i++ ) {
+        if ( hidden & (1 << i) ) {
+            sprites[i]->show(sprites[i]->getX(), sprites[i]->getY());
+        }
+    }
+}
+
+boolean SpriteList::add(Sprite* sprite, int8_t zOrder) {
+    if ( count >= MAX_SPRITES ) {
+        return false;
+    }
+
+    int8_t idx = count;
+    while ( idx > 0 && z[idx - 1] > zOrder ) {
+        sprites[idx] = sprites[idx - 1];
+        z[idx] = z[idx - 1];
+        idx--;
+    }
+    sprites[idx] = sprite;
+    z[idx] = zOrder;
+    count++;
+    return true;
+}
+
+void SpriteList::remove(Sprite* sprite) {
+    int8_t idx = indexOf(sprite);
+    if ( idx < 0 ) {
+        return;
+    }
+    hide(sprite);
+    for ( int8_t i = idx; i < count - 1; i++ ) {
+        sprites[i] = sprites[i + 1];
+        z[i] = z[i + 1];
+    }
+    count--;
+}
+
+void SpriteList::show(Sprite* sprite, int16_t x, int16_t y) {
+    int8_t idx = indexOf(sprite);
+    if ( idx < 0 ) {
+        return;
+    }
+    if ( sprite->isVisible() ) {
+        moveTo(sprite, x, y);
+        return;
+    }
+    uint16_t hidden = hideAbove(idx, x, y, x + sprite->getWidth() - 1, y + sprite->getHeight() - 1);
+    sprite->show(x, y);
+    showAbove(idx, hidden);
+}
+
+void SpriteList::hide(Sprite* sprite) {
+    int8_t idx = indexOf(sprite);
+    if ( idx < 0 || !sprite->isVisible() ) {
+        return;
+    }
+    int16_t x = sprite->getX();
+    int16_t y = sprite->getY();
+    uint16_t hidden = hideAbove(idx, x, y, x + sprite->getWidth() - 1, y + sprite->getHeight() - 1);
+    sprite->hide();
+    showAbove(idx, hidden);
+}
+
+void SpriteList::moveTo(Sprite* sprite, int16_t x, int16_t y) {
+    int8_t idx = indexOf(sprite);
+    if ( idx < 0 ) {
+        return;
+    }
+    if ( !sprite->isVisible() ) {
+        sprite->moveTo(x, y);
+        return;
+    }
+    int16_t x1 = min(x, sprite->getX());
+    int16_t y1 = min(y, sprite->getY());
+    int16_t x2 = max(x, sprite->getX()) + sprite->getWidth() - 1;
+    int16_t y2 = max(y, sprite->getY()) + sprite->getHeight() - 1;
+    uint16_t hidden = hideAbove(idx, x1, y1, x2, y2);
+    sprite->moveTo(x, y);
+    showAbove(idx, hidden);
+}
+
+void SpriteList::setImage(Sprite* sprite, prog_uint16_t* bitmap) {
+    int8_t idx = indexOf(sprite);
+    if ( idx < 0 ) {
+        return;
+    }
+    if ( !sprite->isVisible() ) {
+        sprite->setImage(bitmap);
+        return;
+    }
+    int16_t x = sprite->getX();
+    int16_t y = sprite->getY();
+    uint16_t hidden = hideAbove(idx, x, y, x + sprite->getWidth() - 1, y + sprite->getHeight() - 1);
+    sprite->setImage(bitmap);
+    showAbove(idx, hidden);
+}
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2013  Igor Repinetski
+ *
+ * The code is written in C/C++ for Arduino and can be easily ported to any microcontroller by rewritting the low level pin access functions.
+ *
+ * Text output methods of the library rely on Pixelmeister's font data format. See: http://pd4ml.com/pixelmeister
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ *
+ * This library includes some code portions and algoritmic ideas derived from works of
+ * - Andreas Schiffler -- aschiffler at ferzkopp dot net (SDL_gfx Project)
+ * - K. Townsend http://microBuilder.eu (lpc1343codebase Project)
+ */
+
+/*
+ * Strip chart: a rolling plot, which uses the hardware scroll as a ring buffer of sample columns.
+ * A sample outputs a single column (a row by PORTRAIT orientations) at the end of the scroll area:
+ * background, gridlines and min/max spans of all the traces are composed into one region, so a sample
+ * costs the chart height in pixels, independently of the chart length.
+ *
+ *   StripChart chart(&pxs, 20, 200, 0, 1023);
+ *   chart.setTrace(0, 0xF800);
+ *   chart.setGrid(0x4208, 50, 25);
+ *   ...
+ *   int16_t value = analogRead(A0);
+ *   chart.addSample(&value);
+ *
+ * The samples run along the scroll axis: left to right by LANDSCAPE, top to bottom by PORTRAIT
+ * orientations. Without hardware scroll support the chart sweeps over the screen instead.
+ */
+
+#include "Pixels.h"
+
+#ifndef PIXELS_STRIPCHART_H
+#define PIXELS_STRIPCHART_H
+
+#ifndef MAX_TRACES
+#define MAX_TRACES 4
+#endif
+
+class StripChart : public Raster {
+private:
+    PixelsBase* pixels;
+
+    int16_t position;
+    int16_t size;
+    int16_t minValue;
+    int16_t maxValue;
+
+    uint8_t traces;
+    uint16_t colors[MAX_TRACES];
+    /* current (lo, hi) and previous (prevLo, prevHi) spans in pixels over the minimal value */
+    int16_t lo[MAX_TRACES];
+    int16_t hi[MAX_TRACES];
+    int16_t prevLo[MAX_TRACES];
+    int16_t prevHi[MAX_TRACES];
+
+    uint16_t gridColor;
+    int16_t gridValueStep; // value distance between horizontal gridlines
+    int16_t gridSampleStep;
+
+    uint16_t samples;
+    uint16_t columnBackground;
+    boolean gridColumn;
+
+    int16_t toPixels(int16_t value);
+    boolean isGridRow(int16_t p);
+
+public:
+    /**
+     * @param pxs the display to draw on
+     * @param pos the chart top (left by PORTRAIT orientations) across the scroll axis
+     * @param sz the chart height (width by PORTRAIT orientations)
+     * @param minVal the value at the chart bottom (left)
+     * @param maxVal the value at the chart top (right)
+     */
+    StripChart(PixelsBase* pxs, int16_t pos, int16_t sz, int16_t minVal, int16_t maxVal);
+
+    /**
+     * Sets a trace color. The number of traces is defined by the highest trace index set.
+     * @param trace trace index below MAX_TRACES
+     * @param color trace color in RGB565 format
+     */
+    void setTrace(uint8_t trace, uint16_t color);
+
+    /**
+     * Sets a gridline pattern
+     * @param color gridline color in RGB565 format
+     * @param valueStep value distance between horizontal gridlines; 0 for none
+     * @param sampleStep number of samples between vertical gridlines; 0 for none
+     */
+    void setGrid(uint16_t color, int16_t valueStep, int16_t sampleStep);
+
+    /**
+     * Adds a sample column, a trace is drawn as a line from its previous value.
+     * @param values a value per trace
+     */
+    void addSample(int16_t* values) {
+        addSample(values, values);
+    }
+
+    /**
+     * Adds a sample column with a min/max envelope per trace, for example of values collected
+     * in between two chart columns.
+     * @param minValues minimal value per trace
+     * @param maxValues maximal value per trace
+     */
+    void addSample(int16_t* minValues, int16_t* maxValues);
+
+    uint16_t getPixel(int16_t u, int16_t v);
+};
+
+StripChart::StripChart(PixelsBase* pxs, int16_t pos, int16_t sz, int16_t minVal, int16_t maxVal) {
+    pixels = pxs;
+    position = pos;
+    size = sz;
+    minValue = minVal;
+    maxValue = maxVal > minVal ? maxVal : minVal + 1;
+
+    traces = 0;
+    gridColor = 0;
+    gridValueStep = 0;
+    gridSampleStep = 0;
+    samples = 0;
+    columnBackground = 0;
+    gridColumn = false;
+
+    for ( uint8_t i = 0; i < MAX_TRACES; i++ ) {
+        colors[i] = 0xFFFF;
+        prevLo[i] = -1;
+        prevHi[i] = -1;
+    }
+}
+
+void StripChart::setTrace(uint8_t trace, uint16_t color) {
+    if ( trace >= MAX_TRACES ) {
+        return;
+    }
+    colors[trace] = color;
+    if ( trace >= traces ) {
+        traces = trace + 1;
+    }
+}
+
+void StripChart::setGrid(uint16_t color, int16_t valueStep, int16_t sampleStep) {
+    gridColor = color;
+    gridValueStep = valueStep > 0 && size > 1 ? valueStep : 0;
+    gridSampleStep = sampleStep;
+}
+
+int16_t StripChart::toPixels(int16_t value) {
+    if ( value <= minValue ) {
+        return 0;
+    }
+    if ( value >= maxValue ) {
+        return size - 1;
+    }
+    return ((int32_t)(value - minValue) * (size - 1)) / ((int32_t)maxValue - minValue);
+}
+
+boolean StripChart::isGridRow(int16_t p) {
+    // gridlines are placed by toPixels() of each multiple of the value step, so the pixel
+    // steps between them vary and do not add up the rounding error of a single step
+    int32_t range = (int32_t)maxValue - minValue;
+    int32_t stepPixels = (int32_t)gridValueStep * (size - 1);
+    // the first multiple of the step that does not map below p
+    int32_t k = ((int32_t)p * range + stepPixels - 1) / stepPixels;
+    return k * gridValueStep <= range && (k * stepPixels) / range == p;
+}
+
+uint16_t StripChart::getPixel(int16_t u, int16_t v) {
+    // one of u, v is always 0
+    int16_t p = u + v;
+    if ( pixels->getOrientation() % 2 == 1 ) {
+        p = size - 1 - p;
+    }
+
+    // later traces are on top
+    for ( int8_t i = traces - 1; i >= 0; i-- ) {
+        if ( p >= lo[i] && p <= hi[i] ) {
+            return colors[i];
+        }
+    }
+
+    if ( gridColumn ) {
+        return gridColor;
+    }
+    if ( gridValueStep > 0 && isGridRow(p) ) {
+        return gridColor;
+    }
+    return columnBackground;
+}
+
+void StripChart::addSample(int16_t* minValues, int16_t* maxValues) {
+
+    for ( uint8_t i = 0; i < traces; i++ ) {
+        lo[i] = toPixels(minValues[i]);
+        hi[i] = toPixels(maxValues[i]);
+        if ( lo[i] > hi[i] ) {
+            swap(lo[i], hi[i]);
+        }
+        // the span is joined to the previous one, so the trace has no gaps
+        if ( prevHi[i] >= 0 ) {
+            if ( lo[i] > prevHi[i] ) {
+                lo[i] = prevHi[i];
+            } else if ( hi[i] < prevLo[i] ) {
+                hi[i] = prevLo[i];
+            }
+        }
+        prevLo[i] = toPixels(minValues[i]);
+        prevHi[i] = toPixels(maxValues[i]);
+        if ( prevLo[i] > prevHi[i] ) {
+            swap(prevLo[i], prevHi[i]);
+        }
+    }
+
+    columnBackground = pixels->getBackground()->convertTo565();
+    gridColumn = gridSampleStep > 0 && samples % gridSampleStep == 0;
+    samples++;
+
+    int16_t start = pixels->getScrollAreaStart();
+    int16_t end = pixels->getScrollAreaEnd();
+
+    boolean origin = pixels->isOriginRelative();
+    pixels->setOriginAbsolute();
+
+    int16_t column;
+    if ( pixels->canScroll() ) {
+        // the oldest column is replaced and becomes the last one after the scroll
+        column = start;
+    } else {
+        column = start + (samples - 1) % (end - start);
+    }
+
+    if ( pixels->getOrientation() % 2 == 1 ) {
+        pixels->drawRaster(column, position, 1, size, this);
+    } else {
+        pixels->drawRaster(position, column, size, 1, this);
+    }
+
+    if ( pixels->canScroll() ) {
+        pixels->scroll(1, 0);
+    }
+
+    if ( origin ) {
+        pixels->setOriginRelative();
+    }
+}
+
+#endif
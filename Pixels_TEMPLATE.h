@@ -15,7 +15,7 @@
  */
 
 
-// There are 5 TODO steps:
+// There are 7 TODO steps, the last two are optional:
 
 // 1. TODO replace all occurences of "TEMPLATE" pattern with a controller name (i.e. PIXELS_TEMPLATE_H -> PIXELS_SSD1289_H)
 
@@ -25,22 +25,30 @@
 
 #include "Pixels.h"
 
+#ifndef PIXELS_BUS
+#error Include a Pixels_<BUS>.h header before Pixels_<CONTROLLER>.h
+#endif
+
 #ifndef PIXELS_TEMPLATE_H
 #define PIXELS_TEMPLATE_H
 #define PIXELS_MAIN
 
+#if defined(PIXELS_CLASS)
+#define Pixels PIXELS_CLASS
+#endif
+
 #if defined(PIXELS_ANTIALIASING_H)
 #define PixelsBase PixelsAntialiased
 #endif
 
 class Pixels : public PixelsBase
-#if defined(PIXELS_SPISW_H)
+#if PIXELS_BUS == PIXELS_BUS_SPISW
                                     , public SPIsw
-#elif defined(PIXELS_SPIHW_H)
+#elif PIXELS_BUS == PIXELS_BUS_SPIHW
                                     , public SPIhw
-#elif defined(PIXELS_PPI8_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI8
                                     , public PPI8
-#elif defined(PIXELS_PPI16_H)
+#elif PIXELS_BUS == PIXELS_BUS_PPI16
                                     , public PPI16
 #endif
 {
@@ -54,6 +62,10 @@ protected:
     void setFillDirection(uint8_t direction);
 
     void scrollCmd();
+    boolean scrollAreaCmd();
+#if PIXELS_BUS == PIXELS_BUS_PPI16
+    int32_t readRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t* data);
+#endif
 
 public:
 
@@ -103,6 +115,18 @@ void Pixels::scrollCmd() {
     //    writeData(lowByte(s));
 }
 
+boolean Pixels::scrollAreaCmd() {
+    // 6. TODO put vertical scrolling area commands here (fixed top rows, scrolled band, fixed bottom rows),
+    //    if the controller has them. Returning false keeps a partial scroll area unsupported.
+
+    //    int16_t band = scrollBand();
+    //    writeCmd(0x33);
+    //    writeData(highByte(scrollTop));
+    //    ...
+    //    return true;
+    return scrollTop == 0 && scrollBottom == 0;
+}
+
 void Pixels::setFillDirection(uint8_t direction) {
     fillDirection = direction;
 }
@@ -161,4 +185,28 @@ int32_t Pixels::setRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
 
     return (int32_t)(bb.x2 - bb.x1 + 1) * (bb.y2 - bb.y1 + 1);
 }
+
+#if PIXELS_BUS == PIXELS_BUS_PPI16
+int32_t Pixels::readRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t* data) {
+
+    if ( !canReadData() ) {
+        return -1;
+    }
+
+    // 7. TODO put the memory read command here, if the controller can read its video RAM back.
+    //    Returning -1 keeps readPixels() and the functions built on it unsupported.
+
+    // int32_t counter = setRegion(x1, y1, x2, y2);
+    // writeCmd(0x2e);
+    // beginRead();
+    // readData(); // dummy read
+    // ...
+    // endRead();
+    // return counter;
+    return -1;
+}
+#endif
+#if defined(PIXELS_CLASS)
+#undef Pixels
+#endif
 #endif
@@ -0,0 +1,385 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2013  Igor Repinetski
+ *
+ * The code is written in C/C++ for Arduino and can be easily ported to any microcontroller by rewritting the low level pin access functions.
+ *
+ * Text output methods of the library rely on Pixelmeister's font data format. See: http://pd4ml.com/pixelmeister
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ *
+ * This library includes some code portions and algoritmic ideas derived from works of
+ * - Andreas Schiffler -- aschiffler at ferzkopp dot net (SDL_gfx Project)
+ * - K. Townsend http://microBuilder.eu (lpc1343codebase Project)
+ */
+
+/*
+ * Tile map: a grid of cells, which refer tiles of an atlas by index. Changed cells are marked dirty
+ * and flush() redraws only them, a horizontal run of dirty cells is output as one region, in which
+ * every pixel is written once.
+ *
+ * An atlas is either a list of Pixelmeister icons (drawn with the current color over the background
+ * color) or a sequence of equally sized RGB565 bitmaps, stored one after another.
+ *
+ *   prog_uchar* icons[] = { icon_ok, icon_cancel };
+ *   TileMap menu(&pxs, 0, 40, 4, 3, 48, 48);
+ *   menu.setIconAtlas(icons, 2);
+ *   menu.setTile(1, 2, 0);
+ *   menu.flush();
+ */
+
+#include "Pixels.h"
+
+#ifndef PIXELS_TILEMAP_H
+#define PIXELS_TILEMAP_H
+
+#define EMPTY_TILE 0xFF
+
+/*
+ * Coverage of Pixelmeister icon pixels by position. A run-length stream is walked forwards from
+ * the last requested pixel, so pixels requested in the stream order cost a run step at most.
+ */
+class IconReader {
+private:
+    prog_uchar* stream;
+    int16_t length;
+    boolean antialiased;
+    boolean runs;
+    boolean vraster;
+    int16_t left;
+    int16_t top;
+    int16_t eff; // pixels per stream line
+
+    int16_t pos; // current stream byte
+    int32_t start; // index of its first pixel
+
+    int16_t runLength(uint8_t b) {
+        if ( !antialiased ) {
+            return b & 0x7f;
+        }
+        return (b & 0xc0) > 0 ? b & 0x3f : 1;
+    }
+
+public:
+    void set(prog_uchar* icon);
+    /**
+     * @return 0 for a background pixel, 255 for a foreground one, the foreground weight otherwise
+     */
+    uint8_t getCoverage(int16_t x, int16_t y);
+};
+
+void IconReader::set(prog_uchar* icon) {
+    // the glyph header as drawIcon() passes it to drawGlyph()
+    prog_uchar* data = icon + 1;
+    antialiased = pgm_read_byte_near(icon + 1) == 'a';
+    int16_t height = pgm_read_byte_near(icon + 4);
+    int16_t width = pgm_read_byte_near(data + 4);
+    left = 0x7f & pgm_read_byte_near(data + 5);
+    top = 0xff & pgm_read_byte_near(data + 6);
+    int16_t right = 0x7f & pgm_read_byte_near(data + 7);
+    vraster = (0x80 & pgm_read_byte_near(data + 5)) > 0;
+    runs = antialiased || (0x80 & pgm_read_byte_near(data + 7)) > 0;
+    if ( !runs ) {
+        // plain bitmasks are always stored by rows
+        vraster = false;
+    }
+    eff = vraster ? height - top - right : width - left - right;
+    length = ((0xFF & (int16_t)pgm_read_byte_near(icon + 2)) << 8) + (0xFF & pgm_read_byte_near(icon + 3)) - 9;
+    stream = data + 8;
+    pos = 0;
+    start = 0;
+}
+
+uint8_t IconReader::getCoverage(int16_t x, int16_t y) {
+    x -= left;
+    y -= top;
+    if ( x < 0 || y < 0 || eff <= 0 || (vraster ? y : x) >= eff ) {
+        return 0;
+    }
+    int32_t k = vraster ? (int32_t)x * eff + y : (int32_t)y * eff + x;
+
+    if ( !runs ) {
+        if ( (k >> 3) >= length ) {
+            return 0;
+        }
+        return (pgm_read_byte_near(stream + (k >> 3)) & (0x80 >> (k & 7))) == 0 ? 255 : 0;
+    }
+
+    if ( k < start ) {
+        pos = 0;
+        start = 0;
+    }
+    uint8_t b = 0;
+    while ( pos < length ) {
+        b = pgm_read_byte_near(stream + pos);
+        int16_t len = runLength(b);
+        if ( k < start + len ) {
+            break;
+        }
+        start += len;
+        pos++;
+    }
+    if ( pos >= length ) {
+        return 0;
+    }
+    if ( !antialiased || (b & 0xc0) > 0 ) {
+        return (b & 0x80) > 0 ? 255 : 0;
+    }
+    // the stored value is the background weight in 1/64
+    return 255 - (0xff & (b << 2));
+}
+
+class TileMap : public Raster {
+private:
+    PixelsBase* pixels;
+
+    int16_t x;
+    int16_t y;
+    uint8_t columns;
+    uint8_t rows;
+    int16_t tileWidth;
+    int16_t tileHeight;
+
+    uint8_t* tiles;
+    uint8_t* dirty; // bit per cell
+
+    prog_uchar** icons;
+    prog_uint16_t* bitmaps;
+    uint8_t atlasSize;
+
+    /* run being flushed */
+    uint8_t* runTiles;
+    uint16_t runBackground;
+    uint16_t runForeground;
+    RGB runBg;
+    RGB runFg;
+    IconReader* readers; // per run cell
+
+    /* the run cell of the last pixel and its left edge, so the cell is found once per cell */
+    int16_t runCell;
+    int16_t runCellX;
+
+    boolean isDirty(int16_t idx) {
+        return (dirty[idx >> 3] & (1 << (idx & 7))) != 0;
+    }
+
+    void flushRun(uint8_t row, uint8_t col1, uint8_t col2);
+
+    TileMap(const TileMap&);
+    TileMap& operator=(const TileMap&);
+
+public:
+    /**
+     * @param pxs the display to draw on
+     * @param xx the <i>x</i> coordinate of the map top-left corner
+     * @param yy the <i>y</i> coordinate of the map top-left corner
+     * @param cols number of columns
+     * @param rws number of rows
+     * @param tw tile width
+     * @param th tile height
+     */
+    TileMap(PixelsBase* pxs, int16_t xx, int16_t yy, uint8_t cols, uint8_t rws, int16_t tw, int16_t th);
+    ~TileMap();
+
+    /**
+     * Uses Pixelmeister icons as tiles. All the cells are marked dirty.
+     * @param atlas icon list
+     * @param count number of icons
+     */
+    void setIconAtlas(prog_uchar** atlas, uint8_t count);
+    /**
+     * Uses RGB565 bitmaps as tiles. All the cells are marked dirty.
+     * @param atlas tile bitmaps of the map tile size, stored one after another
+     * @param count number of tiles
+     */
+    void setBitmapAtlas(prog_uint16_t* atlas, uint8_t count);
+
+    /**
+     * Assigns a tile to a cell, the cell becomes dirty if the tile is changed.
+     * @param col cell column
+     * @param row cell row
+     * @param tile tile index or EMPTY_TILE
+     */
+    void setTile(uint8_t col, uint8_t row, uint8_t tile);
+    uint8_t getTile(uint8_t col, uint8_t row);
+
+    /**
+     * Marks a cell dirty, for example after the color is changed
+     */
+    void invalidate(uint8_t col, uint8_t row);
+    /**
+     * Marks all the cells dirty
+     */
+    void invalidate();
+
+    /**
+     * Redraws dirty cells
+     */
+    void flush();
+
+    uint16_t getPixel(int16_t u, int16_t v);
+};
+
+TileMap::TileMap(PixelsBase* pxs, int16_t xx, int16_t yy, uint8_t cols, uint8_t rws, int16_t tw, int16_t th) {
+    pixels = pxs;
+    x = xx;
+    y = yy;
+    columns = cols;
+    rows = rws;
+    tileWidth = tw;
+    tileHeight = th;
+
+    int16_t cells = (int16_t)cols * rws;
+    tiles = new uint8_t[cells];
+    dirty = new uint8_t[(cells + 7) / 8];
+    for ( int16_t i = 0; i < cells; i++ ) {
+        tiles[i] = EMPTY_TILE;
+    }
+
+    icons = NULL;
+    bitmaps = NULL;
+    atlasSize = 0;
+    runTiles = NULL;
+    runBackground = 0;
+    runForeground = 0;
+    readers = NULL;
+    runCell = 0;
+    runCellX = 0;
+
+    invalidate();
+}
+
+TileMap::~TileMap() {
+    delete[] tiles;
+    delete[] dirty;
+    delete[] readers;
+}
+
+void TileMap::setIconAtlas(prog_uchar** atlas, uint8_t count) {
+    icons = atlas;
+    bitmaps = NULL;
+    atlasSize = count;
+    if ( readers == NULL ) {
+        readers = new IconReader[columns];
+    }
+    invalidate();
+}
+
+void TileMap::setBitmapAtlas(prog_uint16_t* atlas, uint8_t count) {
+    bitmaps = atlas;
+    icons = NULL;
+    atlasSize = count;
+    invalidate();
+}
+
+void TileMap::setTile(uint8_t col, uint8_t row, uint8_t tile) {
+    if ( col >= columns || row >= rows ) {
+        return;
+    }
+    int16_t idx = (int16_t)row * columns + col;
+    if ( tiles[idx] != tile ) {
+        tiles[idx] = tile;
+        dirty[idx >> 3] |= 1 << (idx & 7);
+    }
+}
+
+uint8_t TileMap::getTile(uint8_t col, uint8_t row) {
+    if ( col >= columns || row >= rows ) {
+        return EMPTY_TILE;
+    }
+    return tiles[(int16_t)row * columns + col];
+}
+
+void TileMap::invalidate(uint8_t col, uint8_t row) {
+    if ( col >= columns || row >= rows ) {
+        return;
+    }
+    int16_t idx = (int16_t)row * columns + col;
+    dirty[idx >> 3] |= 1 << (idx & 7);
+}
+
+void TileMap::invalidate() {
+    int16_t cells = (int16_t)columns * rows;
+    for ( int16_t i = 0; i < (cells + 7) / 8; i++ ) {
+        dirty[i] = 0xFF;
+    }
+}
+
+uint16_t TileMap::getPixel(int16_t u, int16_t v) {
+    if ( u < runCellX || u >= runCellX + tileWidth ) {
+        runCell = u / tileWidth;
+        runCellX = runCell * tileWidth;
+    }
+    uint8_t tile = runTiles[runCell];
+    if ( tile >= atlasSize ) {
+        return runBackground;
+    }
+    int16_t offset = u - runCellX;
+    if ( bitmaps != NULL ) {
+        return pgm_read_word_near(bitmaps + ((int32_t)tile * tileHeight + v) * tileWidth + offset);
+    }
+
+    uint8_t c = readers[runCell].getCoverage(offset, v);
+    if ( c == 0 ) {
+        return runBackground;
+    }
+    if ( c == 255 ) {
+        return runForeground;
+    }
+    // mixed as drawGlyph() does for antialiased icons
+    RGB mixed((runFg.red * (int32_t)c + runBg.red * (int32_t)(255 - c)) / 255,
+              (runFg.green * (int32_t)c + runBg.green * (int32_t)(255 - c)) / 255,
+              (runFg.blue * (int32_t)c + runBg.blue * (int32_t)(255 - c)) / 255);
+    return mixed.convertTo565();
+}
+
+void TileMap::flushRun(uint8_t row, uint8_t col1, uint8_t col2) {
+    int16_t xx = x + col1 * tileWidth;
+    int16_t yy = y + row * tileHeight;
+    int16_t w = (col2 - col1 + 1) * tileWidth;
+
+    runTiles = tiles + (int16_t)row * columns + col1;
+    runCell = 0;
+    runCellX = 0;
+    runBg = *pixels->getBackground();
+    runFg = *pixels->getColor();
+    runBackground = runBg.convertTo565();
+    runForeground = runFg.convertTo565();
+
+    if ( icons != NULL ) {
+        for ( uint8_t c = col1; c <= col2; c++ ) {
+            uint8_t tile = runTiles[c - col1];
+            if ( tile < atlasSize ) {
+                readers[c - col1].set(icons[tile]);
+            }
+        }
+    }
+
+    // icon and bitmap tiles and the background of empty cells go out as one region
+    pixels->drawRaster(xx, yy, w, tileHeight, this);
+}
+
+void TileMap::flush() {
+    for ( uint8_t row = 0; row < rows; row++ ) {
+        int16_t base = (int16_t)row * columns;
+        uint8_t col = 0;
+        while ( col < columns ) {
+            while ( col < columns && !isDirty(base + col) ) {
+                col++;
+            }
+            if ( col >= columns ) {
+                break;
+            }
+            uint8_t start = col;
+            while ( col < columns && isDirty(base + col) ) {
+                int16_t idx = base + col;
+                dirty[idx >> 3] &= ~(1 << (idx & 7));
+                col++;
+            }
+            flushRun(row, start, col - 1);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2014
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+/*
+ * The subset of the Arduino API the library uses, for building it with a host compiler
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+// standard headers using min and max come before the macros
+#include <algorithm>
+#include <vector>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+#define pgm_read_byte_near(x) (*((const uint8_t*)(x)))
+#define pgm_read_byte(x) (*((const uint8_t*)(x)))
+#define pgm_read_word_near(x) (*((const uint16_t*)(x)))
+#define pgm_read_word(x) (*((const uint16_t*)(x)))
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+#define cbi(reg, bitmask) *reg &= ~bitmask
+#define sbi(reg, bitmask) *reg |= bitmask
+
+extern unsigned long hostMillis;
+
+inline void delay(unsigned long ms) {
+    hostMillis += ms;
+}
+
+inline void delayMicroseconds(unsigned int) {
+}
+
+inline unsigned long millis() {
+    return hostMillis;
+}
+
+inline void pinMode(int, int) {
+}
+
+inline void digitalWrite(int, int) {
+}
+
+class String {
+private:
+    std::string s;
+
+public:
+    String() {
+    }
+
+    String(const char* c) : s(c) {
+    }
+
+    String(const std::string& c) : s(c) {
+    }
+
+    String(int v) : s(std::to_string(v)) {
+    }
+
+    unsigned int length() const {
+        return s.size();
+    }
+
+    char charAt(unsigned int i) const {
+        return i < s.size() ? s[i] : 0;
+    }
+
+    String substring(unsigned int a, unsigned int b) const {
+        return String(s.substr(a, b > a ? b - a : 0));
+    }
+
+    String substring(unsigned int a) const {
+        return String(s.substr(a));
+    }
+
+    int indexOf(char c) const {
+        size_t p = s.find(c);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+
+    const char* c_str() const {
+        return s.c_str();
+    }
+
+    String operator+(const String& o) const {
+        return String(s + o.s);
+    }
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2014
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+/*
+ * Pixels port to a host memory panel: the controller RAM is an array, windows and written pixels
+ * are counted. Host checks draw the same scene in different ways and compare the panels.
+ */
+
+#include "Pixels.h"
+
+#ifndef PIXELS_HOST_H
+#define PIXELS_HOST_H
+#define PIXELS_MAIN
+
+class Pixels : public PixelsBase {
+private:
+    int16_t wx1;
+    int16_t wy1;
+    int16_t wx2;
+    int16_t wy2;
+    int16_t cx;
+    int16_t cy;
+    regtype hostCS;
+
+    void advance() {
+        if ( ++cx > wx2 ) {
+            cx = wx1;
+            if ( ++cy > wy2 ) {
+                cy = wy1;
+            }
+        }
+    }
+
+protected:
+    void deviceWriteData(uint8_t high, uint8_t low) {
+        if ( cx >= 0 && cx < deviceWidth && cy >= 0 && cy < deviceHeight ) {
+            gram[(int32_t)cy * deviceWidth + cx] = (high << 8) | low;
+        }
+        writes++;
+        advance();
+    }
+
+    int32_t setRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+        Bounds bb(x1, y1, x2, y2);
+        if ( !checkBounds(bb) ) {
+            return 0;
+        }
+        wx1 = cx = bb.x1;
+        wy1 = cy = bb.y1;
+        wx2 = bb.x2;
+        wy2 = bb.y2;
+        windows++;
+        return (int32_t)(bb.x2 - bb.x1 + 1) * (bb.y2 - bb.y1 + 1);
+    }
+
+    void quickFill(int color, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+        int32_t n = setRegion(x1, y1, x2, y2);
+        for ( int32_t i = 0; i < n; i++ ) {
+            deviceWriteData(highByte(color), lowByte(color));
+        }
+    }
+
+    int32_t readRegion(int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t* data) {
+        int32_t n = setRegion(x1, y1, x2, y2);
+        for ( int32_t i = 0; i < n; i++ ) {
+            data[i] = gram[(int32_t)cy * deviceWidth + cx];
+            advance();
+        }
+        return n;
+    }
+
+public:
+    uint16_t* gram;
+    long windows;
+    long writes;
+
+    Pixels(uint16_t width, uint16_t height) : PixelsBase(width, height) {
+        gram = new uint16_t[(int32_t)width * height]();
+        windows = 0;
+        writes = 0;
+        registerCS = &hostCS;
+        bitmaskCS = 1;
+    }
+
+    ~Pixels() {
+        delete[] gram;
+    }
+
+    uint16_t at(int16_t x, int16_t y) {
+        return gram[(int32_t)y * deviceWidth + x];
+    }
+
+    /* number of pixels which differ from the other panel */
+    int32_t compare(Pixels& other) {
+        int32_t n = 0;
+        for ( int32_t i = 0; i < (int32_t)deviceWidth * deviceHeight; i++ ) {
+            n += gram[i] != other.gram[i];
+        }
+        return n;
+    }
+
+    /* number of pixels which differ from the color */
+    int32_t count(uint16_t color, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+        int32_t n = 0;
+        for ( int16_t y = y1; y <= y2; y++ ) {
+            for ( int16_t x = x1; x <= x2; x++ ) {
+                n += at(x, y) != color;
+            }
+        }
+        return n;
+    }
+
+private:
+    Pixels(const Pixels&);
+    Pixels& operator=(const Pixels&);
+};
+
+/* failed checks; a check prints its own message */
+static int failures = 0;
+
+#define CHECK(condition, ...) \
+    if ( !(condition) ) { \
+        failures++; \
+        printf("%s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    }
+
+unsigned long hostMillis = 0;
+
+#endif
@@ -0,0 +1,47 @@
+/*
+ * Pixels. Graphics library for TFT displays.
+ *
+ * Copyright (C) 2012-2014
+ *
+ * This work is licensed under the Creative Commons Attribution-NonCommercial-ShareAlike 3.0 Unported License. To view a copy of this license, visit http://creativecommons.org/licenses/by-nc-sa/3.0/
+ */
+
+/*
+ * A scene touching most of the primitives, which host checks draw in different ways
+ */
+
+#ifndef PIXELS_SCENE_H
+#define PIXELS_SCENE_H
+
+#define SCENE_WIDTH 120
+#define SCENE_HEIGHT 160
+
+static uint16_t sceneBitmap[13 * 7];
+
+static void drawScene(PixelsBase& p) {
+    for ( uint8_t i = 0; i < 13 * 7; i++ ) {
+        sceneBitmap[i] = i * 700 + 3;
+    }
+
+    p.setBackground(20, 40, 60);
+    p.clear();
+
+    p.setColor(250, 200, 10);
+    p.drawLine(0, 0, 100, 70);
+    p.drawCircle(60, 40, 25);
+    p.fillOval(5, 90, 41, 23);
+    p.drawRoundRectangle(10, 120, 80, 30, 8);
+    p.fillTriangle(70, 90, 115, 100, 80, 130);
+
+    p.setColor(10, 200, 250);
+    p.setLineWidth(3);
+    p.drawLine(5, 60, 110, 75);
+    p.drawArc(50, 70, 50, 40, 30, 200);
+    p.setLineWidth(1);
+    p.fillArc(75, 5, 40, 40, -45, 120);
+
+    p.fillRectangleGradient(20, 130, 60, 20, 0x001F, 0xF800, 30, true);
+    p.drawBitmap(100, 140, 13, 7, sceneBitmap);
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * A clipped scene matches the unclipped one within the clip rectangle and leaves the rest untouched
+ */
+
+#include "Pixels_Host.h"
+#include "Scene.h"
+
+int main() {
+    const int16_t clips[][4] = {{10, 20, 50, 40}, {-5, -5, 30, 200}, {60, 100, 100, 100}, {0, 0, 1, 1}};
+
+    for ( uint8_t o = 0; o < 4; o++ ) {
+        for ( uint8_t c = 0; c < sizeof(clips) / sizeof(clips[0]); c++ ) {
+            Pixels full(SCENE_WIDTH, SCENE_HEIGHT);
+            full.setOrientation(o);
+            drawScene(full);
+
+            Pixels clipped(SCENE_WIDTH, SCENE_HEIGHT);
+            clipped.setOrientation(o);
+            clipped.setColor(255, 0, 255);
+            clipped.fillRectangle(0, 0, clipped.getWidth(), clipped.getHeight());
+            uint16_t outside = clipped.at(0, 0);
+
+            CHECK(clipped.pushClip(clips[c][0], clips[c][1], clips[c][2], clips[c][3]) == 0, "push failed");
+            drawScene(clipped);
+            CHECK(clipped.popClip() == 0, "pop failed");
+
+            // panel coordinates of the clip rectangle
+            int16_t x1 = max(clips[c][0], 0);
+            int16_t y1 = max(clips[c][1], 0);
+            int16_t x2 = min(clips[c][0] + clips[c][2], clipped.getWidth()) - 1;
+            int16_t y2 = min(clips[c][1] + clips[c][3], clipped.getHeight()) - 1;
+
+            int32_t inside = 0;
+            int32_t leaked = 0;
+            for ( int16_t y = 0; y < clipped.getHeight(); y++ ) {
+                for ( int16_t x = 0; x < clipped.getWidth(); x++ ) {
+                    uint16_t drawn = full.getPixel(x, y)->convertTo565();
+                    uint16_t expected = x >= x1 && x <= x2 && y >= y1 && y <= y2 ? drawn : outside;
+                    uint16_t actual = clipped.getPixel(x, y)->convertTo565();
+                    if ( actual != expected ) {
+                        if ( expected == outside ) {
+                            leaked++;
+                        } else {
+                            inside++;
+                        }
+                    }
+                }
+            }
+            CHECK(inside == 0 && leaked == 0, "orientation %d clip %d: %ld differ inside, %ld drawn outside",
+                  o, c, (long)inside, (long)leaked);
+        }
+    }
+    return failures;
+}
@@ -0,0 +1,68 @@
+/*
+ * Compressed images resized while decoded match resized plain bitmaps, also wider than the row buffer
+ */
+
+#include <vector>
+#include "Pixels_Host.h"
+
+#define SIZE 200
+
+/* an image stored as literal bytes only, which is a valid compressed stream */
+static std::vector<uint8_t> compress(uint16_t* image, int16_t width, int16_t height) {
+    std::vector<uint8_t> bits;
+    int32_t pos = 0;
+    for ( int32_t i = 0; i < (int32_t)width * height * 2; i++ ) {
+        uint16_t code = i & 1 ? image[i / 2] & 0xFF : image[i / 2] >> 8;
+        for ( int8_t b = 8; b >= 0; b-- ) {
+            if ( pos % 8 == 0 ) {
+                bits.push_back(0);
+            }
+            if ( (code >> b) & 1 ) {
+                bits.back() |= 0x80 >> (pos % 8);
+            }
+            pos++;
+        }
+    }
+
+    int32_t resultLen = (int32_t)width * height * 2;
+    int32_t length = COMPRESSED_HEADER_LENGTH + bits.size();
+    uint8_t header[] = {'Z', (uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length,
+                        (uint8_t)(resultLen >> 16), (uint8_t)(resultLen >> 8), (uint8_t)resultLen, 100,
+                        (uint8_t)(width >> 8), (uint8_t)width, (uint8_t)(height >> 8), (uint8_t)height};
+    std::vector<uint8_t> data(header, header + COMPRESSED_HEADER_LENGTH);
+    data.insert(data.end(), bits.begin(), bits.end());
+    data.insert(data.end(), 4, 0);
+    return data;
+}
+
+static void check(int16_t width, int16_t height, int16_t targetWidth, int16_t targetHeight, uint8_t mode, uint8_t expectedMode) {
+    std::vector<uint16_t> image(width * height);
+    for ( int32_t i = 0; i < (int32_t)image.size(); i++ ) {
+        image[i] = (i * 2654435761u) >> 16;
+    }
+    std::vector<uint8_t> data = compress(&image[0], width, height);
+
+    for ( uint8_t o = 0; o < 4; o++ ) {
+        Pixels plain(SIZE, SIZE);
+        Pixels compressed(SIZE, SIZE);
+        plain.setOrientation(o);
+        compressed.setOrientation(o);
+        plain.drawBitmapScaled(3, 2, width, height, &image[0], targetWidth, targetHeight, expectedMode);
+        int8_t rc = compressed.drawCompressedBitmapScaled(3, 2, &data[0], targetWidth, targetHeight, mode);
+        int32_t d = plain.compare(compressed);
+        CHECK(rc == 0 && d == 0, "%dx%d to %dx%d mode %d, orientation %d: rc %d, %ld pixels differ",
+              width, height, targetWidth, targetHeight, mode, o, rc, (long)d);
+    }
+}
+
+int main() {
+    const int16_t sizes[][4] = {{13, 7, 26, 14}, {13, 7, 39, 21}, {13, 7, 20, 9}, {13, 7, 7, 5}, {13, 7, 100, 3},
+                                {150, 9, 190, 20}, {150, 9, 75, 30}, {150, 9, 151, 9}, {150, 9, 17, 4}};
+    for ( uint8_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ ) {
+        const int16_t* s = sizes[i];
+        check(s[0], s[1], s[2], s[3], SCALE_NEAREST, SCALE_NEAREST);
+        // images too wide for the row buffer are resampled as the nearest pixels
+        check(s[0], s[1], s[2], s[3], SCALE_BILINEAR, 2 * s[0] > SCALED_ROW_BUFFER_SIZE ? SCALE_NEAREST : SCALE_BILINEAR);
+    }
+    return failures;
+}
@@ -0,0 +1,36 @@
+/*
+ * A recorded scene rendered by bands matches the scene drawn directly, with any band height
+ */
+
+#include "Pixels_Host.h"
+#include "Scene.h"
+
+int main() {
+    static uint8_t list[2048];
+    static uint16_t strip[SCENE_WIDTH * 16];
+
+    for ( uint8_t o = 0; o < 4; o++ ) {
+        Pixels direct(SCENE_WIDTH, SCENE_HEIGHT);
+        direct.setOrientation(o);
+        drawScene(direct);
+
+        Pixels rendered(SCENE_WIDTH, SCENE_HEIGHT);
+        rendered.setOrientation(o);
+        rendered.beginDisplayList(list, sizeof(list));
+        drawScene(rendered);
+        CHECK(rendered.endDisplayList(), "orientation %d: display list overflow", o);
+        CHECK(rendered.count(0, 0, 0, SCENE_WIDTH - 1, SCENE_HEIGHT - 1) == 0, "orientation %d: recording drew", o);
+
+        CHECK(rendered.renderDisplayList(strip, 16) == 0, "orientation %d: render failed", o);
+        int32_t d = direct.compare(rendered);
+        CHECK(d == 0, "orientation %d: rendered %ld pixels differ", o, (long)d);
+
+        // the list stays valid, the band height does not change the result
+        rendered.setColor(0, 0, 0);
+        rendered.fillRectangle(0, 0, rendered.getWidth(), rendered.getHeight());
+        CHECK(rendered.renderDisplayList(strip, 7) == 0, "orientation %d: second render failed", o);
+        d = direct.compare(rendered);
+        CHECK(d == 0, "orientation %d: rendered again %ld pixels differ", o, (long)d);
+    }
+    return failures;
+}
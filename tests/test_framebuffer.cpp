@@ -0,0 +1,25 @@
+/*
+ * A scene drawn through the frame buffer matches the scene drawn directly, in every orientation
+ */
+
+#include "Pixels_Host.h"
+#include "Scene.h"
+
+int main() {
+    for ( uint8_t o = 0; o < 4; o++ ) {
+        Pixels direct(SCENE_WIDTH, SCENE_HEIGHT);
+        direct.setOrientation(o);
+        drawScene(direct);
+
+        Pixels buffered(SCENE_WIDTH, SCENE_HEIGHT);
+        buffered.setOrientation(o);
+        CHECK(buffered.enableFrameBuffer(), "orientation %d: no frame buffer", o);
+        drawScene(buffered);
+        buffered.flushFrameBuffer();
+        buffered.disableFrameBuffer();
+
+        int32_t d = direct.compare(buffered);
+        CHECK(d == 0, "orientation %d: %ld pixels differ", o, (long)d);
+    }
+    return failures;
+}
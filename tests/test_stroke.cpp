@@ -0,0 +1,64 @@
+/*
+ * Thick lines are as thick when sloped as when axis aligned, and round caps cover butt ones
+ */
+
+#include "Pixels_Host.h"
+
+#define SIZE 200
+
+/* average number of pixels per column between the line ends, away from the caps */
+static double columnCover(int16_t w, int16_t x1, int16_t y1, int16_t x2, int16_t y2) {
+    Pixels p(SIZE, SIZE);
+    p.setColor(255, 255, 255);
+    p.setLineWidth(w);
+    p.drawLine(x1, y1, x2, y2);
+    int32_t n = 0;
+    for ( int16_t x = x1 + w; x <= x2 - w; x++ ) {
+        n += p.count(0, x, 0, x, SIZE - 1);
+    }
+    return (double)n / (x2 - x1 - 2 * w + 1);
+}
+
+int main() {
+    for ( int16_t w = 1; w <= 8; w++ ) {
+        double flat = columnCover(w, 20, 50, 120, 50);
+        CHECK(fabs(flat - w) < 0.01, "width %d: horizontal line covers %.2f rows", w, flat);
+
+        // a column of a line with the slope k crosses w * sqrt(1 + k * k) rows
+        const int16_t lines[][4] = {{20, 20, 120, 21}, {20, 120, 120, 110}, {20, 20, 120, 60}, {20, 150, 120, 90}};
+        for ( uint8_t i = 0; i < 4; i++ ) {
+            double k = (double)(lines[i][3] - lines[i][1]) / (lines[i][2] - lines[i][0]);
+            double expected = w * sqrt(1 + k * k);
+            double cover = columnCover(w, lines[i][0], lines[i][1], lines[i][2], lines[i][3]);
+            CHECK(fabs(cover - expected) < 0.25, "width %d: line %d,%d-%d,%d covers %.2f rows, expected %.2f",
+                  w, lines[i][0], lines[i][1], lines[i][2], lines[i][3], cover, expected);
+        }
+    }
+
+    srand(3);
+    for ( int16_t i = 0; i < 500; i++ ) {
+        int16_t w = 2 + i % 9;
+        int16_t p[4];
+        for ( uint8_t j = 0; j < 4; j++ ) {
+            p[j] = 20 + rand() % (SIZE - 40);
+        }
+        Pixels butt(SIZE, SIZE);
+        Pixels round(SIZE, SIZE);
+        butt.setColor(255, 255, 255);
+        round.setColor(255, 255, 255);
+        butt.setLineWidth(w);
+        round.setLineWidth(w);
+        butt.setLineCap(LINE_CAP_BUTT);
+        round.setLineCap(LINE_CAP_ROUND);
+        butt.drawLine(p[0], p[1], p[2], p[3]);
+        round.drawLine(p[0], p[1], p[2], p[3]);
+
+        int32_t missed = 0;
+        for ( int32_t j = 0; j < SIZE * SIZE; j++ ) {
+            missed += butt.gram[j] != 0 && round.gram[j] == 0;
+        }
+        CHECK(missed == 0, "width %d: round capped line %d,%d-%d,%d misses %ld pixels of the butt one",
+              w, p[0], p[1], p[2], p[3], (long)missed);
+    }
+    return failures;
+}
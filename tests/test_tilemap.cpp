@@ -0,0 +1,123 @@
+/*
+ * A tile map run of icons matches the background filled and the icons drawn one by one,
+ * a run of bitmaps matches the bitmaps drawn one by one, and a run goes out as one window
+ */
+
+#include "Pixels_Host.h"
+#include "Pixels_TileMap.h"
+
+#define TILE 48
+#define COLUMNS 4
+#define ROWS 2
+
+/* compressed bitmask stored by columns */
+static prog_uchar storage[] = {
+    0x5A,0x62,0x00,0x3B,0x30,0x30,0x88,0x04,0x84,0x0B,0x9C,0x0B,0x9E,0x09,0x9F,0x08,0xA0,0x07,0xA1,0x06,
+    0xA2,0x05,0xA3,0x04,0xA4,0x03,0xA5,0x02,0xA6,0x01,0xD3,0x08,0xA0,0x08,0xA0,0x08,0xA0,0x08,0xF0,0x08,
+    0xA0,0x08,0xA0,0x08,0xA0,0x08,0xF0,0x08,0xA0,0x08,0xA0,0x08,0xA0,0x08,0xFF,0x95,0x01,0xA6,0x01};
+
+/* compressed bitmask stored by rows */
+static prog_uchar chat[] = {
+    0x5A,0x62,0x00,0x1D,0x18,0x18,0x02,0x02,0x82,0xD4,0x0C,0x88,0x0C,0x9C,0x0C,0x88,0x0C,0x9C,0x08,0x8C,
+    0x08,0xDC,0x10,0x83,0x11,0x82,0x12,0x81,0x13};
+
+/* antialiased */
+static prog_uchar trash[] = {
+    0x5A,0x61,0x00,0x5B,0x30,0x30,0x0A,0x06,0x0A,0x48,0x1F,0x8A,0x1F,0x4F,0x1F,0x8C,0x1F,0x47,0xBF,0xB1,
+    0x7A,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,
+    0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,
+    0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x98,0x44,0x02,0x96,0x03,0x44,0x13,0x96,0x14,0x44,0x35,0x03,0x94,
+    0x04,0x36,0x45,0x35,0x13,0x03,0x90,0x03,0x14,0x36,0x43};
+
+/* plain bitmask */
+static prog_uchar plain[] = {0x5A,0x62,0x00,0x0C,0x06,0x08,0x01,0x01,0x01,0x0F,0x3C,0xA5};
+
+/* antialiased stored by columns */
+static prog_uchar dots[] = {0x5A,0x61,0x00,0x0F,0x08,0x08,0x81,0x01,0x01,0xC3,0x10,0x45,0x20,0x83,0x01};
+
+static prog_uchar* atlas[] = {storage, chat, trash, plain, dots};
+
+static void clean(Pixels& p, int16_t x, int16_t y, int16_t width, int16_t height) {
+    p.setColor(20, 40, 60);
+    p.fillRectangle(x, y, width, height);
+    p.setColor(250, 200, 10);
+}
+
+static const uint8_t layout[ROWS][COLUMNS] = {{0, 1, 2, EMPTY_TILE}, {3, 4, 2, 0}};
+
+int main() {
+    for ( uint8_t o = 0; o < 4; o++ ) {
+        Pixels reference(TILE * COLUMNS + 10, TILE * COLUMNS + 10);
+        Pixels mapped(TILE * COLUMNS + 10, TILE * COLUMNS + 10);
+        reference.setOrientation(o);
+        mapped.setOrientation(o);
+        reference.setBackground(20, 40, 60);
+        mapped.setBackground(20, 40, 60);
+        reference.setColor(250, 200, 10);
+        mapped.setColor(250, 200, 10);
+
+        clean(reference, 5, 3, TILE * COLUMNS, TILE * ROWS);
+        for ( uint8_t r = 0; r < ROWS; r++ ) {
+            for ( uint8_t c = 0; c < COLUMNS; c++ ) {
+                if ( layout[r][c] != EMPTY_TILE ) {
+                    reference.drawIcon(5 + c * TILE, 3 + r * TILE, atlas[layout[r][c]]);
+                }
+            }
+        }
+
+        TileMap map(&mapped, 5, 3, COLUMNS, ROWS, TILE, TILE);
+        map.setIconAtlas(atlas, sizeof(atlas) / sizeof(atlas[0]));
+        for ( uint8_t r = 0; r < ROWS; r++ ) {
+            for ( uint8_t c = 0; c < COLUMNS; c++ ) {
+                map.setTile(c, r, layout[r][c]);
+            }
+        }
+        mapped.windows = 0;
+        mapped.writes = 0;
+        map.flush();
+
+        int32_t d = reference.compare(mapped);
+        CHECK(d == 0, "orientation %d: %ld pixels differ", o, (long)d);
+        CHECK(mapped.windows == ROWS, "orientation %d: %ld windows for %d runs", o, mapped.windows, ROWS);
+        CHECK(mapped.writes == (long)TILE * COLUMNS * TILE * ROWS, "orientation %d: %ld pixels written", o, mapped.writes);
+
+        // a single changed cell is redrawn alone
+        map.setTile(1, 1, 1);
+        mapped.windows = 0;
+        map.flush();
+        clean(reference, 5 + TILE, 3 + TILE, TILE, TILE);
+        reference.drawIcon(5 + TILE, 3 + TILE, chat);
+        d = reference.compare(mapped);
+        CHECK(d == 0 && mapped.windows == 1, "orientation %d: one cell, %ld pixels differ, %ld windows", o, (long)d, mapped.windows);
+    }
+
+    static uint16_t bitmaps[3 * 10 * 6];
+    for ( uint16_t i = 0; i < sizeof(bitmaps) / sizeof(bitmaps[0]); i++ ) {
+        bitmaps[i] = i * 2654435761u >> 16;
+    }
+    for ( uint8_t o = 0; o < 4; o++ ) {
+        Pixels reference(100, 100);
+        Pixels mapped(100, 100);
+        reference.setOrientation(o);
+        mapped.setOrientation(o);
+        clean(reference, 7, 9, 70, 6);
+        for ( uint8_t c = 0; c < 7; c++ ) {
+            if ( c != 4 ) {
+                reference.drawBitmap(7 + c * 10, 9, 10, 6, bitmaps + (c % 3) * 60);
+            }
+        }
+
+        TileMap map(&mapped, 7, 9, 7, 1, 10, 6);
+        map.setBitmapAtlas(bitmaps, 3);
+        for ( uint8_t c = 0; c < 7; c++ ) {
+            map.setTile(c, 0, c == 4 ? EMPTY_TILE : c % 3);
+        }
+        mapped.setBackground(20, 40, 60);
+        mapped.windows = 0;
+        map.flush();
+
+        int32_t d = reference.compare(mapped);
+        CHECK(d == 0 && mapped.windows == 1, "bitmaps, orientation %d: %ld pixels differ, %ld windows", o, (long)d, mapped.windows);
+    }
+    return failures;
+}